@@ -406,6 +406,7 @@ pub fn build(b: *std.Build) !void {
                 kernel_module.addImport("yasld", yasld.module("yasld"));
                 kernel_module.addImport("arch", arch_module);
                 arch_arm_m.addImport("hal", hal_module);
+                arch_arm_m.addImport("board", board_module);
             }
             arch_module.addAssemblyFile(b.path(b.fmt("source/arch/{s}/context_switch.S", .{config.cpu_arch})));
             boardDep.artifact("yasos_kernel").root_module.addImport("arch", arch_module);
@@ -93,6 +93,8 @@ cd ..
 mkdir -p rootfs/tmp
 cp $SCRIPT_DIR/hello_world.c rootfs/usr
 cp $SCRIPT_DIR/hello_script.sh rootfs/usr
+cp $SCRIPT_DIR/tests/smoke/programs/lazy_binding_float.c rootfs/usr
+cp -r $SCRIPT_DIR/source/sys/include/yasos rootfs/usr/include
 
 mkdir -p rootfs/dev
 pwd
@@ -35,6 +35,12 @@ from enum import Enum
 from pathlib import Path
 
 
+# since version 2 symbol tables are followed by lookup tables and GNU style hash tables
+YAFF_VERSION = 2
+GNU_HASH_BLOOM_SHIFT = 6
+GNU_HASH_EMPTY_BUCKET = 0xFFFFFFFF
+
+
 class SectionCode(Enum):
     Code = 0
     Data = 1
@@ -773,6 +779,59 @@ class Application:
 
         return table
 
+    @staticmethod
+    def __gnu_hash(name):
+        h = 5381
+        for c in bytearray(name, "ascii"):
+            h = (h * 33 + c) & 0xFFFFFFFF
+        return h
+
+    @staticmethod
+    def __gnu_hash_buckets(symbols):
+        return max(1, len(symbols) // 2)
+
+    @staticmethod
+    def __sort_symbols_by_gnu_bucket(symbols):
+        # chains are continuous ranges of symbols, so table must be ordered by bucket
+        nbuckets = Application.__gnu_hash_buckets(symbols)
+        symbols.sort(key=lambda symbol: Application.__gnu_hash(symbol["name"]) % nbuckets)
+
+    @staticmethod
+    def __build_lookup_table_for(symbols):
+        table = bytearray()
+        offset = 0
+        for symbol in symbols:
+            table += struct.pack("<H", offset)
+            offset += 4 + len(Application.__align_bytes(bytearray(symbol["name"] + "\0", "ascii"), 4))
+        return table
+
+    @staticmethod
+    def __build_gnu_hash_table_for(symbols):
+        nbuckets = Application.__gnu_hash_buckets(symbols)
+        bloom_size = 1
+        # around 8 bits of bloom filter for each symbol
+        while bloom_size * 32 < len(symbols) * 8:
+            bloom_size *= 2
+
+        bloom = [0] * bloom_size
+        buckets = [GNU_HASH_EMPTY_BUCKET] * nbuckets
+        chain = []
+        hashes = [Application.__gnu_hash(symbol["name"]) for symbol in symbols]
+        for index, h in enumerate(hashes):
+            bloom[(h // 32) % bloom_size] |= (1 << (h % 32)) | (
+                1 << ((h >> GNU_HASH_BLOOM_SHIFT) % 32)
+            )
+            bucket = h % nbuckets
+            if buckets[bucket] == GNU_HASH_EMPTY_BUCKET:
+                buckets[bucket] = index
+            last = index + 1 == len(hashes) or hashes[index + 1] % nbuckets != bucket
+            chain.append((h & ~1) | (1 if last else 0))
+
+        table = struct.pack("<III", nbuckets, bloom_size, GNU_HASH_BLOOM_SHIFT)
+        for word in bloom + buckets + chain:
+            table += struct.pack("<I", word)
+        return table
+
     def __build_binary_relocation_table(
         self,
         symbol_table_relocations,
@@ -841,7 +900,7 @@ class Application:
         else:
             module_type = 2
 
-        image += struct.pack("<BHB", module_type, 1, 1)  # dummy values for now
+        image += struct.pack("<BHB", module_type, 1, YAFF_VERSION)  # dummy architecture for now
         image += struct.pack(
             "<IIII",
             len(self.text),
@@ -868,6 +927,9 @@ class Application:
             0,
         )
 
+        Application.__sort_symbols_by_gnu_bucket(self.exported_symbol_table)
+        Application.__sort_symbols_by_gnu_bucket(self.imported_symbol_table)
+
         exported_symbol_table = self.__build_binary_symbol_table_for(
             self.exported_symbol_table
         )
@@ -910,6 +972,18 @@ class Application:
         text_offset = len(image)
         image += struct.pack("<H", 0)
 
+        imported_symbol_lookup_position = len(image)
+        image += struct.pack("<H", 0)
+
+        exported_symbol_lookup_position = len(image)
+        image += struct.pack("<H", 0)
+
+        imported_symbol_hash_table_position = len(image)
+        image += struct.pack("<H", 0)
+
+        exported_symbol_hash_table_position = len(image)
+        image += struct.pack("<H", 0)
+
         encoded_name = Application.__align_bytes(bytearray(Path(self.args.input).stem + "\0", "ascii"), alignment)
         image += encoded_name
 
@@ -929,6 +1003,19 @@ class Application:
         struct.pack_into("<H", image, exported_symbol_table_position, len(image))
         image += exported_symbol_table
 
+        struct.pack_into("<H", image, imported_symbol_lookup_position, len(image))
+        image += Application.__build_lookup_table_for(self.imported_symbol_table)
+
+        struct.pack_into("<H", image, exported_symbol_lookup_position, len(image))
+        image += Application.__build_lookup_table_for(self.exported_symbol_table)
+
+        image = Application.__align_bytes(image, 4)
+        struct.pack_into("<H", image, imported_symbol_hash_table_position, len(image))
+        image += Application.__build_gnu_hash_table_for(self.imported_symbol_table)
+
+        struct.pack_into("<H", image, exported_symbol_hash_table_position, len(image))
+        image += Application.__build_gnu_hash_table_for(self.exported_symbol_table)
+
         image = Application.__align_bytes(image, 16)
         struct.pack_into("<H", image, text_offset, len(image))
         image += self.text
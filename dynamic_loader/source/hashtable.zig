@@ -60,3 +60,85 @@ pub const YaffHashTable = struct {
         return null;
     }
 };
+
+fn gnu_hash_function(name: []const u8) u32 {
+    var h: u32 = 5381;
+    for (name) |c| {
+        h = h *% 33 +% @as(u32, c);
+    }
+    return h;
+}
+
+// GNU style table, data layout in u32 words:
+//   nbuckets, bloom_size, bloom_shift, bloom[bloom_size], buckets[nbuckets], chain[number of symbols]
+// Symbols are sorted by bucket, so bucket points to the first symbol of a continuous chain.
+// Chain keeps symbol hashes with the lowest bit set for the last symbol in the bucket.
+// Bloom filter rejects most of the missing names without touching buckets and symbols.
+pub const GnuHashTable = struct {
+    pub const empty_bucket: u32 = 0xffffffff;
+
+    bloom_shift: u5,
+    bloom: []const u32,
+    buckets: []const u32,
+    chain: []const u32,
+
+    pub fn parse(data: [*]const u32, number_of_symbols: usize) GnuHashTable {
+        const nbuckets = data[0];
+        const bloom_size = data[1];
+        return .{
+            .bloom_shift = @intCast(data[2]),
+            .bloom = data[3..][0..bloom_size],
+            .buckets = data[3 + bloom_size ..][0..nbuckets],
+            .chain = data[3 + bloom_size + nbuckets ..][0..number_of_symbols],
+        };
+    }
+
+    fn may_contain(hashtable: GnuHashTable, h: u32) bool {
+        if (hashtable.bloom.len == 0) {
+            return true;
+        }
+        const word = hashtable.bloom[(h / 32) % hashtable.bloom.len];
+        const mask = (@as(u32, 1) << @intCast(h % 32)) | (@as(u32, 1) << @intCast((h >> hashtable.bloom_shift) % 32));
+        return word & mask == mask;
+    }
+
+    pub fn lookup(hashtable: GnuHashTable, name: []const u8, table: *const SymbolTable) ?*const Symbol {
+        if (hashtable.buckets.len == 0) {
+            return null;
+        }
+        const h: u32 = gnu_hash_function(name);
+        if (!hashtable.may_contain(h)) {
+            return null;
+        }
+        var idx: u32 = hashtable.buckets[h % hashtable.buckets.len];
+        if (idx == empty_bucket) {
+            return null;
+        }
+
+        while (idx < hashtable.chain.len) : (idx += 1) {
+            const chain_hash = hashtable.chain[idx];
+            if ((chain_hash | 1) == (h | 1)) {
+                if (table.element_at(idx)) |symbol| {
+                    if (std.mem.eql(u8, symbol.name(), name)) {
+                        return symbol;
+                    }
+                }
+            }
+            if (chain_hash & 1 != 0) {
+                break;
+            }
+        }
+        return null;
+    }
+};
+
+pub const SymbolHashTable = union(enum) {
+    sysv: YaffHashTable,
+    gnu: GnuHashTable,
+
+    pub fn lookup(hashtable: SymbolHashTable, name: []const u8, table: *const SymbolTable) ?*const Symbol {
+        return switch (hashtable) {
+            inline else => |ht| ht.lookup(name, table),
+        };
+    }
+};
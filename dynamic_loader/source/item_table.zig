@@ -22,7 +22,7 @@ const std = @import("std");
 const Dependency = @import("dependency.zig").Dependency;
 const Symbol = @import("symbol.zig").Symbol;
 
-const YaffHashTable = @import("hashtable.zig").YaffHashTable;
+const SymbolHashTable = @import("hashtable.zig").SymbolHashTable;
 
 pub fn ItemTable(comptime ItemType: anytype) type {
     return struct {
@@ -30,11 +30,11 @@ pub fn ItemTable(comptime ItemType: anytype) type {
         lookup: []u16,
         number_of_items: u16,
         alignment: u8,
-        hashtable: ?YaffHashTable = null,
+        hashtable: ?SymbolHashTable = null,
 
         const Self = @This();
 
-        pub fn create(table_address: usize, elements: u16, alignment: u8, lookup: []u16, hashtable: ?YaffHashTable) Self {
+        pub fn create(table_address: usize, elements: u16, alignment: u8, lookup: []u16, hashtable: ?SymbolHashTable) Self {
             return .{
                 .root = @ptrFromInt(table_address),
                 .number_of_items = elements,
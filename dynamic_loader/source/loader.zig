@@ -29,6 +29,7 @@ const Type = @import("header.zig").Type;
 const Section = @import("section.zig").Section;
 const Symbol = @import("symbol.zig").Symbol;
 const SymbolEntry = @import("module.zig").SymbolEntry;
+const SymbolProvider = @import("module.zig").Module.SymbolProvider;
 const LoadedSharedData = @import("module.zig").LoadedSharedData;
 const LoadedUniqueData = @import("module.zig").LoadedUniqueData;
 
@@ -53,25 +54,179 @@ pub const Loader = struct {
         users: i32,
     };
 
+    // lazy mode binds imported function pointers on the first call instead of load time
+    pub const BindingMode = enum {
+        eager,
+        lazy,
+    };
+
+    // memory mapped image stays in place until its file is modified, image copied to RAM
+    // is released with the process and other image may be copied to the same address later
+    pub const ImageStorage = enum {
+        mapped,
+        copied,
+    };
+
+    // symbol providers resolved by the previous load of the module, indexed like
+    // symbol table relocations, valid only for the same image and the same dependency images,
+    // only memory mapped images are cached
+    const RelocationCache = struct {
+        image: usize,
+        dependencies: []usize,
+        providers: []?SymbolProvider,
+    };
+    const relocation_cache_capacity = 16;
+
+    // collects providers of symbol table relocations, reusing cached ones when possible
+    const SymbolResolver = struct {
+        module: *Module,
+        cached: ?[]const ?SymbolProvider,
+        resolved: ?[]?SymbolProvider,
+        missed: bool = false,
+
+        fn resolve(self: *SymbolResolver, index: usize, name: []const u8) ?SymbolEntry {
+            if (self.cached) |providers| {
+                if (providers[index]) |provider| {
+                    // cached images are not released, name is compared to not trust cache blindly
+                    // when image was modified without invalidation
+                    if (std.mem.eql(u8, provider.symbol.name(), name)) {
+                        if (self.module.resolve_symbol_provider(provider)) |entry| {
+                            self.remember(index, provider);
+                            return entry;
+                        }
+                    }
+                }
+            }
+            self.missed = true;
+            const provider = self.module.find_symbol_provider(name) orelse return null;
+            self.remember(index, provider);
+            return self.module.resolve_symbol_provider(provider);
+        }
+
+        fn remember(self: *SymbolResolver, index: usize, provider: SymbolProvider) void {
+            if (self.resolved) |resolved| {
+                resolved[index] = provider;
+            }
+        }
+    };
+
     file_resolver: FileResolver,
+    binding_mode: BindingMode,
 
     // mapping from name to loaded instances
     // pid to module mapping done inside kernel itself
     modules_list: std.StringHashMap(LoadedModule),
+    relocation_cache: std.StringHashMap(RelocationCache),
     kernel_allocator: std.mem.Allocator,
 
     pub fn create(file_resolver: FileResolver, kernel_allocator: std.mem.Allocator) Loader {
         return .{
             .file_resolver = file_resolver,
+            .binding_mode = .eager,
             .modules_list = std.StringHashMap(LoadedModule).init(kernel_allocator),
+            .relocation_cache = std.StringHashMap(RelocationCache).init(kernel_allocator),
             .kernel_allocator = kernel_allocator,
         };
     }
 
     pub fn deinit(self: *Loader) void {
+        self.invalidate_relocation_cache();
+        self.relocation_cache.deinit();
         self.modules_list.deinit();
     }
 
+    // must be called when any image may have been replaced or moved
+    pub fn invalidate_relocation_cache(self: *Loader) void {
+        var it = self.relocation_cache.iterator();
+        while (it.next()) |entry| {
+            self.free_relocation_cache_entry(entry.key_ptr.*, entry.value_ptr.*);
+        }
+        self.relocation_cache.clearRetainingCapacity();
+    }
+
+    // must be called before memory mapped image is modified, drops modules that use it
+    pub fn invalidate_relocation_cache_for_image(self: *Loader, image: usize) void {
+        var it = self.relocation_cache.iterator();
+        while (it.next()) |entry| {
+            const cache = entry.value_ptr.*;
+            if (cache.image == image or std.mem.indexOfScalar(usize, cache.dependencies, image) != null) {
+                const key = entry.key_ptr.*;
+                self.relocation_cache.removeByPtr(entry.key_ptr);
+                self.free_relocation_cache_entry(key, cache);
+                // removal invalidates iterator
+                it = self.relocation_cache.iterator();
+            }
+        }
+    }
+
+    fn free_relocation_cache_entry(self: *Loader, name: []const u8, cache: RelocationCache) void {
+        self.kernel_allocator.free(cache.providers);
+        self.kernel_allocator.free(cache.dependencies);
+        self.kernel_allocator.free(name);
+    }
+
+    fn cached_symbol_providers(self: *Loader, module: *const Module, relocations: usize) ?[]const ?SymbolProvider {
+        if (module.image == 0) {
+            return null;
+        }
+        const name = module.name orelse return null;
+        const cache = self.relocation_cache.get(name) orelse return null;
+        if (cache.image != module.image or cache.providers.len != relocations) {
+            return null;
+        }
+        var index: usize = 0;
+        var it = module.children.first;
+        while (it) |child_node| : (it = child_node.next) {
+            const child: *const Module = @fieldParentPtr("child_list_node", child_node);
+            if (index >= cache.dependencies.len or cache.dependencies[index] != child.image) {
+                return null;
+            }
+            index += 1;
+        }
+        if (index != cache.dependencies.len) {
+            return null;
+        }
+        return cache.providers;
+    }
+
+    // takes ownership of providers
+    fn store_symbol_providers(self: *Loader, module: *const Module, providers: []?SymbolProvider) !void {
+        errdefer self.kernel_allocator.free(providers);
+        const name = module.name orelse return error.SymbolNotFound;
+        if (self.relocation_cache.fetchRemove(name)) |old| {
+            self.free_relocation_cache_entry(old.key, old.value);
+        } else if (self.relocation_cache.count() >= relocation_cache_capacity) {
+            var it = self.relocation_cache.iterator();
+            if (it.next()) |victim| {
+                const key = victim.key_ptr.*;
+                const value = victim.value_ptr.*;
+                self.relocation_cache.removeByPtr(victim.key_ptr);
+                self.free_relocation_cache_entry(key, value);
+            }
+        }
+
+        const dependencies = try self.kernel_allocator.alloc(usize, module.children.len());
+        errdefer self.kernel_allocator.free(dependencies);
+        var index: usize = 0;
+        var it = module.children.first;
+        while (it) |child_node| : (it = child_node.next) {
+            const child: *const Module = @fieldParentPtr("child_list_node", child_node);
+            dependencies[index] = child.image;
+            index += 1;
+        }
+        const key = try self.kernel_allocator.dupe(u8, name);
+        errdefer self.kernel_allocator.free(key);
+        try self.relocation_cache.put(key, .{
+            .image = module.image,
+            .dependencies = dependencies,
+            .providers = providers,
+        });
+    }
+
+    pub fn set_binding_mode(self: *Loader, mode: BindingMode) void {
+        self.binding_mode = mode;
+    }
+
     fn get_shared_data(self: *Loader, module_name: []const u8, process_allocator: std.mem.Allocator, parser: *const Parser, xip: bool) !*LoadedSharedData {
         var maybe_existing_module = self.modules_list.getPtr(module_name);
         if (maybe_existing_module) |*loaded| {
@@ -88,7 +243,7 @@ pub const Loader = struct {
         return shared_data;
     }
 
-    pub fn load_executable(self: *Loader, module: *const anyopaque, process_allocator: std.mem.Allocator) !Executable {
+    pub fn load_executable(self: *Loader, module: *const anyopaque, process_allocator: std.mem.Allocator, storage: ImageStorage) !Executable {
         const executable: Executable = .{
             .module = try Module.create(
                 self.kernel_allocator,
@@ -96,13 +251,13 @@ pub const Loader = struct {
                 true,
             ),
         };
-        try self.load_module(executable.module, module, process_allocator);
+        try self.load_module(executable.module, module, process_allocator, storage);
         return executable;
     }
 
     pub fn load_library(self: *Loader, module: *const anyopaque, process_allocator: std.mem.Allocator) !*Module {
         const library: *Module = try Module.create(self.kernel_allocator, process_allocator, true);
-        try self.load_module(library, module, process_allocator);
+        try self.load_module(library, module, process_allocator, .mapped);
         return library;
     }
 
@@ -123,7 +278,7 @@ pub const Loader = struct {
         }
     }
 
-    fn load_module(self: *Loader, module: *Module, module_address: *const anyopaque, process_allocator: std.mem.Allocator) !void {
+    fn load_module(self: *Loader, module: *Module, module_address: *const anyopaque, process_allocator: std.mem.Allocator, storage: ImageStorage) !void {
         log.debug("parsing header", .{});
         const header = self.process_header(module_address) catch |err| {
             log.err("Wrong magic cookie, not a yaff file", .{});
@@ -132,6 +287,7 @@ pub const Loader = struct {
         print_header(header);
         const parser = Parser.create(header);
         parser.print();
+        module.image = if (storage == .mapped) @intFromPtr(module_address) else 0;
 
         try module.set_name(parser.name);
         try self.import_child_modules(header, &parser, module);
@@ -162,6 +318,9 @@ pub const Loader = struct {
         if (total_fn_ptr_thunks > 0) {
             if (module.unique_data) |unique| {
                 try unique.allocate_thunks(total_fn_ptr_thunks);
+                if (self.binding_mode == .lazy and symbol_table_fn_ptr_count > 0) {
+                    try unique.allocate_lazy_bindings(symbol_table_fn_ptr_count);
+                }
             }
         }
 
@@ -229,7 +388,8 @@ pub const Loader = struct {
                 }
                 const child = try Module.create(module.allocator, module.process_allocator, true);
                 module.append_child(child);
-                self.load_module(child, address, module.process_allocator) catch |err| {
+                // file resolver provides memory mapped images
+                self.load_module(child, address, module.process_allocator, .mapped) catch |err| {
                     log.err("Can't load child module '{s}': {s}", .{ library.data.name(), @errorName(err) });
                     return error.ChildLoadingFailure;
                 };
@@ -280,13 +440,9 @@ pub const Loader = struct {
         }
     }
 
-    fn process_symbol_table_relocations(self: Loader, parser: *const Parser, module: *Module, header: *const Header) !void {
+    fn process_symbol_table_relocations(self: *Loader, parser: *const Parser, module: *Module, header: *const Header) !void {
         var got = module.get_got();
         log.debug("Processing symbol table relocations for GOT: {x}", .{@intFromPtr(got.ptr)});
-        const maybe_init = self.find_symbol(module, "__start_data");
-        if (maybe_init == null) {
-            log.debug("[yasld] Can't find symbol '__start_data'", .{});
-        }
         for (0..got.len) |i| {
             if (i < 3) {
                 continue;
@@ -312,7 +468,25 @@ pub const Loader = struct {
         var current_function_pointer_relocation_index: usize = 0;
         const maybe_unique_data = module.unique_data;
 
-        for (parser.symbol_table_relocations.relocations) |rel| {
+        const relocations = parser.symbol_table_relocations.relocations;
+        // cache is only an optimization, load continues without it when memory is short
+        var resolver: SymbolResolver = .{
+            .module = module,
+            .cached = self.cached_symbol_providers(module, relocations.len),
+            .resolved = null,
+        };
+        if (module.image != 0) {
+            resolver.resolved = self.kernel_allocator.alloc(?SymbolProvider, relocations.len) catch null;
+        }
+        defer if (resolver.resolved) |resolved| self.kernel_allocator.free(resolved);
+        if (resolver.resolved) |resolved| {
+            @memset(resolved, null);
+        }
+        if (resolver.cached != null) {
+            log.debug("Reusing cached symbol resolutions for: {s}", .{module.name.?});
+        }
+
+        for (relocations, 0..) |rel, relocation_index| {
             var maybe_symbol: ?*const Symbol = null;
             if (rel.function_pointer == 1) {
                 if (rel.is_exported_symbol == 1) {
@@ -326,8 +500,17 @@ pub const Loader = struct {
                 }
                 if (maybe_unique_data) |unique| {
                     if (unique.thunks) |thunks| {
-                        if (!thunks.generated) {
-                            const maybe_symbol_entry = self.find_symbol(module, maybe_symbol.?.name());
+                        if (!thunks.generated and self.binding_mode == .lazy) {
+                            // symbol is looked up on the first call through the thunk
+                            const address = unique.generate_lazy_thunk(current_function_pointer_relocation_index, maybe_symbol.?.name()) catch |err| {
+                                log.err("[yasld] Can't generate lazy thunk for symbol: '{s}': {s}", .{ maybe_symbol.?.name(), @errorName(err) });
+                                return err;
+                            };
+                            log.debug("Setting GOT[{d}] to lazy thunk: 0x{x} [{s}]", .{ rel.index, address, maybe_symbol.?.name() });
+                            current_function_pointer_relocation_index += 1;
+                            got[rel.index].symbol_offset = address;
+                        } else if (!thunks.generated) {
+                            const maybe_symbol_entry = resolver.resolve(relocation_index, maybe_symbol.?.name());
                             if (maybe_symbol_entry) |symbol_entry| {
                                 const address = unique.generate_thunk(current_function_pointer_relocation_index, symbol_entry.target_got_address, symbol_entry.address) catch |err| {
                                     log.err("[yasld] Can't generate thunk for symbol: '{s}': {s}", .{ maybe_symbol.?.name(), @errorName(err) });
@@ -359,7 +542,7 @@ pub const Loader = struct {
                 maybe_symbol = parser.imported_symbols.element_at(rel.symbol_index);
             }
             if (maybe_symbol) |symbol| {
-                const maybe_symbol_entry = self.find_symbol(module, symbol.name());
+                const maybe_symbol_entry = resolver.resolve(relocation_index, symbol.name());
                 if (maybe_symbol_entry) |symbol_entry| {
                     log.debug("Setting GOT[{d}] to: 0x{x} [{s}], exported: {d} -> GOT address: {x}", .{ rel.index, symbol_entry.address, symbol.name(), rel.is_exported_symbol, symbol_entry.target_got_address });
                     got[rel.index].symbol_offset = symbol_entry.address;
@@ -373,14 +556,15 @@ pub const Loader = struct {
                 return LoaderError.SymbolNotFound;
             }
         }
-    }
 
-    fn find_symbol(_: Loader, module: *Module, name: []const u8) ?SymbolEntry {
-        if (module.find_symbol(name)) |symbol| {
-            return symbol;
+        if (resolver.missed) {
+            if (resolver.resolved) |resolved| {
+                resolver.resolved = null;
+                self.store_symbol_providers(module, resolved) catch |err| {
+                    log.debug("Can't cache symbol resolutions for {s}: {s}", .{ module.name.?, @errorName(err) });
+                };
+            }
         }
-
-        return null;
     }
 
     fn process_local_relocations(_: Loader, parser: *const Parser, module: *Module, thunk_start_index: usize) !void {
@@ -24,6 +24,7 @@ const SymbolTable = @import("item_table.zig").SymbolTable;
 const Section = @import("section.zig").Section;
 const Header = @import("header.zig").Header;
 const Parser = @import("parser.zig").Parser;
+const Symbol = @import("symbol.zig").Symbol;
 
 const get_loader = @import("loader.zig").get_loader;
 
@@ -41,6 +42,24 @@ pub const SymbolEntry = struct {
 
 extern const indirect_call_thunk_template_size: usize;
 extern fn indirect_call_thunk_template_start() void;
+extern fn yasld_lazy_binding_trampoline() void;
+
+const thunk_r9_offset = 20;
+const thunk_target_offset = 24;
+
+// Record used as r9 by thunks of lazily bound function pointers, thunk target is
+// yasld_lazy_binding_trampoline, which calls address with base_register once bound.
+// Record is read by process code, so it is placed in process memory and layout is shared with trampoline.
+pub const LazyBinding = extern struct {
+    base_register: usize = 0,
+    address: usize = 0,
+
+    // address is published last, trampoline treats non zero address as bound record
+    pub fn bind(self: *LazyBinding, symbol: SymbolEntry) void {
+        self.base_register = symbol.target_got_address;
+        @atomicStore(usize, &self.address, symbol.address, .release);
+    }
+};
 
 pub const ThunkHolderData = struct {
     data: []u8,
@@ -106,6 +125,9 @@ pub const LoadedUniqueData = struct {
     bss: ?[]u8,
     got: ?[]GotEntry,
     thunks: ?*ThunkHolderData,
+    lazy_bindings: []LazyBinding,
+    // names of lazily bound symbols are kept in kernel memory, process can modify only records
+    lazy_symbols: [][]const u8,
     allocator: std.mem.Allocator,
     process_allocator: std.mem.Allocator,
     _underlaying_memory: []u8,
@@ -120,6 +142,8 @@ pub const LoadedUniqueData = struct {
             .bss = null,
             .got = null,
             .thunks = null,
+            .lazy_bindings = &.{},
+            .lazy_symbols = &.{},
             .allocator = allocator,
             .process_allocator = process_allocator,
             ._underlaying_memory = underlaying_memory,
@@ -167,13 +191,46 @@ pub const LoadedUniqueData = struct {
             const thunk_template: [*]const u8 = @ptrFromInt(@intFromPtr(&indirect_call_thunk_template_start) - 1);
             const thunk_slice: []const u8 = thunk_template[0..indirect_call_thunk_template_size];
             @memcpy(thunks.data[position .. position + indirect_call_thunk_template_size], thunk_slice[0..]);
-            @memcpy(thunks.data[position + 20 .. position + 20 + @sizeOf(usize)], std.mem.asBytes(&r9));
-            @memcpy(thunks.data[position + 24 .. position + 24 + @sizeOf(usize)], std.mem.asBytes(&symbol));
+            @memcpy(thunks.data[position + thunk_r9_offset .. position + thunk_r9_offset + @sizeOf(usize)], std.mem.asBytes(&r9));
+            @memcpy(thunks.data[position + thunk_target_offset .. position + thunk_target_offset + @sizeOf(usize)], std.mem.asBytes(&symbol));
             return @intFromPtr(&thunks.data[position]) | 1;
         }
         return error.ThunksNotAllocated;
     }
 
+    pub fn allocate_lazy_bindings(self: *LoadedUniqueData, size: usize) !void {
+        if (self.lazy_bindings.len != 0) {
+            return;
+        }
+        self.lazy_symbols = try self.allocator.alloc([]const u8, size);
+        errdefer {
+            self.allocator.free(self.lazy_symbols);
+            self.lazy_symbols = &.{};
+        }
+        self.lazy_bindings = try self.process_allocator.alloc(LazyBinding, size);
+        @memset(self.lazy_bindings, .{});
+    }
+
+    // thunk with given index is bound to the symbol on the first call, record index is the same as thunk index
+    pub fn generate_lazy_thunk(self: *LoadedUniqueData, index: usize, symbol: []const u8) !usize {
+        if (index >= self.lazy_bindings.len) {
+            return error.IndexOutOfBounds;
+        }
+        self.lazy_symbols[index] = symbol;
+        return self.generate_thunk(index, @intFromPtr(&self.lazy_bindings[index]), @intFromPtr(&yasld_lazy_binding_trampoline));
+    }
+
+    pub fn find_lazy_binding(self: *const LoadedUniqueData, record: usize) ?usize {
+        const start = @intFromPtr(self.lazy_bindings.ptr);
+        if (record < start or record >= start + self.lazy_bindings.len * @sizeOf(LazyBinding)) {
+            return null;
+        }
+        if ((record - start) % @sizeOf(LazyBinding) != 0) {
+            return null;
+        }
+        return (record - start) / @sizeOf(LazyBinding);
+    }
+
     pub fn get_thunk_address(self: *LoadedUniqueData, index: usize) !usize {
         if (self.thunks) |thunks| {
             const position = index * indirect_call_thunk_template_size;
@@ -186,6 +243,8 @@ pub const LoadedUniqueData = struct {
     }
 
     pub fn destroy(self: *LoadedUniqueData) void {
+        self.process_allocator.free(self.lazy_bindings);
+        self.allocator.free(self.lazy_symbols);
         self.process_allocator.free(self._underlaying_memory);
         self.allocator.destroy(self);
     }
@@ -201,6 +260,9 @@ pub const Module = struct {
     unique_data: ?*LoadedUniqueData,
     // this needs to be corelated with thread info
     entry: ?SymbolEntry = null,
+    // address of memory mapped yaff image, identifies module in relocation cache,
+    // 0 when image was copied to RAM
+    image: usize = 0,
     list_node: std.DoublyLinkedList.Node,
     child_list_node: std.DoublyLinkedList.Node,
     name: ?[]const u8,
@@ -316,38 +378,103 @@ pub const Module = struct {
         return null;
     }
 
-    pub fn find_symbol(self: *const Module, name: []const u8) ?SymbolEntry {
-        const maybe_local_symbol = self.find_local_symbol(name);
-        if (self.unique_data) |*data| {
-            if (data.*.got) |got| {
-                if (maybe_local_symbol) |symbol| {
-                    return .{
-                        .address = symbol,
-                        .target_got_address = @intFromPtr(got.ptr),
-                    };
+    // symbol exported by the module itself (module_index 0) or by one of its children,
+    // it stays valid as long as images of the module and its children are not moved
+    pub const SymbolProvider = struct {
+        module_index: u16,
+        symbol: *const Symbol,
+    };
+
+    fn symbol_entry(self: *const Module, symbol: *const Symbol) ?SymbolEntry {
+        if (self.unique_data) |data| {
+            if (data.got) |got| {
+                const base = self.get_base_address(@enumFromInt(symbol.section)) catch return null;
+                return .{
+                    .address = base + symbol.offset,
+                    .target_got_address = @intFromPtr(got.ptr),
+                };
+            }
+        }
+        return null;
+    }
+
+    fn exported_symbol_entry(self: *const Module, name: []const u8) ?*const Symbol {
+        if (self.shared_data) |shared_data| {
+            if (shared_data.exported_symbols.element_by_name(name)) |symbol| {
+                if (self.symbol_entry(symbol) != null) {
+                    return symbol;
                 }
             }
         }
+        return null;
+    }
+
+    pub fn find_symbol_provider(self: *const Module, name: []const u8) ?SymbolProvider {
+        if (self.exported_symbol_entry(name)) |symbol| {
+            return .{ .module_index = 0, .symbol = symbol };
+        }
 
+        var index: u16 = 1;
         var it = self.children.first;
-        while (it) |child_node| : (it = child_node.next) {
+        while (it) |child_node| : ({
+            it = child_node.next;
+            index += 1;
+        }) {
             const module: *const Module = @fieldParentPtr("child_list_node", child_node);
-            const maybe_child_symbol = module.find_local_symbol(name);
-            if (module.unique_data) |*data| {
-                if (data.*.got) |*got| {
-                    if (maybe_child_symbol) |symbol| {
-                        return .{
-                            .address = symbol,
-                            .target_got_address = @intFromPtr(got.ptr),
-                        };
-                    }
-                }
+            if (module.exported_symbol_entry(name)) |symbol| {
+                return .{ .module_index = index, .symbol = symbol };
             }
         }
+        return null;
+    }
 
+    pub fn resolve_symbol_provider(self: *const Module, provider: SymbolProvider) ?SymbolEntry {
+        if (provider.module_index == 0) {
+            return self.symbol_entry(provider.symbol);
+        }
+        var index: u16 = 1;
+        var it = self.children.first;
+        while (it) |child_node| : ({
+            it = child_node.next;
+            index += 1;
+        }) {
+            if (index == provider.module_index) {
+                const module: *const Module = @fieldParentPtr("child_list_node", child_node);
+                return module.symbol_entry(provider.symbol);
+            }
+        }
         return null;
     }
 
+    pub fn find_symbol(self: *const Module, name: []const u8) ?SymbolEntry {
+        const provider = self.find_symbol_provider(name) orelse return null;
+        return self.resolve_symbol_provider(provider);
+    }
+
+    // returns false when record doesn't belong to the module or its children
+    pub fn bind_lazy_symbol(self: *const Module, record: usize) !bool {
+        if (self.unique_data) |data| {
+            if (data.find_lazy_binding(record)) |index| {
+                const name = data.lazy_symbols[index];
+                const symbol = self.find_symbol(name) orelse {
+                    log.err("Can't bind lazy symbol: '{s}'", .{name});
+                    return error.SymbolNotFound;
+                };
+                data.lazy_bindings[index].bind(symbol);
+                return true;
+            }
+        }
+
+        var it = self.children.first;
+        while (it) |child_node| : (it = child_node.next) {
+            const module: *const Module = @fieldParentPtr("child_list_node", child_node);
+            if (try module.bind_lazy_symbol(record)) {
+                return true;
+            }
+        }
+        return false;
+    }
+
     const ModuleError = error{
         UnhandledInitAddress,
     };
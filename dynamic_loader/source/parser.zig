@@ -29,6 +29,10 @@ const relocation = @import("relocation_table.zig");
 const Header = @import("header.zig").Header;
 const Section = @import("section.zig").Section;
 const YaffHashTable = @import("hashtable.zig").YaffHashTable;
+const GnuHashTable = @import("hashtable.zig").GnuHashTable;
+
+// since this version symbol hash tables are GNU style, older images keep SysV tables
+pub const gnu_hash_yaff_version = 2;
 
 const SymbolTableRelocations = relocation.RelocationTable(relocation.SymbolTableRelocation);
 const LocalRelocations = relocation.RelocationTable(relocation.LocalRelocation);
@@ -77,7 +81,7 @@ pub const Parser = struct {
             .relocations = data_relocation_array[0..header.data_relocations_amount],
         };
 
-        const imported_array = SymbolTable{
+        var imported_array = SymbolTable{
             .number_of_items = header.imported_symbols_amount,
             .alignment = header.alignment,
             .root = @as(*const Symbol, @ptrFromInt(data_relocations.address() + data_relocations.size())),
@@ -85,7 +89,7 @@ pub const Parser = struct {
         };
 
         const imported_array_size = imported_array.size();
-        const exported_array = SymbolTable{
+        var exported_array = SymbolTable{
             .number_of_items = header.exported_symbols_amount,
             .alignment = header.alignment,
             .root = @as(*const Symbol, @ptrFromInt(imported_array.address() + imported_array_size)),
@@ -98,6 +102,17 @@ pub const Parser = struct {
         const data: usize = plt + header.plt_length;
         const got: usize = data + header.data_length;
         const got_plt: usize = got + header.got_length;
+        if (header.yaff_version >= gnu_hash_yaff_version) {
+            if (header.imported_symbols_amount > 0) {
+                const data: [*]const u32 = @ptrFromInt(@intFromPtr(header) + header.imported_symbols_hash_table_offset);
+                imported_array.hashtable = .{ .gnu = GnuHashTable.parse(data, header.imported_symbols_amount) };
+            }
+            if (header.exported_symbols_amount > 0) {
+                const data: [*]const u32 = @ptrFromInt(@intFromPtr(header) + header.exported_symbols_hash_table_offset);
+                exported_array.hashtable = .{ .gnu = GnuHashTable.parse(data, header.exported_symbols_amount) };
+            }
+        }
+
         var imported_symbols_hash_table: YaffHashTable = .{
             .nbucket = 0,
             .nchain = 0,
@@ -105,7 +120,7 @@ pub const Parser = struct {
             .chain = &[_]u32{},
         };
 
-        if (header.imported_symbols_amount > 0) {
+        if (header.imported_symbols_amount > 0 and header.yaff_version < gnu_hash_yaff_version) {
             const imported_hash_table_data: [*]u32 = @as([*]u32, @ptrFromInt(@intFromPtr(header) + header.imported_symbols_hash_table_offset));
             imported_symbols_hash_table.nbucket = imported_hash_table_data[0];
             imported_symbols_hash_table.nchain = imported_hash_table_data[1];
@@ -119,7 +134,7 @@ pub const Parser = struct {
             .bucket = &[_]u32{},
             .chain = &[_]u32{},
         };
-        if (header.exported_symbols_amount > 0) {
+        if (header.exported_symbols_amount > 0 and header.yaff_version < gnu_hash_yaff_version) {
             const exported_hash_table_data: [*]u32 = @as([*]u32, @ptrFromInt(@intFromPtr(header) + header.exported_symbols_hash_table_offset));
             exported_symbols_hash_table.nbucket = exported_hash_table_data[0];
             exported_symbols_hash_table.nchain = exported_hash_table_data[1];
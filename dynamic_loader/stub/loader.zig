@@ -22,23 +22,51 @@ const Executable = @import("executable.zig").Executable;
 
 pub const Loader = struct {
     pub const FileResolver = *const fn (name: []const u8) ?*const anyopaque;
+    pub const BindingMode = enum {
+        eager,
+        lazy,
+    };
+    pub const ImageStorage = enum {
+        mapped,
+        copied,
+    };
     file_resolver: FileResolver,
     allocator: std.mem.Allocator,
+    binding_mode: BindingMode,
 
     load_error: ?anyerror,
+    relocation_cache_invalidations: usize,
+    invalidated_image: ?usize,
+    loaded_storage: ?ImageStorage,
 
     pub fn create(file_resolver: FileResolver, allocator: std.mem.Allocator) Loader {
         return Loader{
             .file_resolver = file_resolver,
             .allocator = allocator,
+            .binding_mode = .eager,
             .load_error = null,
+            .relocation_cache_invalidations = 0,
+            .invalidated_image = null,
+            .loaded_storage = null,
         };
     }
 
+    pub fn set_binding_mode(self: *Loader, mode: BindingMode) void {
+        self.binding_mode = mode;
+    }
+
     pub fn deinit(self: *Loader) void {
         _ = self;
     }
 
+    pub fn invalidate_relocation_cache(self: *Loader) void {
+        self.relocation_cache_invalidations += 1;
+    }
+
+    pub fn invalidate_relocation_cache_for_image(self: *Loader, image: usize) void {
+        self.invalidated_image = image;
+    }
+
     pub fn load_should_fail(self: *Loader, err: anyerror) void {
         self.load_error = err;
     }
@@ -46,8 +74,9 @@ pub const Loader = struct {
         self.load_error = null;
     }
 
-    pub fn load_executable(self: *Loader, module: *const anyopaque, process_allocator: std.mem.Allocator) !Executable {
+    pub fn load_executable(self: *Loader, module: *const anyopaque, process_allocator: std.mem.Allocator, storage: ImageStorage) !Executable {
         _ = module;
+        self.loaded_storage = storage;
         if (self.load_error) |err| {
             self.load_error = null;
             return err;
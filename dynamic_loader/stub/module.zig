@@ -58,6 +58,12 @@ pub const Module = struct {
         self.allocator.destroy(self);
     }
 
+    pub fn bind_lazy_symbol(self: *const Module, record: usize) !bool {
+        _ = self;
+        _ = record;
+        return false;
+    }
+
     pub fn find_symbol(self: *Module, name: []const u8) ?SymbolEntry {
         _ = self;
         _ = name;
@@ -23,6 +23,7 @@ const std = @import("std");
 pub const Executable = @import("executable.zig").Executable;
 pub const Module = @import("module.zig").Module;
 const loader = @import("loader.zig");
+pub const Loader = loader.Loader;
 pub const get_loader = loader.get_loader;
 pub const SymbolEntry = @import("module.zig").SymbolEntry;
 
@@ -20,7 +20,7 @@ pub const mmc = struct {
         .bus_width = 1,
         .clock_speed = 50 * 1000 * 1000,
         .timeout_ms = 1000,
-        .use_dma = false,
+        .use_dma = true,
         .mode = .SPI,
         .pins = .{
             .clk = 32,
@@ -25,6 +25,7 @@ pub fn Mmc(comptime MmcType: anytype) type {
     return struct {
         pub const Pins = PinsConfig;
         pub const Config = MmcConfig;
+        pub const Callback = DmaCallback;
         const Self = @This();
         impl: MMCImplementation,
 
@@ -54,6 +55,21 @@ pub fn Mmc(comptime MmcType: anytype) type {
             return self.impl.receive_blocking(dest);
         }
 
+        // Starts DMA transfer of src to the card, bytes clocked back are stored in dest when provided.
+        // on_complete is called from interrupt context when transfer finishes.
+        pub fn transmit_dma(self: *Self, src: []const u8, dest: ?[]u8, on_complete: DmaCallback, context: ?*anyopaque) anyerror!void {
+            return self.impl.transmit_dma(src, dest, on_complete, context);
+        }
+
+        // Starts DMA reception of dest.len bytes, card is clocked with 0xff filler
+        pub fn receive_dma(self: *Self, dest: []u8, on_complete: DmaCallback, context: ?*anyopaque) anyerror!void {
+            return self.impl.receive_dma(dest, on_complete, context);
+        }
+
+        pub fn is_dma_busy(self: *const Self) bool {
+            return self.impl.is_dma_busy();
+        }
+
         pub fn chip_select(self: *Self, select: bool) void {
             return self.impl.chip_select(select);
         }
@@ -70,6 +86,8 @@ pub fn Mmc(comptime MmcType: anytype) type {
 
 pub const InitializeError = error{};
 
+pub const DmaCallback = *const fn (context: ?*anyopaque) void;
+
 pub const PinsConfig = struct {
     clk: u32,
     cmd: u32,
@@ -68,9 +68,40 @@ pub fn Uart(comptime index: usize, comptime pins: Pins, comptime uart: anytype)
         pub fn bytes_to_read(self: Self) usize {
             return self.impl.bytes_to_read();
         }
+
+        // number of bytes queued for transmission
+        pub fn bytes_to_write(self: Self) usize {
+            if (@hasDecl(UartImplementation, "bytes_to_write")) {
+                return self.impl.bytes_to_write();
+            }
+            return 0;
+        }
+
+        // callback is executed from interrupt context after queued data was sent,
+        // returns false when writes are not buffered by implementation
+        pub fn set_tx_callback(self: Self, callback: ?TxCallback, context: ?*anyopaque) bool {
+            if (@hasDecl(UartImplementation, "set_tx_callback")) {
+                self.impl.set_tx_callback(callback, context);
+                return true;
+            }
+            return false;
+        }
+
+        // callback is executed from interrupt context after data was received,
+        // returns false when implementation doesn't provide receive interrupt
+        pub fn set_rx_callback(self: Self, callback: ?RxCallback, context: ?*anyopaque) bool {
+            if (@hasDecl(UartImplementation, "set_rx_callback")) {
+                self.impl.set_rx_callback(callback, context);
+                return true;
+            }
+            return false;
+        }
     };
 }
 
+pub const RxCallback = *const fn (context: ?*anyopaque) void;
+pub const TxCallback = *const fn (context: ?*anyopaque) void;
+
 pub const WriteError = error{
     WriteFailure,
 };
@@ -13,10 +13,6 @@
 // You should have received a copy of the GNU General Public License
 // along with this program. If not, see <https://www.gnu.org/licenses/>.
 
-const std = @import("std");
-
-const log = std.log.scoped(.@"hal/uart");
-
 pub fn RingBuffer(BufferType: type, BufferSize: usize) type {
     return struct {
         const Self = @This();
@@ -35,8 +31,8 @@ pub fn RingBuffer(BufferType: type, BufferSize: usize) type {
 
         pub fn push(self: *Self, data: u8) linksection(".time_critical") void {
             const next_head = (self.head + 1) % BufferSize;
+            // no logging here, log output may be written through this buffer
             if (next_head == self.tail) {
-                log.warn("RingBuffer overflow, dropping oldest data", .{});
                 _ = self.pop();
             }
             self.buffer[self.head] = data;
@@ -70,6 +66,11 @@ pub fn RingBuffer(BufferType: type, BufferSize: usize) type {
             }
         }
 
+        // number of elements that can be pushed without dropping oldest data
+        pub fn free_space(self: *const Self) linksection(".time_critical") usize {
+            return BufferSize - 1 - self.size();
+        }
+
         pub fn is_empty(self: *const Self) linksection(".time_critical") bool {
             return self.head == self.tail;
         }
@@ -170,6 +170,7 @@ pub fn build(b: *std.Build) !void {
     hal.addIncludePath(b.path("../../../libs/pico-sdk/src/rp2_common/hardware_irq/include"));
     hal.addIncludePath(b.path("../../../libs/pico-sdk/src/rp2_common/hardware_gpio/include"));
     hal.addIncludePath(b.path("../../../libs/pico-sdk/src/rp2_common/hardware_pio/include"));
+    hal.addIncludePath(b.path("../../../libs/pico-sdk/src/rp2_common/hardware_dma/include"));
     hal.addIncludePath(b.path("../../../libs/pico-sdk/src/rp2_common/hardware_sync/include"));
     hal.addIncludePath(b.path("../../../libs/pico-sdk/src/rp2_common/hardware_vreg/include"));
 
@@ -213,6 +214,7 @@ pub fn build(b: *std.Build) !void {
             "../../../libs/pico-sdk/src/rp2_common/hardware_sync_spin_lock/sync_spin_lock.c",
             "../../../libs/pico-sdk/src/rp2_common/hardware_ticks/ticks.c",
             "../../../libs/pico-sdk/src/rp2_common/hardware_pio/pio.c",
+            "../../../libs/pico-sdk/src/rp2_common/hardware_dma/dma.c",
             // "../../../libs/pico-sdk/src/common/pico_time/time.c",
             // "../../../libs/pico-sdk/src/common/pico_sync/lock_core.c",
         },
@@ -61,6 +61,18 @@ pub const Mmc = union(enum) {
         return self.spi.receive_blocking(dest);
     }
 
+    pub fn transmit_dma(self: *Self, src: []const u8, dest: ?[]u8, on_complete: interface.mmc.DmaCallback, context: ?*anyopaque) !void {
+        return self.spi.transmit_dma(src, dest, on_complete, context);
+    }
+
+    pub fn receive_dma(self: *Self, dest: []u8, on_complete: interface.mmc.DmaCallback, context: ?*anyopaque) !void {
+        return self.spi.receive_dma(dest, on_complete, context);
+    }
+
+    pub fn is_dma_busy(self: *const Self) bool {
+        return self.spi.is_dma_busy();
+    }
+
     pub fn chip_select(self: Self, select: bool) void {
         return self.spi.chip_select(select);
     }
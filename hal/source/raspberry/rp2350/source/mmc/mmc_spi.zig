@@ -28,8 +28,27 @@ const mmc_spi = @cImport({
     @cInclude("hardware/clocks.h");
     @cInclude("hardware/pio.h");
     @cInclude("hardware/gpio.h");
+    @cInclude("hardware/dma.h");
+    @cInclude("hardware/irq.h");
 });
 
+// DMA completion interrupt is shared, only single transfer may be in flight
+var dma_owner: ?*MmcSpi = null;
+// source of 0xff bytes clocked out during reception
+const dma_filler: u8 = 0xff;
+// sink for bytes received when caller is not interested in them
+var dma_sink: u8 = 0;
+
+fn on_dma_irq() linksection(".time_critical") callconv(.c) void {
+    const owner = dma_owner orelse return;
+    const rx_channel: c_uint = @intCast(owner._rx_dma);
+    if (!mmc_spi.dma_channel_get_irq0_status(rx_channel)) {
+        return;
+    }
+    mmc_spi.dma_channel_acknowledge_irq0(rx_channel);
+    owner.finish_dma();
+}
+
 pub const MmcSpi = struct {
     _config: hal.mmc.MmcConfig,
     _miso: u32,
@@ -38,6 +57,11 @@ pub const MmcSpi = struct {
     _cs: u32,
     _sm: u32,
     _pio: mmc_spi.PIO,
+    _tx_dma: i32,
+    _rx_dma: i32,
+    _dma_busy: bool,
+    _on_complete: ?hal.mmc.DmaCallback,
+    _context: ?*anyopaque,
 
     pub fn create(comptime config: hal.mmc.MmcConfig) MmcSpi {
         return .{
@@ -48,6 +72,11 @@ pub const MmcSpi = struct {
             ._cs = config.pins.d0 + 3,
             ._sm = 0,
             ._pio = mmc_spi.pio0,
+            ._tx_dma = -1,
+            ._rx_dma = -1,
+            ._dma_busy = false,
+            ._on_complete = null,
+            ._context = null,
         };
     }
 
@@ -66,6 +95,9 @@ pub const MmcSpi = struct {
         self.init_cs();
         self.chip_select(false);
         try self.initialize_interface();
+        if (self._config.use_dma) {
+            self.initialize_dma();
+        }
         self.enter_native_mode();
     }
 
@@ -145,8 +177,87 @@ pub const MmcSpi = struct {
         mmc_spi.gpio_put(self._sclk, false);
     }
 
-    pub fn transmit_dma() isize {
-        return 0;
+    pub fn transmit_dma(self: *MmcSpi, src: []const u8, dest: ?[]u8, on_complete: hal.mmc.DmaCallback, context: ?*anyopaque) !void {
+        if (dest) |d| {
+            if (d.len < src.len) {
+                return error.InvalidArgument;
+            }
+        }
+        try self.start_dma(src.ptr, if (dest) |d| d.ptr else null, src.len, on_complete, context);
+    }
+
+    pub fn receive_dma(self: *MmcSpi, dest: []u8, on_complete: hal.mmc.DmaCallback, context: ?*anyopaque) !void {
+        try self.start_dma(null, dest.ptr, dest.len, on_complete, context);
+    }
+
+    pub fn is_dma_busy(self: *const MmcSpi) bool {
+        const ptr: *const volatile bool = &self._dma_busy;
+        return ptr.*;
+    }
+
+    // Both channels are paced by PIO DREQs, RX channel finishes last so it signals completion.
+    // Missing src clocks out 0xff, missing dest drops received bytes.
+    fn start_dma(self: *MmcSpi, src: ?[*]const u8, dest: ?[*]u8, len: usize, on_complete: hal.mmc.DmaCallback, context: ?*anyopaque) !void {
+        if (self._tx_dma < 0 or self._rx_dma < 0) {
+            return error.DmaUnavailable;
+        }
+        if (self.is_dma_busy()) {
+            return error.DmaBusy;
+        }
+        if (len == 0) {
+            on_complete(context);
+            return;
+        }
+
+        const pio: *volatile mmc_spi.pio_hw_t = @ptrCast(self._pio);
+        const tx_channel: c_uint = @intCast(self._tx_dma);
+        const rx_channel: c_uint = @intCast(self._rx_dma);
+
+        var rx_config = mmc_spi.dma_channel_get_default_config(rx_channel);
+        mmc_spi.channel_config_set_transfer_data_size(&rx_config, mmc_spi.DMA_SIZE_8);
+        mmc_spi.channel_config_set_read_increment(&rx_config, false);
+        mmc_spi.channel_config_set_write_increment(&rx_config, dest != null);
+        mmc_spi.channel_config_set_dreq(&rx_config, mmc_spi.pio_get_dreq(self._pio, self._sm, false));
+        const write_address: *anyopaque = if (dest) |d| @ptrCast(d) else @ptrCast(&dma_sink);
+        mmc_spi.dma_channel_configure(rx_channel, &rx_config, write_address, @ptrCast(&pio.rxf[self._sm]), @intCast(len), false);
+
+        var tx_config = mmc_spi.dma_channel_get_default_config(tx_channel);
+        mmc_spi.channel_config_set_transfer_data_size(&tx_config, mmc_spi.DMA_SIZE_8);
+        mmc_spi.channel_config_set_read_increment(&tx_config, src != null);
+        mmc_spi.channel_config_set_write_increment(&tx_config, false);
+        mmc_spi.channel_config_set_dreq(&tx_config, mmc_spi.pio_get_dreq(self._pio, self._sm, true));
+        const read_address: *const anyopaque = if (src) |s| @ptrCast(s) else @ptrCast(&dma_filler);
+        mmc_spi.dma_channel_configure(tx_channel, &tx_config, @ptrCast(&pio.txf[self._sm]), read_address, @intCast(len), false);
+
+        self._on_complete = on_complete;
+        self._context = context;
+        const busy: *volatile bool = &self._dma_busy;
+        busy.* = true;
+        dma_owner = self;
+        mmc_spi.dma_start_channel_mask((@as(u32, 1) << @intCast(tx_channel)) | (@as(u32, 1) << @intCast(rx_channel)));
+    }
+
+    fn finish_dma(self: *MmcSpi) linksection(".time_critical") void {
+        mmc_spi.gpio_put(self._sclk, false);
+        dma_owner = null;
+        const busy: *volatile bool = &self._dma_busy;
+        busy.* = false;
+        if (self._on_complete) |callback| {
+            self._on_complete = null;
+            callback(self._context);
+        }
+    }
+
+    fn initialize_dma(self: *MmcSpi) void {
+        self._tx_dma = mmc_spi.dma_claim_unused_channel(false);
+        self._rx_dma = mmc_spi.dma_claim_unused_channel(false);
+        if (self._tx_dma < 0 or self._rx_dma < 0) {
+            log.warn("no free DMA channels, falling back to blocking transfers", .{});
+            return;
+        }
+        mmc_spi.irq_add_shared_handler(mmc_spi.DMA_IRQ_0, on_dma_irq, mmc_spi.PICO_SHARED_IRQ_HANDLER_DEFAULT_ORDER_PRIORITY);
+        mmc_spi.irq_set_enabled(mmc_spi.DMA_IRQ_0, true);
+        mmc_spi.dma_channel_set_irq0_enabled(@intCast(self._rx_dma), true);
     }
 
     fn initialize_interface(self: *MmcSpi) error{PIOInitializationFailure}!void {
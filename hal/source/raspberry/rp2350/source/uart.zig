@@ -37,14 +37,64 @@ pub fn Uart(comptime index: usize, comptime pins: interface.uart.Pins) type {
         const RegisterVolatile = get_volatile_register_address(index);
 
         var rx_buffer: common.utils.RingBuffer(u8, 1024) = common.utils.RingBuffer(u8, 1024).init();
+        // transmission is drained by TX FIFO interrupt, so writers don't spin with interrupts disabled
+        var tx_buffer: common.utils.RingBuffer(u8, 1024) = common.utils.RingBuffer(u8, 1024).init();
         var is_initialized: bool = false;
+        var rx_callback: ?interface.uart.RxCallback = null;
+        var rx_callback_context: ?*anyopaque = null;
+        var tx_callback: ?interface.uart.TxCallback = null;
+        var tx_callback_context: ?*anyopaque = null;
 
         fn uart_is_readable() linksection(".time_critical") bool {
             const derived_ptr = &RegisterVolatile.*.fr;
             return (derived_ptr.* & picosdk.UART_UARTFR_RXFE_BITS) == 0;
         }
 
-        fn on_uart_rx_irq() linksection(".time_critical") callconv(.c) void {
+        fn uart_is_writable() linksection(".time_critical") bool {
+            const derived_ptr = &RegisterVolatile.*.fr;
+            return (derived_ptr.* & picosdk.UART_UARTFR_TXFF_BITS) == 0;
+        }
+
+        fn fill_tx_fifo() linksection(".time_critical") void {
+            const derived_ptr = &RegisterVolatile.*.dr;
+            while (uart_is_writable()) {
+                const byte = tx_buffer.pop() orelse break;
+                derived_ptr.* = byte;
+            }
+        }
+
+        // queue is drained by UART interrupt, which is not taken with interrupts masked
+        // or while exception handler (i.e. HardFault) of the same or higher priority runs
+        fn queue_is_not_drained() bool {
+            const primask = asm volatile ("mrs %[ret], primask"
+                : [ret] "=r" (-> u32),
+            );
+            const ipsr = asm volatile ("mrs %[ret], ipsr"
+                : [ret] "=r" (-> u32),
+            );
+            return (primask & 1) != 0 or (ipsr & 0x1ff) != 0;
+        }
+
+        // transmit queue is shared by all writers and interrupt handler
+        fn lock() u32 {
+            return asm volatile (
+                \\ mrs %[ret], PRIMASK
+                \\ cpsid i
+                : [ret] "=r" (-> u32),
+                :
+                : .{ .memory = true });
+        }
+
+        fn unlock(primask: u32) void {
+            asm volatile (
+                \\ msr PRIMASK, %[mask]
+                :
+                : [mask] "r" (primask),
+                : .{ .memory = true });
+        }
+
+        fn on_uart_irq() linksection(".time_critical") callconv(.c) void {
+            var received = false;
             while (uart_is_readable()) {
                 const derived_ptr = &RegisterVolatile.*.dr;
                 const byte: u32 = derived_ptr.*;
@@ -53,6 +103,22 @@ pub fn Uart(comptime index: usize, comptime pins: interface.uart.Pins) type {
                     RegisterVolatile.*.icr = 0;
                 }
                 rx_buffer.push(@truncate(byte));
+                received = true;
+            }
+            if (received) {
+                if (rx_callback) |callback| {
+                    callback(rx_callback_context);
+                }
+            }
+
+            if (!tx_buffer.is_empty()) {
+                fill_tx_fifo();
+                if (tx_buffer.is_empty()) {
+                    picosdk.uart_set_irq_enables(Register, true, false);
+                }
+                if (tx_callback) |callback| {
+                    callback(tx_callback_context);
+                }
             }
         }
 
@@ -68,7 +134,7 @@ pub fn Uart(comptime index: usize, comptime pins: interface.uart.Pins) type {
             picosdk.uart_set_hw_flow(Register, false, false);
             picosdk.uart_set_format(Register, 8, 1, picosdk.UART_PARITY_NONE);
 
-            picosdk.irq_set_exclusive_handler(get_rx_interrupt_id(index), on_uart_rx_irq);
+            picosdk.irq_set_exclusive_handler(get_rx_interrupt_id(index), on_uart_irq);
             picosdk.irq_set_enabled(get_rx_interrupt_id(index), true);
             picosdk.irq_set_priority(get_rx_interrupt_id(index), 0x01);
             picosdk.uart_set_irq_enables(Register, true, false);
@@ -95,15 +161,38 @@ pub fn Uart(comptime index: usize, comptime pins: interface.uart.Pins) type {
             return byte.?;
         }
 
+        // queues as much data as fits in transmit buffer, returns number of queued bytes
         pub fn write(self: Self, data: []const u8) !usize {
-            asm volatile ("cpsid i" ::: .{ .memory = true });
+            if (!is_initialized or queue_is_not_drained()) {
+                // nothing would drain the queue, i.e. early boot, fault or panic handler
+                self.write_blocking(data);
+                return data.len;
+            }
+            const state = lock();
+            defer unlock(state);
+            const queued = @min(data.len, tx_buffer.free_space());
+            for (data[0..queued]) |byte| {
+                tx_buffer.push(byte);
+            }
+            fill_tx_fifo();
+            if (!tx_buffer.is_empty()) {
+                picosdk.uart_set_irq_enables(Register, true, true);
+            }
+            return queued;
+        }
+
+        fn write_blocking(self: Self, data: []const u8) void {
+            const state = lock();
+            defer unlock(state);
             const derived_ptr = &RegisterVolatile.*.dr;
+            // already queued data goes first to keep ordering
+            while (!tx_buffer.is_empty()) {
+                fill_tx_fifo();
+            }
             for (data) |byte| {
                 while (!self.is_writable()) {}
                 derived_ptr.* = byte;
             }
-            asm volatile ("cpsie i" ::: .{ .memory = true });
-            return data.len;
         }
 
         pub fn read(self: Self, buffer: []u8) !usize {
@@ -112,6 +201,11 @@ pub fn Uart(comptime index: usize, comptime pins: interface.uart.Pins) type {
         }
 
         pub fn flush(_: Self) void {
+            while (!tx_buffer.is_empty()) {
+                const state = lock();
+                fill_tx_fifo();
+                unlock(state);
+            }
             const uart_hw: *volatile picosdk.uart_hw_t = @ptrCast(picosdk.uart_get_hw(Register));
             const derived_ptr = &uart_hw.*.fr;
             while ((derived_ptr.* & picosdk.UART_UARTFR_BUSY_BITS) != 0) {}
@@ -123,6 +217,24 @@ pub fn Uart(comptime index: usize, comptime pins: interface.uart.Pins) type {
             return rx_buffer.size();
         }
 
+        pub fn bytes_to_write(_: Self) usize {
+            return tx_buffer.size();
+        }
+
+        pub fn set_tx_callback(_: Self, callback: ?interface.uart.TxCallback, context: ?*anyopaque) void {
+            picosdk.irq_set_enabled(get_rx_interrupt_id(index), false);
+            tx_callback_context = context;
+            tx_callback = callback;
+            picosdk.irq_set_enabled(get_rx_interrupt_id(index), is_initialized);
+        }
+
+        pub fn set_rx_callback(_: Self, callback: ?interface.uart.RxCallback, context: ?*anyopaque) void {
+            picosdk.irq_set_enabled(get_rx_interrupt_id(index), false);
+            rx_callback_context = context;
+            rx_callback = callback;
+            picosdk.irq_set_enabled(get_rx_interrupt_id(index), is_initialized);
+        }
+
         fn get_rx_interrupt_id(comptime id: u32) u32 {
             if (id == 1) {
                 return picosdk.UART1_IRQ;
@@ -30,6 +30,8 @@ pub const MmcStub = struct {
     receive_data: ?std.ArrayList([]u8),
     should_fail_init: bool,
     busy_count: usize,
+    dma_count: usize,
+    dma_enabled: bool,
 
     pub fn create(config: hal.mmc.MmcConfig) MmcStub {
         return MmcStub{
@@ -46,6 +48,8 @@ pub const MmcStub = struct {
             .receive_data = null,
             .should_fail_init = false,
             .busy_count = 0,
+            .dma_count = 0,
+            .dma_enabled = true,
         };
     }
 
@@ -72,6 +76,8 @@ pub const MmcStub = struct {
         self.last_command = 0;
         self.last_argument = 0;
         self.busy_count = 0;
+        self.dma_count = 0;
+        self.dma_enabled = true;
         if (self.receive_data) |*r| {
             for (r.items) |item| {
                 std.debug.print("Unconsumed receive data: {x}\n", .{item});
@@ -139,6 +145,31 @@ pub const MmcStub = struct {
         std.testing.allocator.free(data);
     }
 
+    // DMA transfers are completed synchronously, completion callback is
+    // called before returning to mimic transfer finished interrupt
+    pub fn transmit_dma(self: *MmcStub, src: []const u8, dest: ?[]u8, on_complete: hal.mmc.DmaCallback, context: ?*anyopaque) !void {
+        if (!self.dma_enabled) {
+            return error.DmaUnavailable;
+        }
+        self.dma_count += 1;
+        self.transmit_blocking(src, dest);
+        on_complete(context);
+    }
+
+    pub fn receive_dma(self: *MmcStub, dest: []u8, on_complete: hal.mmc.DmaCallback, context: ?*anyopaque) !void {
+        if (!self.dma_enabled) {
+            return error.DmaUnavailable;
+        }
+        self.dma_count += 1;
+        self.receive_blocking(dest);
+        on_complete(context);
+    }
+
+    pub fn is_dma_busy(self: *const MmcStub) bool {
+        _ = self;
+        return false;
+    }
+
     pub fn chip_select(self: *MmcStub, select: bool) void {
         self.chip_selected = select;
     }
@@ -176,6 +207,10 @@ pub const MmcStub = struct {
         return d;
     }
 
+    pub fn set_dma_enabled(self: *MmcStub, enabled: bool) void {
+        self.dma_enabled = enabled;
+    }
+
     pub fn set_init_fail(self: *MmcStub, should_fail: bool) void {
         self.should_fail_init = should_fail;
     }
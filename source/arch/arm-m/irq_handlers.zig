@@ -23,6 +23,7 @@
 
 const std = @import("std");
 const hal = @import("hal");
+const board = @import("board");
 const arch = @import("assembly.zig");
 
 const c = @cImport({
@@ -56,6 +57,8 @@ export fn irq_hard_fault() void {
     );
     log.err("  PSP=0x{X:0>8} MSP=0x{X:0>8} PSPLIM=0x{X:0>8} MSPLIM=0x{X:0>8}", .{ psp, msp, psplim, msplim });
     log.err("  CFSR=0x{X:0>8} HFSR=0x{X:0>8} MMFAR=0x{X:0>8} BFAR=0x{X:0>8}", .{ cfsr_raw, hfsr_raw, mmfar, bfar });
+    // diagnostics must reach terminal even if panic handler faults again
+    board.uart.uart0.flush();
 
     @panic("Hard fault occured");
     // while (true) {
@@ -25,7 +25,6 @@ const fatfs = @import("zfat");
 const c = @import("libc_imports").c;
 
 const kernel = @import("kernel");
-const arch = @import("arch");
 
 const log = std.log.scoped(.@"fs/fatfs");
 
@@ -34,6 +33,7 @@ const FatFsDirectory = @import("fatfs_directory.zig").FatFsDirectory;
 const FatFsIterator = @import("fatfs_directory.zig").FatFsIterator;
 
 const fatfs_error_to_errno = @import("errno_converter.zig").fatfs_error_to_errno;
+const volume = @import("volume.zig");
 
 var global_fs: fatfs.FileSystem = undefined;
 var workspace_buffer: [4096]u8 = undefined;
@@ -55,6 +55,8 @@ pub const FatFs = oop.DeriveFromBase(kernel.fs.IFileSystem, struct {
 
     pub fn mount(self: *Self) i32 {
         log.debug("Mounting FAT filesystem", .{});
+        volume.acquire();
+        defer volume.release();
         fatfs.disks[0] = &self._disk_wrapper.interface;
         global_fs.mount("0:", true) catch |err| {
             log.err("Failed to mount FAT filesystem: {s}", .{@errorName(err)});
@@ -72,6 +74,8 @@ pub const FatFs = oop.DeriveFromBase(kernel.fs.IFileSystem, struct {
     pub fn umount(self: *Self) i32 {
         log.debug("Unmounting FAT filesystem", .{});
         _ = self;
+        volume.acquire();
+        defer volume.release();
         fatfs.FileSystem.unmount("0:") catch |err| {
             log.err("Failed to unmount FAT filesystem: {s}", .{@errorName(err)});
             return -1;
@@ -83,6 +87,8 @@ pub const FatFs = oop.DeriveFromBase(kernel.fs.IFileSystem, struct {
         log.info("Creating file at path: {s}", .{path});
         const filepath = try self._allocator.dupeZ(u8, path);
         defer self._allocator.free(filepath);
+        volume.acquire();
+        defer volume.release();
         var file = try fatfs.File.create(filepath);
         file.close();
     }
@@ -91,6 +97,8 @@ pub const FatFs = oop.DeriveFromBase(kernel.fs.IFileSystem, struct {
         log.info("Creating directory at path: {s}", .{path});
         const filepath = try self._allocator.dupeZ(u8, path);
         defer self._allocator.free(filepath);
+        volume.acquire();
+        defer volume.release();
         _ = fatfs.mkdir(filepath) catch |err| {
             return fatfs_error_to_errno(err);
         };
@@ -100,6 +108,8 @@ pub const FatFs = oop.DeriveFromBase(kernel.fs.IFileSystem, struct {
         log.info("Removing file or directory at path: {s}", .{path});
         const filepath = try self._allocator.dupeZ(u8, path);
         defer self._allocator.free(filepath);
+        volume.acquire();
+        defer volume.release();
         try fatfs.unlink(filepath);
     }
 
@@ -111,6 +121,9 @@ pub const FatFs = oop.DeriveFromBase(kernel.fs.IFileSystem, struct {
     pub fn get(self: *Self, path: []const u8) anyerror!kernel.fs.Node {
         const filepath = try self._allocator.dupeZ(u8, path);
         defer self._allocator.free(filepath);
+        // nodes open FatFs objects on creation, so they are created under the same lock
+        volume.acquire();
+        defer volume.release();
 
         var dir: ?fatfs.Dir = fatfs.Dir.open(filepath) catch blk: {
             break :blk null;
@@ -126,15 +139,18 @@ pub const FatFs = oop.DeriveFromBase(kernel.fs.IFileSystem, struct {
     pub fn format(self: *Self) anyerror!void {
         log.info("Formatting FAT filesystem", .{});
 
+        volume.acquire();
         fatfs.disks[0] = &self._disk_wrapper.interface;
         fatfs.mkfs(
             "0:",
             .{ .filesystem = .fat32, .sector_align = 1, .use_partitions = false },
             &workspace_buffer,
         ) catch |err| {
+            volume.release();
             log.err("Failed to format FAT filesystem: {s}", .{@errorName(err)});
             return err;
         };
+        volume.release();
         _ = self.umount();
         _ = self.mount();
     }
@@ -157,9 +173,12 @@ pub const FatFs = oop.DeriveFromBase(kernel.fs.IFileSystem, struct {
         var path_c = try std.fmt.allocPrintSentinel(self._allocator, "0:/{s} ", .{path}, 0);
         path_c[path_c.len - 1] = 0; // Null-terminate
         defer self._allocator.free(path_c);
+        volume.acquire();
         const finfo = fatfs.stat(path_c) catch |err| {
+            volume.release();
             return fatfs_error_to_errno(err);
         };
+        volume.release();
         data.st_blksize = 512;
         data.st_size = @intCast(finfo.size);
         data.st_mode = if (finfo.kind == .Directory) c.S_IFDIR else c.S_IFREG;
@@ -193,6 +212,8 @@ pub const FatFs = oop.DeriveFromBase(kernel.fs.IFileSystem, struct {
     const DiskWrapper = struct {
         const sector_size = 512;
         device: kernel.fs.IFile,
+        // seek and transfer on shared device handle must not interleave
+        lock: kernel.sync.IoLock = .{},
 
         interface: fatfs.Disk = fatfs.Disk{
             .getStatusFn = &getStatus,
@@ -217,9 +238,9 @@ pub const FatFs = oop.DeriveFromBase(kernel.fs.IFileSystem, struct {
         }
 
         pub fn read(interface: *fatfs.Disk, buff: [*]u8, sector: fatfs.LBA, count: c_uint) fatfs.Disk.Error!void {
-            const state = arch.sync.save_and_disable_interrupts();
-            defer arch.sync.restore_interrupts(state);
             const self: *DiskWrapper = @fieldParentPtr("interface", interface);
+            self.lock.lock();
+            defer self.lock.unlock();
             const position = self.device.interface.seek(@as(i64, @intCast(sector)) * sector_size, c.SEEK_SET) catch return error.IoError;
             if (position < 0) return error.IoError;
             if (self.device.interface.read(buff[0 .. sector_size * count]) != sector_size * count) {
@@ -228,9 +249,9 @@ pub const FatFs = oop.DeriveFromBase(kernel.fs.IFileSystem, struct {
         }
 
         pub fn write(interface: *fatfs.Disk, buff: [*]const u8, sector: fatfs.LBA, count: c_uint) fatfs.Disk.Error!void {
-            const state = arch.sync.save_and_disable_interrupts();
-            defer arch.sync.restore_interrupts(state);
             const self: *DiskWrapper = @fieldParentPtr("interface", interface);
+            self.lock.lock();
+            defer self.lock.unlock();
             log.debug("Writing to sector {d}, count {d}", .{ sector, count });
             const position = self.device.interface.seek(@as(i64, @intCast(sector)) * sector_size, c.SEEK_SET) catch return error.IoError;
             if (position < 0) return error.IoError;
@@ -240,11 +261,13 @@ pub const FatFs = oop.DeriveFromBase(kernel.fs.IFileSystem, struct {
         }
 
         pub fn ioctl(interface: *fatfs.Disk, cmd: fatfs.IoCtl, buff: [*]u8) fatfs.Disk.Error!void {
-            const state = arch.sync.save_and_disable_interrupts();
-            defer arch.sync.restore_interrupts(state);
             const self: *DiskWrapper = @fieldParentPtr("interface", interface);
             switch (cmd) {
-                .sync => {},
+                .sync => {
+                    if (self.device.interface.sync() != 0) {
+                        return error.IoError;
+                    }
+                },
                 .get_sector_count => {
                     const size = self.device.interface.size();
                     @as(*align(1) fatfs.LBA, @ptrCast(buff)).* = @intCast(size >> 9);
@@ -327,6 +350,25 @@ test "FatFs.ShouldCreateFile" {
     try std.testing.expectError(kernel.errno.ErrnoSet.NoEntry, fs.interface.get("/test.txt"));
 }
 
+test "FatFs.ShouldReleaseVolumeLockAfterEachOperation" {
+    var fs = try create_fs_for_test();
+    defer fs.interface.delete();
+
+    try fs.interface.format();
+    try std.testing.expect(!volume.is_locked());
+    _ = fs.interface.mount();
+    defer _ = fs.interface.umount();
+
+    try create_write_and_verify(&fs, "/lock.txt", "data");
+    try std.testing.expect(!volume.is_locked());
+    try traverse_directory(&fs, "/", &[_]kernel.fs.DirectoryEntry{
+        .{ .name = "lock.txt", .kind = kernel.fs.FileType.File },
+    });
+    try std.testing.expect(!volume.is_locked());
+    try std.testing.expectError(kernel.errno.ErrnoSet.NoEntry, fs.interface.get("/missing.txt"));
+    try std.testing.expect(!volume.is_locked());
+}
+
 test "FatFs.ShouldCreateDirectory" {
     var fs = try create_fs_for_test();
     defer fs.interface.delete();
@@ -20,6 +20,8 @@ const fatfs = @import("zfat");
 
 const kernel = @import("kernel");
 
+const volume = @import("volume.zig");
+
 pub const FatFsIterator = interface.DeriveFromBase(kernel.fs.IDirectoryIterator, struct {
     const Self = @This();
     _dir: fatfs.Dir,
@@ -35,7 +37,12 @@ pub const FatFsIterator = interface.DeriveFromBase(kernel.fs.IDirectoryIterator,
     }
 
     pub fn next(self: *Self) ?kernel.fs.DirectoryEntry {
-        const maybe_entry = self._dir.next() catch return null;
+        volume.acquire();
+        const maybe_entry = self._dir.next() catch {
+            volume.release();
+            return null;
+        };
+        volume.release();
         if (maybe_entry) |entry| {
             if (self._name) |old_name| {
                 self._allocator.free(old_name);
@@ -53,6 +60,8 @@ pub const FatFsIterator = interface.DeriveFromBase(kernel.fs.IDirectoryIterator,
         if (self._name) |name| {
             self._allocator.free(name);
         }
+        volume.acquire();
+        defer volume.release();
         self._dir.close();
     }
 });
@@ -64,6 +73,7 @@ pub const FatFsDirectory = interface.DeriveFromBase(kernel.fs.IDirectory, struct
 
     const Self = @This();
 
+    // called with volume lock held
     pub fn create(allocator: std.mem.Allocator, path: [:0]const u8) !FatFsDirectory {
         const maybe_stat: ?fatfs.FileInfo = fatfs.stat(path) catch null;
         var dirname: []const u8 = undefined;
@@ -92,6 +102,8 @@ pub const FatFsDirectory = interface.DeriveFromBase(kernel.fs.IDirectory, struct
     }
 
     pub fn iterator(self: *const Self) anyerror!kernel.fs.IDirectoryIterator {
+        volume.acquire();
+        defer volume.release();
         var dir = try fatfs.Dir.open(self._path);
         return FatFsIterator.InstanceType.create(dir, self._allocator).interface.new(self._allocator) catch {
             dir.close();
@@ -29,6 +29,7 @@ const c = @import("libc_imports").c;
 const kernel = @import("kernel");
 
 const fatfs_error_to_errno = @import("errno_converter.zig").fatfs_error_to_errno;
+const volume = @import("volume.zig");
 
 const log = kernel.log;
 
@@ -42,6 +43,7 @@ pub const FatFsFile = interface.DeriveFromBase(kernel.fs.IFile, struct {
     _name: []const u8,
     _filetype: kernel.fs.FileType,
 
+    // called with volume lock held
     pub fn create(allocator: std.mem.Allocator, path: [:0]const u8) !FatFsFile {
         const filename = try allocator.dupe(u8, std.fs.path.basename(path));
         errdefer allocator.free(filename);
@@ -64,6 +66,8 @@ pub const FatFsFile = interface.DeriveFromBase(kernel.fs.IFile, struct {
 
     pub fn read(self: *Self, buffer: []u8) isize {
         if (self._file) |*file| {
+            volume.acquire();
+            defer volume.release();
             const s = file.read(buffer) catch return -1;
             return @as(isize, @intCast(s));
         }
@@ -72,6 +76,8 @@ pub const FatFsFile = interface.DeriveFromBase(kernel.fs.IFile, struct {
 
     pub fn write(self: *Self, data: []const u8) isize {
         if (self._file) |*file| {
+            volume.acquire();
+            defer volume.release();
             const s = file.write(data) catch return -1;
             return @as(isize, @intCast(s));
         }
@@ -82,6 +88,8 @@ pub const FatFsFile = interface.DeriveFromBase(kernel.fs.IFile, struct {
     pub fn seek(self: *Self, offset: i64, whence: i32) anyerror!i64 {
         var new_position: i64 = 0;
         if (self._file) |*file| {
+            volume.acquire();
+            defer volume.release();
             const file_size: i64 = @intCast(file.size());
             switch (whence) {
                 c.SEEK_SET => {
@@ -107,6 +115,8 @@ pub const FatFsFile = interface.DeriveFromBase(kernel.fs.IFile, struct {
 
     pub fn sync(self: *Self) i32 {
         if (self._file) |*file| {
+            volume.acquire();
+            defer volume.release();
             file.sync() catch return -1;
         }
         return 0;
@@ -155,7 +165,9 @@ pub const FatFsFile = interface.DeriveFromBase(kernel.fs.IFile, struct {
         }
         self._is_open = false;
         if (self._file) |*file| {
+            volume.acquire();
             file.close();
+            volume.release();
             self._file = null;
         }
         self._allocator.free(self._name);
@@ -20,6 +20,7 @@ comptime {
     _ = @import("fatfs_directory.zig");
     _ = @import("fatfs.zig");
     _ = @import("fatfs_file.zig");
+    _ = @import("volume.zig");
 }
 
 test {
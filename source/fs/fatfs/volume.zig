@@ -0,0 +1,36 @@
+// Copyright (c) 2025 Mateusz Stadnik
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program. If not, see <https://www.gnu.org/licenses/>.
+
+const kernel = @import("kernel");
+
+// FatFs is built without FF_FS_REENTRANT, so volume state (i.e. sector window)
+// is shared by every file and directory of the volume. Disk callbacks block
+// the caller, so every call into FatFs must hold the volume lock, otherwise
+// another process may use the window in the middle of an operation.
+// Only the single "0:" volume is mounted, so there is a single lock.
+
+var lock: kernel.sync.IoLock = .{};
+
+pub fn acquire() void {
+    lock.lock();
+}
+
+pub fn release() void {
+    lock.unlock();
+}
+
+pub fn is_locked() bool {
+    return lock.is_locked();
+}
@@ -76,7 +76,8 @@ pub const RamFs = interface.DeriveFromBase(IFileSystem, struct {
         return try self._root.clone();
     }
 
-    pub fn create(self: *Self, path: []const u8, _: i32) anyerror!void {
+    // S_IFIFO in mode creates named FIFO instead of regular file
+    pub fn create(self: *Self, path: []const u8, mode: i32) anyerror!void {
         if (path.len == 0) {
             return kernel.errno.ErrnoSet.InvalidArgument;
         }
@@ -95,12 +96,17 @@ pub const RamFs = interface.DeriveFromBase(IFileSystem, struct {
         defer parent_node.delete();
         var maybe_parent_dir = parent_node.as_directory();
         if (maybe_parent_dir) |*parent_dir| {
-            const filedata = try self._allocator.create(RamFsData);
-            filedata.* = try RamFsData.create(self._allocator);
             const filenode = try self._allocator.create(RamFsNode);
             const filename = try self._allocator.dupe(u8, basename);
+            const node = if ((mode & c.S_IFMT) == c.S_IFIFO)
+                try kernel.fs.create_fifo_node(self._allocator, filename)
+            else blk: {
+                const filedata = try self._allocator.create(RamFsData);
+                filedata.* = try RamFsData.create(self._allocator);
+                break :blk try RamFsFile.InstanceType.create_node(self._allocator, filedata, filename);
+            };
             filenode.* = RamFsNode{
-                .node = try RamFsFile.InstanceType.create_node(self._allocator, filedata, filename),
+                .node = node,
                 .list_node = std.DoublyLinkedList.Node{},
                 .name = filename,
             };
@@ -177,6 +183,7 @@ pub const RamFs = interface.DeriveFromBase(IFileSystem, struct {
         data.st_mode = switch (node.filetype()) {
             .File => c.S_IFREG,
             .Directory => c.S_IFDIR,
+            .Fifo => c.S_IFIFO,
             else => return,
         };
         return;
@@ -218,6 +225,9 @@ pub const RamFs = interface.DeriveFromBase(IFileSystem, struct {
         if (node.filetype() == FileType.Directory) {
             return kernel.errno.ErrnoSet.IsADirectory;
         }
+        if (node.filetype() == FileType.Fifo) {
+            return kernel.errno.ErrnoSet.NotPermitted;
+        }
 
         var parent_node = try self.get_parent_node(new_path);
         defer parent_node.delete();
@@ -406,6 +416,37 @@ test "RamFs.StatShouldWork" {
     try std.testing.expectEqual(c.S_IFREG, @as(c_int, @intCast(stat_data.st_mode)));
 }
 
+test "RamFs.ShouldCreateNamedFifo" {
+    var fs = try RamFs.InstanceType.init(std.testing.allocator);
+    var sut = fs.interface.create();
+    defer _ = sut.interface.delete();
+
+    try sut.interface.create("/fifo", c.S_IFIFO);
+    var stat_data: c.struct_stat = undefined;
+    try sut.interface.stat("/fifo", &stat_data, true);
+    try std.testing.expectEqual(c.S_IFIFO, @as(c_int, @intCast(stat_data.st_mode)));
+    try std.testing.expectError(kernel.errno.ErrnoSet.NotPermitted, sut.interface.link("/fifo", "/fifo2"));
+
+    // every opener shares the same pipe
+    var writer_node = try sut.interface.get("/fifo");
+    defer writer_node.delete();
+    var reader_node = try sut.interface.get("/fifo");
+    defer reader_node.delete();
+    var writer = writer_node.as_file().?;
+    var reader = reader_node.as_file().?;
+    var flags: c_int = c.O_RDONLY | c.O_NONBLOCK;
+    try std.testing.expectEqual(0, reader.interface.ioctl(@intFromEnum(kernel.fs.IoctlCommonCommands.OpenFifo), &flags));
+    flags = c.O_WRONLY;
+    try std.testing.expectEqual(0, writer.interface.ioctl(@intFromEnum(kernel.fs.IoctlCommonCommands.OpenFifo), &flags));
+    try std.testing.expectEqual(4, writer.interface.write("test"));
+    var buffer: [4]u8 = undefined;
+    try std.testing.expectEqual(4, reader.interface.read(&buffer));
+    try std.testing.expectEqualStrings("test", &buffer);
+
+    try sut.interface.unlink("/fifo");
+    try std.testing.expect(!has_path(&sut, "/fifo"));
+}
+
 test "RamFs.AccessShouldWork" {
     var fs = try RamFs.InstanceType.init(std.testing.allocator);
     var sut = fs.interface.create();
@@ -0,0 +1,214 @@
+//
+// dentry_cache.zig
+//
+// Copyright (C) 2025 Mateusz Stadnik <matgla@live.com>
+//
+// This program is free software: you can redistribute it and/or
+// modify it under the terms of the GNU General Public License
+// as published by the Free Software Foundation, either version
+// 3 of the License, or (at your option) any later version.
+//
+// This program is distributed in the hope that it will be
+// useful, but WITHOUT ANY WARRANTY; without even the implied
+// warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR
+// PURPOSE. See the GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General
+// Public License along with this program. If not, see
+// <https://www.gnu.org/licenses/>.
+//
+
+const std = @import("std");
+
+const c = @import("libc_imports").c;
+
+const kernel = @import("kernel");
+
+// Lookups run in preemptible syscall context, so map is accessed only with
+// interrupts masked. Allocations are made outside of it.
+const CacheLock = kernel.sync.IrqLock;
+
+// Maps resolved paths to file header offsets. RomFs is read-only, so entries
+// never go stale, including negative ones (null offset) for missing paths.
+// Cache holds at most capacity entries, the oldest one is replaced when full.
+pub const DentryCache = struct {
+    const Self = @This();
+
+    const Key = struct {
+        path: []const u8,
+        resolve_link: bool,
+    };
+
+    const KeyContext = struct {
+        pub fn hash(_: KeyContext, key: Key) u64 {
+            var hasher = std.hash.Wyhash.init(0);
+            hasher.update(key.path);
+            hasher.update(&.{@intFromBool(key.resolve_link)});
+            return hasher.final();
+        }
+
+        pub fn eql(_: KeyContext, a: Key, b: Key) bool {
+            return a.resolve_link == b.resolve_link and std.mem.eql(u8, a.path, b.path);
+        }
+    };
+
+    pub const Lookup = union(enum) {
+        miss,
+        found: c.off_t,
+        not_found,
+    };
+
+    _allocator: std.mem.Allocator,
+    _map: std.HashMapUnmanaged(Key, ?c.off_t, KeyContext, std.hash_map.default_max_load_percentage),
+    // insertion order, used to select entry for replacement
+    _order: []Key,
+    _next: usize,
+    _hits: usize,
+    _misses: usize,
+
+    pub fn init(allocator: std.mem.Allocator, capacity: usize) !DentryCache {
+        var map: std.HashMapUnmanaged(Key, ?c.off_t, KeyContext, std.hash_map.default_max_load_percentage) = .empty;
+        try map.ensureTotalCapacity(allocator, @intCast(capacity));
+        errdefer map.deinit(allocator);
+        const order = try allocator.alloc(Key, capacity);
+        for (order) |*key| {
+            key.* = .{ .path = &.{}, .resolve_link = false };
+        }
+        return .{
+            ._allocator = allocator,
+            ._map = map,
+            ._order = order,
+            ._next = 0,
+            ._hits = 0,
+            ._misses = 0,
+        };
+    }
+
+    pub fn deinit(self: *Self) void {
+        for (self._order) |key| {
+            if (key.path.len != 0) {
+                self._allocator.free(key.path);
+            }
+        }
+        self._allocator.free(self._order);
+        self._map.deinit(self._allocator);
+    }
+
+    pub fn get(self: *Self, path: []const u8, resolve_link: bool) Lookup {
+        const state = CacheLock.lock();
+        defer CacheLock.unlock(state);
+        const maybe_entry = self._map.get(.{ .path = path, .resolve_link = resolve_link });
+        if (maybe_entry) |entry| {
+            self._hits += 1;
+            if (entry) |offset| {
+                return .{ .found = offset };
+            }
+            return .not_found;
+        }
+        self._misses += 1;
+        return .miss;
+    }
+
+    // offset equal to null marks path as not existing
+    pub fn put(self: *Self, path: []const u8, resolve_link: bool, offset: ?c.off_t) void {
+        if (self._order.len == 0 or path.len == 0) {
+            return;
+        }
+        if (self.update(path, resolve_link, offset)) {
+            return;
+        }
+        // caching is optional, lookup still works without entry
+        const owned_path = self._allocator.dupe(u8, path) catch return;
+        const replaced = self.insert(owned_path, resolve_link, offset);
+        if (replaced.len != 0) {
+            self._allocator.free(replaced);
+        }
+    }
+
+    fn update(self: *Self, path: []const u8, resolve_link: bool, offset: ?c.off_t) bool {
+        const state = CacheLock.lock();
+        defer CacheLock.unlock(state);
+        if (self._map.getPtr(.{ .path = path, .resolve_link = resolve_link })) |entry| {
+            entry.* = offset;
+            return true;
+        }
+        return false;
+    }
+
+    // returns path of replaced entry, it must be released by caller
+    fn insert(self: *Self, owned_path: []const u8, resolve_link: bool, offset: ?c.off_t) []const u8 {
+        const state = CacheLock.lock();
+        defer CacheLock.unlock(state);
+        const key = Key{ .path = owned_path, .resolve_link = resolve_link };
+        // other process may have inserted same path in the meantime
+        if (self._map.getPtr(key)) |entry| {
+            entry.* = offset;
+            return owned_path;
+        }
+        const slot = &self._order[self._next];
+        const replaced = slot.path;
+        if (replaced.len != 0) {
+            _ = self._map.remove(slot.*);
+        }
+        slot.* = key;
+        self._map.putAssumeCapacity(key, offset);
+        self._next = (self._next + 1) % self._order.len;
+        return replaced;
+    }
+
+    pub fn get_hits(self: *const Self) usize {
+        return self._hits;
+    }
+
+    pub fn get_misses(self: *const Self) usize {
+        return self._misses;
+    }
+};
+
+test "DentryCache.ShouldReturnMissForUnknownPath" {
+    var sut = try DentryCache.init(std.testing.allocator, 4);
+    defer sut.deinit();
+
+    try std.testing.expectEqual(DentryCache.Lookup.miss, sut.get("/bin/sh", true));
+    try std.testing.expectEqual(1, sut.get_misses());
+}
+
+test "DentryCache.ShouldCachePositiveAndNegativeEntries" {
+    var sut = try DentryCache.init(std.testing.allocator, 4);
+    defer sut.deinit();
+
+    var path_buffer = "/bin/sh".*;
+    sut.put(&path_buffer, true, 0x120);
+    sut.put("/bin/missing", true, null);
+    // key must be copied, caller buffers are not kept
+    path_buffer[1] = 'x';
+
+    try std.testing.expectEqual(DentryCache.Lookup{ .found = 0x120 }, sut.get("/bin/sh", true));
+    try std.testing.expectEqual(DentryCache.Lookup.not_found, sut.get("/bin/missing", true));
+    try std.testing.expectEqual(DentryCache.Lookup.miss, sut.get("/bin/sh", false));
+    try std.testing.expectEqual(2, sut.get_hits());
+}
+
+test "DentryCache.ShouldReplaceOldestEntryWhenFull" {
+    var sut = try DentryCache.init(std.testing.allocator, 2);
+    defer sut.deinit();
+
+    sut.put("/a", true, 1);
+    sut.put("/b", true, 2);
+    sut.put("/a", true, 3);
+    sut.put("/c", true, 4);
+
+    try std.testing.expectEqual(DentryCache.Lookup.miss, sut.get("/a", true));
+    try std.testing.expectEqual(DentryCache.Lookup{ .found = 2 }, sut.get("/b", true));
+    try std.testing.expectEqual(DentryCache.Lookup{ .found = 4 }, sut.get("/c", true));
+}
+
+test "DentryCache.ShouldOverwriteExistingEntry" {
+    var sut = try DentryCache.init(std.testing.allocator, 1);
+    defer sut.deinit();
+
+    sut.put("/a", true, 1);
+    sut.put("/b", true, 2);
+    sut.put("/b", true, 3);
+    try std.testing.expectEqual(DentryCache.Lookup{ .found = 3 }, sut.get("/b", true));
+}
@@ -57,10 +57,16 @@ pub const FileHeader = struct {
     _specinfo: u32,
 
     pub fn init(device_file: IFile, start_offset: c.off_t, filesystem_offset: c.off_t, mapped_address: ?*const anyopaque, allocator: std.mem.Allocator) !FileHeader {
-        var reader = try FileReader.init(device_file, @intCast(start_offset));
+        // mapped_address points to filesystem start, reader needs beginning of device window
+        var device_memory: ?[*]const u8 = null;
+        if (mapped_address) |address| {
+            device_memory = @as([*]const u8, @ptrCast(address)) - @as(usize, @intCast(filesystem_offset));
+        }
+        var reader = try FileReader.init(device_file, @intCast(start_offset), device_memory);
         const fileheader = try reader.read(u32, 0);
         const ft = FileHeader.convert_filetype(@enumFromInt(fileheader & 0x7));
-        const name_buffer = reader.read_string(allocator, 16) catch "";
+        // name is referenced in place when filesystem is memory mapped
+        const name_buffer: []const u8 = reader.get_string(16) orelse (reader.read_string(allocator, 16) catch "");
         const specinfo_data = try reader.read(u32, 4);
         const size_data = try reader.read(u32, 8);
 
@@ -78,7 +84,9 @@ pub const FileHeader = struct {
     }
 
     pub fn deinit(self: *FileHeader) void {
-        self._allocator.free(self._name);
+        if (!self._reader.is_memory_mapped()) {
+            self._allocator.free(self._name);
+        }
     }
 
     fn convert_filetype(ft: Type) FileType {
@@ -110,6 +118,15 @@ pub const FileHeader = struct {
         return self._name;
     }
 
+    pub fn get_offset(self: *const FileHeader) c.off_t {
+        return self._reader.get_offset();
+    }
+
+    // file content in mapped window, null if filesystem is not memory mapped
+    pub fn get_data(self: *const FileHeader) ?[]const u8 {
+        return self._reader.get_memory(self._reader.get_data_offset(), self._size);
+    }
+
     pub fn read_bytes(self: *FileHeader, buffer: []u8, offset: c.off_t) !void {
         try self._reader.read_bytes(buffer, self._reader.get_data_offset() + offset);
     }
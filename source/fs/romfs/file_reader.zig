@@ -22,22 +22,32 @@ const c = @import("libc_imports").c;
 
 pub const FileReader = struct {
     _device_file: IFile,
+    // device window when backing device is memory mapped (i.e. XIP flash),
+    // then data is taken directly from memory without seek and read calls
+    _memory: ?[*]const u8,
     _offset: u64,
     _data_offset: u64,
 
-    pub fn init(device_file: IFile, offset: u64) !FileReader {
+    pub fn init(device_file: IFile, offset: u64, memory: ?[*]const u8) !FileReader {
         var data_offset_value: u64 = 32;
-        var buffer: [16]u8 = undefined;
         var df = device_file;
-        _ = try df.interface.seek(@intCast(offset + 16), c.SEEK_SET);
-        _ = df.interface.read(buffer[0..]);
-        while (std.mem.lastIndexOfScalar(u8, buffer[0..], 0) == null) {
-            data_offset_value += 16;
+        if (memory) |base| {
+            // name is padded with zeros to 16 bytes boundary
+            const name_address: [*:0]const u8 = @ptrCast(base + @as(usize, @intCast(offset + 16)));
+            data_offset_value += (std.mem.len(name_address) / 16) * 16;
+        } else {
+            var buffer: [16]u8 = undefined;
+            _ = try df.interface.seek(@intCast(offset + 16), c.SEEK_SET);
             _ = df.interface.read(buffer[0..]);
+            while (std.mem.lastIndexOfScalar(u8, buffer[0..], 0) == null) {
+                data_offset_value += 16;
+                _ = df.interface.read(buffer[0..]);
+            }
         }
 
         return .{
             ._device_file = df,
+            ._memory = memory,
             ._offset = offset,
             ._data_offset = data_offset_value,
         };
@@ -51,7 +61,27 @@ pub const FileReader = struct {
         return @intCast(self._data_offset);
     }
 
+    pub fn is_memory_mapped(self: *const FileReader) bool {
+        return self._memory != null;
+    }
+
+    // returns slice of mapped window, null if device is not memory mapped
+    pub fn get_memory(self: *const FileReader, offset: c.off_t, length: usize) ?[]const u8 {
+        const base = self._memory orelse return null;
+        return base[@as(usize, @intCast(@as(i64, @intCast(self._offset)) + offset))..][0..length];
+    }
+
+    // returns string stored in mapped window without copying, null if device is not memory mapped
+    pub fn get_string(self: *const FileReader, offset: c.off_t) ?[]const u8 {
+        const base = self._memory orelse return null;
+        const address: [*:0]const u8 = @ptrCast(base + @as(usize, @intCast(@as(i64, @intCast(self._offset)) + offset)));
+        return std.mem.sliceTo(address, 0);
+    }
+
     pub fn read(self: *FileReader, comptime T: type, offset: u64) !T {
+        if (self._memory) |base| {
+            return std.mem.readInt(T, (base + @as(usize, @intCast(self._offset + offset)))[0..@sizeOf(T)], .big);
+        }
         var buffer: [@sizeOf(T)]u8 = undefined;
         _ = try self._device_file.interface.seek(@intCast(self._offset + offset), c.SEEK_SET);
         _ = self._device_file.interface.read(buffer[0..]);
@@ -59,6 +89,9 @@ pub const FileReader = struct {
     }
 
     pub fn read_string(self: *FileReader, allocator: std.mem.Allocator, offset: c.off_t) ![]u8 {
+        if (self.get_string(offset)) |string| {
+            return try allocator.dupe(u8, string);
+        }
         _ = try self._device_file.interface.seek(@as(i64, @intCast(self._offset)) + @as(i64, @intCast(offset)), c.SEEK_SET);
         var name_buffer: [16]u8 = undefined;
         var output_buffer: []u8 = &.{};
@@ -81,6 +114,10 @@ pub const FileReader = struct {
     }
 
     pub fn read_bytes(self: *FileReader, buffer: []u8, offset: c.off_t) !void {
+        if (self.get_memory(offset, buffer.len)) |memory| {
+            @memcpy(buffer, memory);
+            return;
+        }
         _ = try self._device_file.interface.seek(@as(i64, @intCast(self._offset)) + @as(i64, @intCast(offset)), c.SEEK_SET);
         _ = self._device_file.interface.read(buffer[0..]);
     }
@@ -56,10 +56,12 @@ pub const FileSystemHeader = struct {
         };
         _ = df.interface.ioctl(@intFromEnum(IoctlCommonCommands.GetMemoryMappingStatus), &attr);
         var mapped_memory_address: ?*const anyopaque = null;
+        var device_memory: ?[*]const u8 = null;
         if (attr.mapped_address_r) |address| {
             mapped_memory_address = @ptrFromInt(@intFromPtr(address) + @as(usize, @intCast(offset)));
+            device_memory = @ptrCast(address);
         }
-        var reader = try FileReader.init(df, @intCast(offset));
+        var reader = try FileReader.init(df, @intCast(offset), device_memory);
         const filesize = try reader.read(u32, 8);
         return .{
             ._allocator = allocator,
@@ -108,6 +110,11 @@ pub const FileSystemHeader = struct {
         return try FileHeader.init(self._device_file, self._reader.get_offset() + offset, @intCast(self._offset), self._mapped_memory, self._allocator);
     }
 
+    // offset is absolute on device, as returned by FileHeader.get_offset
+    pub fn create_file_header_at(self: *FileSystemHeader, offset: c.off_t) !FileHeader {
+        return try FileHeader.init(self._device_file, offset, @intCast(self._offset), self._mapped_memory, self._allocator);
+    }
+
     pub fn first_file_header(self: *FileSystemHeader) !?FileHeader {
         return try self.create_file_header_with_offset(self._reader.get_data_offset());
     }
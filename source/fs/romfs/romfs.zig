@@ -31,6 +31,7 @@ const FileSystemHeader = @import("file_system_header.zig").FileSystemHeader;
 const FileHeader = @import("file_header.zig").FileHeader;
 const RomFsDirectoryIterator = @import("romfs_directory_iterator.zig").RomFsDirectoryIterator;
 const RomFsDirectory = @import("romfs_directory.zig").RomFsDirectory;
+const DentryCache = @import("dentry_cache.zig").DentryCache;
 
 const interface = @import("interface");
 
@@ -38,6 +39,8 @@ const c = @import("libc_imports").c;
 
 const std = @import("std");
 
+const config = @import("config");
+
 const log = kernel.log;
 
 pub const RomFs = interface.DeriveFromBase(ReadOnlyFileSystem, struct {
@@ -47,6 +50,7 @@ pub const RomFs = interface.DeriveFromBase(ReadOnlyFileSystem, struct {
     root: FileSystemHeader,
     allocator: std.mem.Allocator,
     device_file: IFile,
+    dentries: DentryCache,
 
     pub fn name(self: *const Self) []const u8 {
         _ = self;
@@ -54,6 +58,7 @@ pub const RomFs = interface.DeriveFromBase(ReadOnlyFileSystem, struct {
     }
 
     pub fn delete(self: *Self) void {
+        self.dentries.deinit();
         self.device_file.interface.delete();
     }
 
@@ -65,6 +70,7 @@ pub const RomFs = interface.DeriveFromBase(ReadOnlyFileSystem, struct {
             .root = fs,
             .allocator = allocator,
             .device_file = device_file,
+            .dentries = try DentryCache.init(allocator, config.romfs.dentry_cache_size),
         });
     }
 
@@ -91,7 +97,24 @@ pub const RomFs = interface.DeriveFromBase(ReadOnlyFileSystem, struct {
         node.stat(data);
     }
 
-    fn get_file_header(self: *Self, path: []const u8, resolve_link: bool) !FileHeader {
+    fn get_file_header(self: *Self, path: []const u8, resolve_link: bool) anyerror!FileHeader {
+        switch (self.dentries.get(path, resolve_link)) {
+            .found => |offset| return try self.root.create_file_header_at(offset),
+            .not_found => return kernel.errno.ErrnoSet.NoEntry,
+            .miss => {},
+        }
+        const header = self.resolve_file_header(path, resolve_link) catch |err| {
+            if (err == kernel.errno.ErrnoSet.NoEntry) {
+                self.dentries.put(path, resolve_link, null);
+            }
+            return err;
+        };
+        self.dentries.put(path, resolve_link, header.get_offset());
+        return header;
+    }
+
+    // walks sibling chain of each path component
+    fn resolve_file_header(self: *Self, path: []const u8, resolve_link: bool) anyerror!FileHeader {
         const path_without_trailing_separator = std.mem.trimRight(u8, path, "/");
         var it = try std.fs.path.componentIterator(path);
         var component = it.first();
@@ -314,6 +337,25 @@ test "RomFs.ShouldStatFile" {
     try std.testing.expectEqual(34, stat_buf.st_size);
 }
 
+test "RomFs.ShouldServeRepeatedLookupsFromDentryCache" {
+    var ifs = try load_test_romfs();
+    defer ifs.interface.delete();
+    const dentries = &ifs.as(RomFs).data().dentries;
+
+    var first: c.struct_stat = undefined;
+    var second: c.struct_stat = undefined;
+    try ifs.interface.stat("/subdir/other_dir/a.txt", &first, true);
+    const hits = dentries.get_hits();
+    try ifs.interface.stat("/subdir/other_dir/a.txt", &second, true);
+    try std.testing.expectEqual(hits + 1, dentries.get_hits());
+    try std.testing.expectEqual(first.st_ino, second.st_ino);
+    try std.testing.expectEqual(first.st_size, second.st_size);
+
+    try std.testing.expectError(kernel.errno.ErrnoSet.NoEntry, ifs.interface.stat("/subdir/missing", &first, true));
+    try std.testing.expectError(kernel.errno.ErrnoSet.NoEntry, ifs.interface.stat("/subdir/missing", &first, true));
+    try std.testing.expectEqual(hits + 2, dentries.get_hits());
+}
+
 test "RomFs.ShouldStatDirectory" {
     var ifs = try load_test_romfs();
     defer ifs.interface.delete();
@@ -588,8 +630,10 @@ test "RomFs.ShouldRejectGettingNonExistentPathFromDirectory" {
 
 test "RomFs.ShouldReportMappedMemory" {
     const RomfsDeviceStubFile = @import("tests/romfs_device_stub.zig").RomfsDeviceStubFile;
-    var device = try RomfsDeviceStubFile.InstanceType.create_node(std.testing.allocator, "source/fs/romfs/tests/test.romfs", 0xfeedface);
-    var romfs = try RomFs.InstanceType.init(std.testing.allocator, device.as_file().?, 0);
+    var device = try RomfsDeviceStubFile.InstanceType.create_mapped_node(std.testing.allocator, "source/fs/romfs/tests/test.romfs");
+    var device_file = device.as_file().?;
+    const image_address = @intFromPtr(device_file.as(RomfsDeviceStubFile).data().image.?.ptr);
+    var romfs = try RomFs.InstanceType.init(std.testing.allocator, device_file, 0);
     var sut = try romfs.interface.new(std.testing.allocator);
     defer sut.interface.delete();
 
@@ -609,9 +653,64 @@ test "RomFs.ShouldReportMappedMemory" {
         try std.testing.expect(status.mapped_address_r != null);
         const file_offset = 0x350;
         if (status.mapped_address_r) |addr| {
-            try std.testing.expectEqual(@as(*anyopaque, @ptrFromInt(0xfeedface + file_offset)), addr);
+            try std.testing.expectEqual(@as(*anyopaque, @ptrFromInt(image_address + file_offset)), addr);
         }
 
         try std.testing.expectEqual(null, status.mapped_address_w);
     }
 }
+
+fn load_mapped_test_romfs() !kernel.fs.IFileSystem {
+    const RomfsDeviceStubFile = @import("tests/romfs_device_stub.zig").RomfsDeviceStubFile;
+    var device = try RomfsDeviceStubFile.InstanceType.create_mapped_node(std.testing.allocator, "source/fs/romfs/tests/test.romfs");
+    var romfs = try RomFs.InstanceType.init(std.testing.allocator, device.as_file().?, 0);
+    return try romfs.interface.new(std.testing.allocator);
+}
+
+test "RomFs.ShouldReadFilesFromMappedMemory" {
+    var ifs = try load_mapped_test_romfs();
+    defer ifs.interface.delete();
+
+    try test_file(ifs, "/file.txt", 34, "THis is testing file\nwith content\n", kernel.fs.FileType.File);
+    try test_file(ifs, "/subdir/f1.txt", 10, "1 2 3 4 5\n", kernel.fs.FileType.File);
+    try test_file(ifs, "/subdir/other_dir/a.txt", 7, "abcdef\n", kernel.fs.FileType.File);
+
+    var stat_buf: c.struct_stat = undefined;
+    try ifs.interface.stat("/subdir", &stat_buf, true);
+    try std.testing.expectEqual(@as(c_uint, c.S_IFDIR), stat_buf.st_mode);
+}
+
+test "RomFs.ShouldMapFileRegion" {
+    var ifs = try load_mapped_test_romfs();
+    defer ifs.interface.delete();
+
+    var node = try ifs.interface.get("/file.txt");
+    defer node.delete();
+    var file = node.as_file().?;
+
+    var region = kernel.fs.FileMemoryRegion{ .offset = 5, .length = 0, .address = null };
+    try std.testing.expectEqual(0, file.interface.ioctl(@intFromEnum(kernel.fs.IoctlCommonCommands.MapFileRegion), &region));
+    try std.testing.expectEqual(29, region.length);
+    const content: [*]const u8 = @ptrCast(region.address.?);
+    try std.testing.expectEqualStrings("is testing file\nwith content\n", content[0..region.length]);
+
+    region = .{ .offset = 0, .length = 4, .address = null };
+    try std.testing.expectEqual(0, file.interface.ioctl(@intFromEnum(kernel.fs.IoctlCommonCommands.MapFileRegion), &region));
+    try std.testing.expectEqual(4, region.length);
+
+    region = .{ .offset = 35, .length = 0, .address = null };
+    try std.testing.expectEqual(-1, file.interface.ioctl(@intFromEnum(kernel.fs.IoctlCommonCommands.MapFileRegion), &region));
+}
+
+test "RomFs.ShouldRejectMapFileRegionWhenDeviceIsNotMapped" {
+    var ifs = try load_test_romfs();
+    defer ifs.interface.delete();
+
+    var node = try ifs.interface.get("/file.txt");
+    defer node.delete();
+    var file = node.as_file().?;
+
+    var region = kernel.fs.FileMemoryRegion{ .offset = 0, .length = 0, .address = null };
+    try std.testing.expectEqual(-1, file.interface.ioctl(@intFromEnum(kernel.fs.IoctlCommonCommands.MapFileRegion), &region));
+    try std.testing.expectEqual(null, region.address);
+}
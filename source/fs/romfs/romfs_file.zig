@@ -34,6 +34,7 @@ const FileName = kernel.fs.FileName;
 const FileHeader = @import("file_header.zig").FileHeader;
 const IoctlCommonCommands = kernel.fs.IoctlCommonCommands;
 const FileMemoryMapAttributes = kernel.fs.FileMemoryMapAttributes;
+const FileMemoryRegion = kernel.fs.FileMemoryRegion;
 
 const log = std.log;
 
@@ -67,9 +68,9 @@ pub const RomFsFile = interface.DeriveFromBase(ReadOnlyFile, struct {
         if (self.position >= data_size) {
             return 0;
         }
-        const length = @min(data_size - self.position, buffer.len);
-        self.header.read_bytes(buffer, self.position) catch return 0;
-        self.position += length;
+        const length: usize = @intCast(@min(data_size - self.position, buffer.len));
+        self.header.read_bytes(buffer[0..length], self.position) catch return 0;
+        self.position += @intCast(length);
         return @intCast(length);
     }
 
@@ -118,6 +119,21 @@ pub const RomFsFile = interface.DeriveFromBase(ReadOnlyFile, struct {
                     attr.is_memory_mapped = false;
                 }
             },
+            @intFromEnum(IoctlCommonCommands.MapFileRegion) => {
+                if (data == null) {
+                    return -1;
+                }
+                const region: *FileMemoryRegion = @ptrCast(@alignCast(data.?));
+                const content = self.header.get_data() orelse return -1;
+                if (region.offset > content.len) {
+                    return -1;
+                }
+                const available = content.len - region.offset;
+                if (region.length == 0 or region.length > available) {
+                    region.length = available;
+                }
+                region.address = content[region.offset..].ptr;
+            },
             else => {
                 return -1;
             },
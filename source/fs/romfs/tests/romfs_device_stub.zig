@@ -29,6 +29,8 @@ pub const RomfsDeviceStubFile = interface.DeriveFromBase(kernel.fs.ReadOnlyFile,
     file: ?std.fs.File,
     path: []const u8,
     mapped_memory: ?usize,
+    image: ?[]u8,
+    allocator: ?std.mem.Allocator,
 
     pub fn create(path: []const u8, mapped_address: ?usize) !RomfsDeviceStubFile {
         const cwd = std.fs.cwd();
@@ -39,14 +41,31 @@ pub const RomfsDeviceStubFile = interface.DeriveFromBase(kernel.fs.ReadOnlyFile,
             .file = file,
             .path = path,
             .mapped_memory = mapped_address,
+            .image = null,
+            .allocator = null,
         });
     }
 
+    // image is loaded to memory and reported as mapped window, like XIP flash
+    pub fn create_mapped(allocator: std.mem.Allocator, path: []const u8) !RomfsDeviceStubFile {
+        const image = try std.fs.cwd().readFileAlloc(allocator, path, 1024 * 1024);
+        errdefer allocator.free(image);
+        var stub = try create(path, @intFromPtr(image.ptr));
+        stub.data().image = image;
+        stub.data().allocator = allocator;
+        return stub;
+    }
+
     pub fn create_node(allocator: std.mem.Allocator, path: []const u8, mapped_address: ?usize) !kernel.fs.Node {
         const file_instance = try (try create(path, mapped_address)).interface.new(allocator);
         return kernel.fs.Node.create_file(file_instance);
     }
 
+    pub fn create_mapped_node(allocator: std.mem.Allocator, path: []const u8) !kernel.fs.Node {
+        const file_instance = try (try create_mapped(allocator, path)).interface.new(allocator);
+        return kernel.fs.Node.create_file(file_instance);
+    }
+
     pub fn read(self: *Self, buffer: []u8) isize {
         return @intCast(self.file.?.read(buffer) catch return -1);
     }
@@ -124,6 +143,9 @@ pub const RomfsDeviceStubFile = interface.DeriveFromBase(kernel.fs.ReadOnlyFile,
 
     pub fn delete(self: *Self) void {
         _ = self.file.?.close();
+        if (self.image) |image| {
+            self.allocator.?.free(image);
+        }
     }
 
     pub fn load(self: *Self) !void {
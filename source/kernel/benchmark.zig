@@ -16,10 +16,58 @@
 const std = @import("std");
 const hal = @import("hal");
 
+const config = @import("config");
+
 const log = std.log.scoped(.benchmark);
 
 var previous: u64 = 0;
 
+// Duration of instrumented kernel paths, accumulated only when
+// CONFIG_INSTRUMENTATION_ENABLE_BENCHMARKS is set and shown in /proc/benchmark.
+pub const enabled = config.instrumentation.enable_benchmarks;
+
+pub const Probe = enum {
+    getdents,
+    stat,
+    exec,
+    lazy_bind,
+};
+
+pub const Statistics = struct {
+    calls: u64 = 0,
+    total_us: u64 = 0,
+    max_us: u64 = 0,
+};
+
+var statistics = [_]Statistics{.{}} ** std.enums.values(Probe).len;
+
+// returns start time to be passed to stop()
+pub fn start() u64 {
+    if (!enabled) {
+        return 0;
+    }
+    return hal.time.get_time_us();
+}
+
+pub fn stop(probe: Probe, started: u64) void {
+    if (!enabled) {
+        return;
+    }
+    const elapsed = hal.time.get_time_us() -| started;
+    const stats = &statistics[@intFromEnum(probe)];
+    stats.calls += 1;
+    stats.total_us += elapsed;
+    stats.max_us = @max(stats.max_us, elapsed);
+}
+
+pub fn get(probe: Probe) Statistics {
+    return statistics[@intFromEnum(probe)];
+}
+
+pub fn reset() void {
+    @memset(&statistics, .{});
+}
+
 pub fn timestamp(name: []const u8) void {
     const time = hal.time.get_time_us();
     if (previous == 0) {
@@ -38,3 +86,24 @@ test "Benchmark.Timestamp" {
     hal.time.impl.set_time(20000);
     timestamp("after 20ms sleep");
 }
+
+test "Benchmark.ShouldAccumulateProbeDuration" {
+    reset();
+    defer reset();
+    hal.time.impl.set_time(1000);
+    const first = start();
+    hal.time.impl.set_time(1300);
+    stop(.getdents, first);
+    const second = start();
+    hal.time.impl.set_time(1400);
+    stop(.getdents, second);
+
+    const stats = get(.getdents);
+    if (enabled) {
+        try std.testing.expectEqual(2, stats.calls);
+        try std.testing.expectEqual(400, stats.total_us);
+        try std.testing.expectEqual(300, stats.max_us);
+    } else {
+        try std.testing.expectEqual(0, stats.calls);
+    }
+}
@@ -17,8 +17,6 @@ const std = @import("std");
 
 const kernel = @import("../../kernel.zig");
 
-const arch = @import("arch");
-
 const hal = @import("hal");
 
 const log = std.log.scoped(.@"mmc/driver");
@@ -60,6 +58,15 @@ pub const MmcIo = struct {
     _card_type: ?CardType,
     _size: u64,
     _initialized: bool,
+    _pre_erase: bool,
+    _lock: kernel.sync.IoLock,
+
+    const max_retransmissions: usize = 3;
+
+    const Request = struct {
+        process: ?*kernel.process.Process,
+        start: u64,
+    };
 
     pub fn create(mmc: *hal.mmc.Mmc) MmcIo {
         return .{
@@ -67,12 +74,14 @@ pub const MmcIo = struct {
             ._card_type = null,
             ._size = 0,
             ._initialized = false,
+            ._pre_erase = true,
+            ._lock = .{},
         };
     }
 
     pub fn init(self: *Self) anyerror!void {
-        const state = arch.sync.save_and_disable_interrupts();
-        defer arch.sync.restore_interrupts(state);
+        self._lock.lock();
+        defer self._lock.unlock();
         try self._mmc.init();
         const config = self._mmc.get_config();
         switch (config.mode) {
@@ -97,9 +106,9 @@ pub const MmcIo = struct {
         }
     }
 
-    pub fn read(self: *const Self, address: u64, buf: []u8) isize {
-        const state = arch.sync.save_and_disable_interrupts();
-        defer arch.sync.restore_interrupts(state);
+    pub fn read(self: *Self, address: u64, buf: []u8) isize {
+        const request = self.begin_request();
+        defer self.end_request(request);
         if (address % 512 != 0) {
             log.err("Address must be aligned to 512 bytes, got: {d}", .{address});
             return -1;
@@ -113,10 +122,15 @@ pub const MmcIo = struct {
         const block_address = address >> 9;
         const num_blocks = buf.len / 512;
         var i: usize = 0;
+        // retransmissions are counted per block, progress resets the budget
         var retransmissions: usize = 0;
-        const max_retransmissions: usize = 3;
         while (i < num_blocks) {
-            self.block_read_impl(17, @intCast(block_address + i), buf[512 * i .. 512 * (i + 1)]) catch |err| {
+            var transferred: usize = 0;
+            self.read_blocks(@intCast(block_address + i), buf[512 * i ..], &transferred) catch |err| {
+                i += transferred;
+                if (transferred != 0) {
+                    retransmissions = 0;
+                }
                 log.warn("Reading block {d} failed with error: {s}, size: {d}", .{ i, @errorName(err), buf.len });
                 if (retransmissions < max_retransmissions) {
                     retransmissions += 1;
@@ -125,15 +139,16 @@ pub const MmcIo = struct {
                 log.err("Permanent read error on block {d}: {s}", .{ i, @errorName(err) });
                 return -1;
             };
-            i += 1;
+            i += transferred;
+            retransmissions = 0;
         }
 
         return @intCast(buf.len);
     }
 
-    pub fn write(self: *const Self, address: u64, buf: []const u8) isize {
-        const state = arch.sync.save_and_disable_interrupts();
-        defer arch.sync.restore_interrupts(state);
+    pub fn write(self: *Self, address: u64, buf: []const u8) isize {
+        const request = self.begin_request();
+        defer self.end_request(request);
         if (address % 512 != 0) {
             log.err("Address must be aligned to 512 bytes, got: {d}", .{address});
             return -1;
@@ -149,23 +164,31 @@ pub const MmcIo = struct {
         var i: usize = 0;
         var retransmissions: usize = 0;
         while (i < num_blocks) {
-            self.block_write_impl(24, @intCast(block_address + i), buf[512 * i .. 512 * (i + 1)]) catch |err|
-                {
-                    log.err("Writing block {d} failed with error: {s}, size: {d}", .{ i, @errorName(err), buf.len });
-                    if (retransmissions < 3) {
-                        retransmissions += 1;
-                        continue;
-                    } else {
-                        log.err("Permanent write error on block {d}: {s}", .{ i, @errorName(err) });
-                        return -1;
-                    }
-                };
-            i += 1;
+            var transferred: usize = 0;
+            self.write_blocks(@intCast(block_address + i), buf[512 * i ..], &transferred) catch |err| {
+                i += transferred;
+                if (transferred != 0) {
+                    retransmissions = 0;
+                }
+                log.err("Writing block {d} failed with error: {s}, size: {d}", .{ i, @errorName(err), buf.len });
+                if (retransmissions < max_retransmissions) {
+                    retransmissions += 1;
+                    continue;
+                }
+                log.err("Permanent write error on block {d}: {s}", .{ i, @errorName(err) });
+                return -1;
+            };
+            i += transferred;
+            retransmissions = 0;
         }
 
         return @intCast(buf.len);
     }
 
+    pub fn set_pre_erase(self: *Self, enable: bool) void {
+        self._pre_erase = enable;
+    }
+
     pub fn size_in_sectors(self: *const Self) u64 {
         return self._size;
     }
@@ -255,7 +278,7 @@ pub const MmcIo = struct {
 
     fn get_data_token(comptime cmd: u6) !u8 {
         const v: u8 = switch (cmd) {
-            9, 10, 17, 18, 28, 24, 6 => 0xfe,
+            9, 10, 17, 18, 22, 28, 24, 6 => 0xfe,
             25 => 0xfc,
             else => {
                 log.err("Got unknown packet command: 0x{x}", .{cmd});
@@ -283,7 +306,7 @@ pub const MmcIo = struct {
             return error.InvalidToken;
         }
 
-        self._mmc.receive_blocking(output);
+        self.receive_payload(output);
         self._mmc.receive_blocking(buffer[0..2]);
         const crc = std.mem.bigToNative(u16, std.mem.bytesToValue(u16, &buffer));
         const received_crc = std.hash.crc.Crc16Xmodem.hash(output);
@@ -303,7 +326,7 @@ pub const MmcIo = struct {
         log.debug("Transmitting data packet with command: {d}, token: {x}, crc: {x}", .{ cmd, token, crc });
 
         self._mmc.transmit_blocking(buffer[0..], null);
-        self._mmc.transmit_blocking(input[0..], null);
+        self.transmit_payload(input);
         self._mmc.transmit_blocking(crc_buffer[0..2], null);
         self._mmc.receive_blocking(buffer[0..]);
         log.debug("Received response: {x}", .{buffer[0]});
@@ -322,6 +345,61 @@ pub const MmcIo = struct {
         }
     }
 
+    // Requests are serialized per card, the whole request including waiting
+    // in the queue is accounted as I/O wait time of the calling process
+    fn begin_request(self: *Self) Request {
+        const request = Request{
+            .process = kernel.process.process_manager.get_running_process(),
+            .start = hal.time.get_time_us(),
+        };
+        self._lock.lock();
+        return request;
+    }
+
+    fn end_request(self: *Self, request: Request) void {
+        self._lock.unlock();
+        if (request.process) |process| {
+            process.add_io_wait_time(hal.time.get_time_us() - request.start);
+        }
+    }
+
+    // Data block payloads are moved by DMA when the interface supports it,
+    // calling process stays blocked until transfer completion interrupt
+    fn receive_payload(self: *const Self, output: []u8) void {
+        if (self._mmc.get_config().use_dma) {
+            var completion = kernel.sync.Completion{};
+            if (self._mmc.receive_dma(output, &kernel.sync.Completion.signal, &completion)) |_| {
+                wait_for_transfer(&completion);
+                return;
+            } else |err| {
+                log.debug("DMA reception not possible: {s}, using blocking transfer", .{@errorName(err)});
+            }
+        }
+        self._mmc.receive_blocking(output);
+    }
+
+    // DMA completion comes from interrupt, so it is awaited even when context switching is blocked
+    fn wait_for_transfer(completion: *kernel.sync.Completion) void {
+        if (kernel.process.is_context_switch_blocked()) {
+            completion.wait_for_interrupt();
+        } else {
+            completion.wait(kernel.process.process_manager.get_running_process());
+        }
+    }
+
+    fn transmit_payload(self: *const Self, input: []const u8) void {
+        if (self._mmc.get_config().use_dma) {
+            var completion = kernel.sync.Completion{};
+            if (self._mmc.transmit_dma(input, null, &kernel.sync.Completion.signal, &completion)) |_| {
+                wait_for_transfer(&completion);
+                return;
+            } else |err| {
+                log.debug("DMA transmission not possible: {s}, using blocking transfer", .{@errorName(err)});
+            }
+        }
+        self._mmc.transmit_blocking(input, null);
+    }
+
     fn wait_for_card_ready(self: *const Self) !void {
         var timeout: usize = 50_000;
         const dummy: [1]u8 = [_]u8{0xff};
@@ -390,6 +468,164 @@ pub const MmcIo = struct {
         self._mmc.transmit_blocking(dummy[0..], null);
     }
 
+    // single block requests keep CMD17/CMD24, longer ones are streamed
+    fn read_blocks(self: *const Self, block: u32, output: []u8, transferred: *usize) anyerror!void {
+        if (output.len == 512) {
+            try self.block_read_impl(17, block, output);
+            transferred.* = 1;
+            return;
+        }
+        try self.multi_block_read_impl(block, output, transferred);
+    }
+
+    fn write_blocks(self: *const Self, block: u32, input: []const u8, transferred: *usize) anyerror!void {
+        if (input.len == 512) {
+            try self.block_write_impl(24, block, input);
+            transferred.* = 1;
+            return;
+        }
+        try self.multi_block_write_impl(block, input, transferred);
+    }
+
+    fn stop_transmission(self: *const Self) !void {
+        const command = self._mmc.build_command(12, 0);
+        self._mmc.transmit_blocking(command[0..], null);
+        // first byte after CMD12 is a stuff byte
+        const dummy: [1]u8 = [_]u8{0xff};
+        self._mmc.transmit_blocking(dummy[0..], null);
+        var r1: u8 = 0xff;
+        var repeat: usize = 0;
+        while (repeat < 20) : (repeat += 1) {
+            r1 = self.wait_for_response_r1();
+            if ((r1 & 0x80) == 0) break;
+        }
+        // R1b, card signals busy until stop is processed
+        try self.wait_for_card_ready();
+        if (r1 != 0x00) {
+            log.warn("CMD12 returned error bits: 0x{x}", .{r1});
+            return error.IncorrectResponse;
+        }
+    }
+
+    fn stop_write_transmission(self: *const Self) !void {
+        const stop_token: [2]u8 = [_]u8{ 0xfd, 0xff };
+        self._mmc.transmit_blocking(stop_token[0..], null);
+        try self.wait_for_card_ready();
+    }
+
+    fn set_write_block_erase_count(self: *const Self, count: u32) !void {
+        const cmd55_resp = self.send_command(55, 0, R1, true);
+        if (cmd55_resp.r1 != 0x00) {
+            return error.IncorrectResponse;
+        }
+        const acmd23_resp = self.send_command(23, count & 0x7fffff, R1, true);
+        if (acmd23_resp.r1 != 0x00) {
+            return error.IncorrectResponse;
+        }
+    }
+
+    // ACMD22, number of blocks written without errors by the last write command
+    fn read_written_block_count(self: *const Self) !u32 {
+        const cmd55_resp = self.send_command(55, 0, R1, true);
+        if (cmd55_resp.r1 != 0x00) {
+            return error.IncorrectResponse;
+        }
+        const cmd_resp = self.send_command(22, 0, R1, false);
+        defer self._mmc.chip_select(false);
+        if (cmd_resp.r1 != 0x00) {
+            return error.IncorrectResponse;
+        }
+        var buffer: [4]u8 = undefined;
+        try self.receive_data_packet(22, buffer[0..]);
+        return std.mem.readInt(u32, &buffer, .big);
+    }
+
+    fn supports_application_commands(self: *const Self) bool {
+        return self._card_type != null and self._card_type.? != .MMCv3;
+    }
+
+    // Card must leave receive-data state after any failure, otherwise it ignores
+    // following commands. Packets may be accepted and still fail while programming,
+    // so number of written blocks is taken from the card when it supports ACMD22.
+    fn abort_multi_block_write(self: *const Self, num_blocks: usize, transferred: *usize, err: anyerror) anyerror {
+        self.stop_write_transmission() catch |stop_err| {
+            log.warn("Stopping write transmission failed: {s}", .{@errorName(stop_err)});
+        };
+        return self.report_written_blocks(num_blocks, transferred, err);
+    }
+
+    fn report_written_blocks(self: *const Self, num_blocks: usize, transferred: *usize, err: anyerror) anyerror {
+        self._mmc.chip_select(false);
+        if (self.supports_application_commands()) {
+            if (self.read_written_block_count()) |written| {
+                transferred.* = @min(written, num_blocks);
+            } else |count_err| {
+                log.warn("ACMD22 failed: {s}", .{@errorName(count_err)});
+            }
+        }
+        log.warn("Multi block write stopped after {d} of {d} blocks", .{ transferred.*, num_blocks });
+        return err;
+    }
+
+    fn multi_block_read_impl(self: *const Self, argument: u32, output: []u8, transferred: *usize) anyerror!void {
+        const cmd_resp = self.send_command(18, argument, R1, false);
+        errdefer self._mmc.chip_select(false);
+        if (cmd_resp.r1 != 0x00) {
+            log.err("Received incorrect command response: 0x{x}", .{cmd_resp.r1});
+            return error.IncorrectResponse;
+        }
+
+        const num_blocks = output.len / 512;
+        var block: usize = 0;
+        while (block < num_blocks) : (block += 1) {
+            self.receive_data_packet(18, output[512 * block .. 512 * (block + 1)]) catch |err| {
+                self.stop_transmission() catch {};
+                return err;
+            };
+            transferred.* += 1;
+        }
+        try self.stop_transmission();
+        self._mmc.chip_select(false);
+
+        const dummy: [1]u8 = [_]u8{0xff};
+        self._mmc.transmit_blocking(dummy[0..], null);
+    }
+
+    fn multi_block_write_impl(self: *const Self, argument: u32, input: []const u8, transferred: *usize) anyerror!void {
+        const num_blocks = input.len / 512;
+        if (self._pre_erase and self.supports_application_commands()) {
+            self.set_write_block_erase_count(@intCast(num_blocks)) catch |err| {
+                log.debug("ACMD23 rejected: {s}", .{@errorName(err)});
+            };
+        }
+
+        const cmd_resp = self.send_command(25, argument, R1, false);
+        errdefer self._mmc.chip_select(false);
+        if (cmd_resp.r1 != 0x00) {
+            log.warn("Received incorrect command response: 0x{x}", .{cmd_resp.r1});
+            return error.IncorrectResponse;
+        }
+
+        var block: usize = 0;
+        while (block < num_blocks) : (block += 1) {
+            self.transmit_data_packet(25, input[512 * block .. 512 * (block + 1)]) catch |err| {
+                return self.abort_multi_block_write(num_blocks, transferred, err);
+            };
+            self.wait_for_card_ready() catch |err| {
+                return self.abort_multi_block_write(num_blocks, transferred, err);
+            };
+            transferred.* += 1;
+        }
+        self.stop_write_transmission() catch |err| {
+            // stop token was sent, card timed out while programming last blocks
+            return self.report_written_blocks(num_blocks, transferred, err);
+        };
+        self._mmc.chip_select(false);
+
+        const dummy: [1]u8 = [_]u8{0xff};
+        self._mmc.transmit_blocking(dummy[0..], null);
+    }
+
     fn read_cid(self: *Self) !card_parser.CID {
         var buffer: [16]u8 = [_]u8{0x00} ** 16;
         try self.block_read_impl(10, 0, buffer[0..]);
@@ -694,3 +930,218 @@ test "MmcIo.ShouldInitializeWithACMD41" {
     try std.testing.expectEqual(30617600, sut.size_in_sectors());
     try std.testing.expectEqual(sut._card_type.?, CardType.SDv1);
 }
+
+fn push_data_packet(token: u8, data: []const u8) !void {
+    try mmc_stub.impl.set_receive_data(&[_]u8{token});
+    try mmc_stub.impl.set_receive_data(data);
+    const crc = std.mem.toBytes(std.mem.nativeToBig(u16, std.hash.crc.Crc16Xmodem.hash(data)));
+    try mmc_stub.impl.set_receive_data(crc[0..2]);
+}
+
+test "MmcIo.ShouldReadMultipleBlocksWithSingleCommand" {
+    var sut = MmcIo.create(&mmc_stub);
+    mmc_stub.impl.reset();
+    defer mmc_stub.impl.reset();
+    try mmc_stub.impl.init();
+
+    const R1_RESP = [_]u8{0x00};
+    const block_a = [_]u8{0xa5} ** 512;
+    const block_b = [_]u8{0x5a} ** 512;
+
+    try mmc_stub.impl.set_receive_data(&R1_RESP);
+    try push_data_packet(0xfe, block_a[0..]);
+    try push_data_packet(0xfe, block_b[0..]);
+    try mmc_stub.impl.set_receive_data(&R1_RESP); // CMD12
+    try mmc_stub.impl.set_receive_data(&[_]u8{0xff}); // not busy
+
+    var buffer: [1024]u8 = undefined;
+    try std.testing.expectEqual(1024, sut.read(2 * 512, buffer[0..]));
+    try std.testing.expectEqualSlices(u8, block_a[0..], buffer[0..512]);
+    try std.testing.expectEqualSlices(u8, block_b[0..], buffer[512..]);
+    try std.testing.expectEqual(2, mmc_stub.impl.dma_count);
+
+    try consume_frame(&[_]u8{ 0x52, 0, 0, 0, 2, 0x95 });
+    try consume_frame(null);
+    try consume_frame(&[_]u8{ 0x4c, 0, 0, 0, 0, 0x95 });
+    try consume_frame(&[_]u8{0xff}); // stuff byte
+    try consume_frame(null);
+    try consume_frame(null);
+    try consume_frame(&[_]u8{0xff});
+
+    try mmc_stub.impl.verify();
+}
+
+test "MmcIo.ShouldRetryOnlyFailedBlockOfMultiBlockRead" {
+    var sut = MmcIo.create(&mmc_stub);
+    mmc_stub.impl.reset();
+    defer mmc_stub.impl.reset();
+    try mmc_stub.impl.init();
+
+    const R1_RESP = [_]u8{0x00};
+    const block_a = [_]u8{0x11} ** 512;
+    const block_b = [_]u8{0x22} ** 512;
+    const corrupted_crc = [_]u8{ 0xde, 0xad };
+
+    // first transfer delivers block a and corrupted block b
+    try mmc_stub.impl.set_receive_data(&R1_RESP);
+    try push_data_packet(0xfe, block_a[0..]);
+    try mmc_stub.impl.set_receive_data(&[_]u8{0xfe});
+    try mmc_stub.impl.set_receive_data(block_b[0..]);
+    try mmc_stub.impl.set_receive_data(corrupted_crc[0..]);
+    try mmc_stub.impl.set_receive_data(&R1_RESP); // CMD12
+    try mmc_stub.impl.set_receive_data(&[_]u8{0xff});
+    // only block b is requested again, using CMD17
+    try mmc_stub.impl.set_receive_data(&R1_RESP);
+    try push_data_packet(0xfe, block_b[0..]);
+
+    var buffer: [1024]u8 = undefined;
+    try std.testing.expectEqual(1024, sut.read(0, buffer[0..]));
+    try std.testing.expectEqualSlices(u8, block_a[0..], buffer[0..512]);
+    try std.testing.expectEqualSlices(u8, block_b[0..], buffer[512..]);
+
+    try consume_frame(&[_]u8{ 0x52, 0, 0, 0, 0, 0x95 });
+    try consume_frame(null);
+    try consume_frame(&[_]u8{ 0x4c, 0, 0, 0, 0, 0x95 });
+    try consume_frame(&[_]u8{0xff});
+    try consume_frame(null);
+    try consume_frame(null);
+    try consume_frame(&[_]u8{ 0x51, 0, 0, 0, 1, 0x95 });
+    try consume_frame(null);
+    try consume_frame(&[_]u8{0xff});
+
+    try mmc_stub.impl.verify();
+}
+
+test "MmcIo.ShouldWriteMultipleBlocksWithPreErase" {
+    var sut = MmcIo.create(&mmc_stub);
+    mmc_stub.impl.reset();
+    defer mmc_stub.impl.reset();
+    try mmc_stub.impl.init();
+    sut._card_type = .SDv2Block;
+
+    const R1_RESP = [_]u8{0x00};
+    const DATA_ACCEPTED = [_]u8{0x05};
+    const NOT_BUSY = [_]u8{0xff};
+    const block_a = [_]u8{0x33} ** 512;
+    const block_b = [_]u8{0x44} ** 512;
+    var input: [1024]u8 = undefined;
+    @memcpy(input[0..512], block_a[0..]);
+    @memcpy(input[512..], block_b[0..]);
+
+    try mmc_stub.impl.set_receive_data(&R1_RESP); // CMD55
+    try mmc_stub.impl.set_receive_data(&R1_RESP); // ACMD23
+    try mmc_stub.impl.set_receive_data(&R1_RESP); // CMD25
+    try mmc_stub.impl.set_receive_data(&DATA_ACCEPTED);
+    try mmc_stub.impl.set_receive_data(&NOT_BUSY);
+    try mmc_stub.impl.set_receive_data(&DATA_ACCEPTED);
+    try mmc_stub.impl.set_receive_data(&NOT_BUSY);
+    try mmc_stub.impl.set_receive_data(&NOT_BUSY); // after stop token
+
+    try std.testing.expectEqual(1024, sut.write(4 * 512, input[0..]));
+    try std.testing.expectEqual(2, mmc_stub.impl.dma_count);
+
+    try consume_frame(&[_]u8{ 0x77, 0, 0, 0, 0, 0x95 });
+    try consume_frame(null);
+    try consume_frame(&[_]u8{ 0x57, 0, 0, 0, 2, 0x95 });
+    try consume_frame(null);
+    try consume_frame(&[_]u8{ 0x59, 0, 0, 0, 4, 0x95 });
+    try consume_frame(null);
+    inline for (.{ block_a, block_b }) |block| {
+        const crc = std.mem.toBytes(std.mem.nativeToBig(u16, std.hash.crc.Crc16Xmodem.hash(block[0..])));
+        try consume_frame(&[_]u8{0xfc});
+        try consume_frame(block[0..]);
+        try consume_frame(crc[0..2]);
+        try consume_frame(null);
+    }
+    try consume_frame(&[_]u8{ 0xfd, 0xff });
+    try consume_frame(null);
+    try consume_frame(&[_]u8{0xff});
+
+    try mmc_stub.impl.verify();
+}
+
+test "MmcIo.ShouldFallbackToBlockingTransferWhenDmaUnavailable" {
+    var sut = MmcIo.create(&mmc_stub);
+    mmc_stub.impl.reset();
+    defer mmc_stub.impl.reset();
+    try mmc_stub.impl.init();
+    mmc_stub.impl.set_dma_enabled(false);
+
+    const R1_RESP = [_]u8{0x00};
+    const block = [_]u8{0x77} ** 512;
+    try mmc_stub.impl.set_receive_data(&R1_RESP);
+    try push_data_packet(0xfe, block[0..]);
+
+    var buffer: [512]u8 = undefined;
+    try std.testing.expectEqual(512, sut.read(3 * 512, buffer[0..]));
+    try std.testing.expectEqualSlices(u8, block[0..], buffer[0..]);
+    try std.testing.expectEqual(0, mmc_stub.impl.dma_count);
+
+    try consume_frame(&[_]u8{ 0x51, 0, 0, 0, 3, 0x95 });
+    try consume_frame(null);
+    try consume_frame(&[_]u8{0xff});
+
+    try mmc_stub.impl.verify();
+}
+
+test "MmcIo.ShouldStopStreamAndReportWrittenBlocksOnWriteError" {
+    var sut = MmcIo.create(&mmc_stub);
+    mmc_stub.impl.reset();
+    defer mmc_stub.impl.reset();
+    try mmc_stub.impl.init();
+    sut._card_type = .SDv2Block;
+    sut.set_pre_erase(false);
+
+    const R1_RESP = [_]u8{0x00};
+    const DATA_ACCEPTED = [_]u8{0x05};
+    const WRITE_ERROR = [_]u8{0x0d};
+    const NOT_BUSY = [_]u8{0xff};
+    const block_a = [_]u8{0x55} ** 512;
+    const block_b = [_]u8{0x66} ** 512;
+    var input: [1024]u8 = undefined;
+    @memcpy(input[0..512], block_a[0..]);
+    @memcpy(input[512..], block_b[0..]);
+
+    try mmc_stub.impl.set_receive_data(&R1_RESP); // CMD25
+    try mmc_stub.impl.set_receive_data(&DATA_ACCEPTED);
+    try mmc_stub.impl.set_receive_data(&NOT_BUSY);
+    try mmc_stub.impl.set_receive_data(&WRITE_ERROR);
+    try mmc_stub.impl.set_receive_data(&NOT_BUSY); // after stop token
+    try mmc_stub.impl.set_receive_data(&R1_RESP); // CMD55
+    try mmc_stub.impl.set_receive_data(&R1_RESP); // ACMD22
+    try push_data_packet(0xfe, &[_]u8{ 0x00, 0x00, 0x00, 0x01 });
+    // only block b is written again, using CMD24
+    try mmc_stub.impl.set_receive_data(&R1_RESP);
+    try mmc_stub.impl.set_receive_data(&DATA_ACCEPTED);
+    try mmc_stub.impl.set_receive_data(&NOT_BUSY);
+
+    try std.testing.expectEqual(1024, sut.write(4 * 512, input[0..]));
+
+    try consume_frame(&[_]u8{ 0x59, 0, 0, 0, 4, 0x95 });
+    try consume_frame(null);
+    const crc_a = std.mem.toBytes(std.mem.nativeToBig(u16, std.hash.crc.Crc16Xmodem.hash(block_a[0..])));
+    const crc_b = std.mem.toBytes(std.mem.nativeToBig(u16, std.hash.crc.Crc16Xmodem.hash(block_b[0..])));
+    try consume_frame(&[_]u8{0xfc});
+    try consume_frame(block_a[0..]);
+    try consume_frame(crc_a[0..2]);
+    try consume_frame(null);
+    try consume_frame(&[_]u8{0xfc});
+    try consume_frame(block_b[0..]);
+    try consume_frame(crc_b[0..2]);
+    // stream is stopped and number of written blocks is read back
+    try consume_frame(&[_]u8{ 0xfd, 0xff });
+    try consume_frame(null);
+    try consume_frame(&[_]u8{ 0x77, 0, 0, 0, 0, 0x95 });
+    try consume_frame(null);
+    try consume_frame(&[_]u8{ 0x56, 0, 0, 0, 0, 0x95 });
+    try consume_frame(null);
+    try consume_frame(&[_]u8{ 0x58, 0, 0, 0, 5, 0x95 });
+    try consume_frame(null);
+    try consume_frame(&[_]u8{0xfe});
+    try consume_frame(block_b[0..]);
+    try consume_frame(crc_b[0..2]);
+    try consume_frame(null);
+    try consume_frame(&[_]u8{0xff});
+
+    try mmc_stub.impl.verify();
+}
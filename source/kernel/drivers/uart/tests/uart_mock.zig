@@ -21,7 +21,16 @@ pub const MockUart = struct {
     pub var write_buffer: [256]u8 = undefined;
     pub var write_index: usize = 0;
     pub var readable: bool = true;
+    // receiver becomes not readable when received data is consumed
+    pub var drain_clears_readable: bool = false;
     pub var baudrate: u32 = 0;
+    pub var rx_callback: ?*const fn (?*anyopaque) void = null;
+    pub var rx_callback_context: ?*anyopaque = null;
+    // null means unlimited space in transmit queue
+    pub var tx_space: ?usize = null;
+    pub var tx_pending: usize = 0;
+    pub var tx_callback: ?*const fn (?*anyopaque) void = null;
+    pub var tx_callback_context: ?*anyopaque = null;
 
     pub fn init(config: anytype) !void {
         baudrate = config.baudrate;
@@ -34,6 +43,13 @@ pub const MockUart = struct {
         read_length = 0;
         write_index = 0;
         readable = true;
+        drain_clears_readable = false;
+        rx_callback = null;
+        rx_callback_context = null;
+        tx_space = null;
+        tx_pending = 0;
+        tx_callback = null;
+        tx_callback_context = null;
         @memset(&read_buffer, 0);
         @memset(&write_buffer, 0);
     }
@@ -51,16 +67,42 @@ pub const MockUart = struct {
         const to_read = @min(buffer.len, read_length - read_index);
         @memcpy(buffer[0..to_read], read_buffer[read_index .. read_index + to_read]);
         read_index += to_read;
+        if (drain_clears_readable and read_index >= read_length) {
+            readable = false;
+        }
         return to_read;
     }
 
     pub fn write_some(data: []const u8) !usize {
-        const to_write = @min(data.len, write_buffer.len - write_index);
+        var to_write = @min(data.len, write_buffer.len - write_index);
+        if (tx_space) |space| {
+            to_write = @min(to_write, space);
+            tx_space = space - to_write;
+        }
         @memcpy(write_buffer[write_index .. write_index + to_write], data[0..to_write]);
         write_index += to_write;
         return to_write;
     }
 
+    pub fn bytes_to_write() usize {
+        return tx_pending;
+    }
+
+    pub fn set_tx_callback(callback: ?*const fn (?*anyopaque) void, context: ?*anyopaque) bool {
+        tx_callback = callback;
+        tx_callback_context = context;
+        return true;
+    }
+
+    // simulates transmit interrupt, queued data was sent
+    pub fn transmit(space: usize) void {
+        tx_space = space;
+        tx_pending = 0;
+        if (tx_callback) |callback| {
+            callback(tx_callback_context);
+        }
+    }
+
     pub fn bytes_to_read() usize {
         return read_length - read_index;
     }
@@ -69,6 +111,21 @@ pub const MockUart = struct {
         return readable;
     }
 
+    pub fn set_rx_callback(callback: ?*const fn (?*anyopaque) void, context: ?*anyopaque) bool {
+        rx_callback = callback;
+        rx_callback_context = context;
+        return true;
+    }
+
+    // simulates receive interrupt
+    pub fn receive(data: []const u8) void {
+        set_read_data(data);
+        readable = true;
+        if (rx_callback) |callback| {
+            callback(rx_callback_context);
+        }
+    }
+
     pub fn get_written_data() []const u8 {
         return write_buffer[0..write_index];
     }
@@ -28,13 +28,114 @@ const kernel = @import("../../kernel.zig");
 const IFile = @import("../../fs/ifile.zig").IFile;
 const FileName = @import("../../fs/ifile.zig").FileName;
 const FileType = @import("../../fs/ifile.zig").FileType;
+const IoctlCommonCommands = @import("../../fs/ifile.zig").IoctlCommonCommands;
+const poll = @import("../../fs/poll.zig");
 
 const interface = @import("interface");
 
-var readbuf: [1024]u8 = undefined;
-
 pub fn UartFile(comptime UartType: anytype) type {
     const Internal = struct {
+        // Received bytes are fetched from driver in chunks, bytes left after line end
+        // in canonical mode are kept for next read. Readers are serialized, so only lock
+        // owner waits for data_ready, which is completed by receive interrupt or VTIME timer.
+        // Pollers are woken by the same interrupt.
+        const Receiver = struct {
+            var pending: [64]u8 = undefined;
+            var pending_start: usize = 0;
+            var pending_end: usize = 0;
+            var data_ready: kernel.sync.Completion = .{};
+            var pollers: kernel.sync.WaitQueue = .{};
+            var rx_notification: bool = false;
+            var reader_lock: kernel.sync.IoLock = .{};
+
+            fn reset() void {
+                pending_start = 0;
+                pending_end = 0;
+                data_ready.reset();
+                rx_notification = UartType.set_rx_callback(&on_receive, null);
+            }
+
+            fn on_receive(_: ?*anyopaque) void {
+                data_ready.complete();
+                pollers.wake_all();
+            }
+
+            fn is_readable() bool {
+                return pending_start != pending_end or UartType.is_readable();
+            }
+
+            fn buffered() []const u8 {
+                return pending[pending_start..pending_end];
+            }
+
+            fn consume(length: usize) void {
+                pending_start += length;
+            }
+
+            // returns false when driver has no data
+            fn fill() bool {
+                if (pending_start != pending_end) {
+                    return true;
+                }
+                pending_start = 0;
+                pending_end = 0;
+                // reset before checking driver, so data received in between is not lost
+                data_ready.reset();
+                if (!UartType.is_readable()) {
+                    return false;
+                }
+                pending_end = UartType.read(pending[0..]) catch 0;
+                return true;
+            }
+
+            fn wait_for_data() void {
+                if (rx_notification) {
+                    data_ready.wait(kernel.process.process_manager.get_running_process());
+                } else {
+                    // give up time slice instead of spinning on empty receiver
+                    hal.irq.trigger(.pendsv);
+                }
+            }
+        };
+
+        // Writes are queued by driver, writer blocks only when transmit queue is full.
+        // Writers are serialized, so only lock owner waits for space_available.
+        const Transmitter = struct {
+            var space_available: kernel.sync.Completion = .{};
+            var tx_notification: bool = false;
+            var writer_lock: kernel.sync.IoLock = .{};
+
+            fn reset() void {
+                space_available.reset();
+                tx_notification = UartType.set_tx_callback(&kernel.sync.Completion.signal, &space_available);
+            }
+
+            fn wait_for_space() void {
+                if (tx_notification) {
+                    space_available.wait(kernel.process.process_manager.get_running_process());
+                } else {
+                    hal.irq.trigger(.pendsv);
+                }
+            }
+
+            // echo from reader goes through the same lock, so it is not interleaved with writes
+            fn write_all(data: []const u8) usize {
+                writer_lock.lock();
+                defer writer_lock.unlock();
+                var written: usize = 0;
+                while (written < data.len) {
+                    // reset before queueing, so interrupt in between is not lost
+                    space_available.reset();
+                    const result = UartType.write_some(data[written..]) catch break;
+                    written += result;
+                    if (result == 0) {
+                        wait_for_space();
+                    }
+                }
+                return written;
+            }
+        };
+
         const UartFileImpl = interface.DeriveFromBase(IFile, struct {
             const Self = @This();
             const uart = UartType;
@@ -52,6 +153,8 @@ pub fn UartFile(comptime UartType: anytype) type {
             }
 
             pub fn create(allocator: std.mem.Allocator, filename: []const u8) UartFileImpl {
+                Receiver.reset();
+                Transmitter.reset();
                 return UartFileImpl.init(.{
                     ._icanonical = true,
                     ._echo = true,
@@ -70,75 +173,106 @@ pub fn UartFile(comptime UartType: anytype) type {
             }
 
             pub fn read(self: *Self, buffer: []u8) isize {
+                Receiver.reader_lock.lock();
+                defer Receiver.reader_lock.unlock();
                 var index: usize = 0;
-                var ch: [1]u8 = .{0};
-                var start_time: u64 = 0;
-                if (self._read_timeout != 0) {
-                    start_time = hal.time.get_time_us() / 1000;
+                // VTIME is given in deciseconds, with VMIN > 0 it is inter-byte timer
+                // started by first received byte, otherwise deadline for whole read
+                const timeout_ms = @as(u64, self._read_timeout) * 100;
+                const inter_byte = self._minimum_bytes_to_read != 0;
+                var deadline = kernel.timer.Timer{
+                    .callback = &kernel.sync.Completion.signal,
+                    .context = &Receiver.data_ready,
+                };
+                var deadline_started = false;
+                if (timeout_ms != 0 and !inter_byte) {
+                    kernel.timer.start(&deadline, timeout_ms);
+                    deadline_started = true;
                 }
+                defer kernel.timer.cancel(&deadline);
                 while (index < buffer.len) {
-                    if (self._read_timeout != 0) {
-                        const current_time = hal.time.get_time_us() / 1000;
-                        if (current_time - start_time >= @as(u64, self._read_timeout) * 100) {
-                            break;
-                        }
+                    if (deadline_started and !deadline.is_armed()) {
+                        break;
                     }
 
-                    if (!Self.uart.is_readable()) {
+                    if (!Receiver.fill()) {
                         if (self._nonblock) {
                             return @intCast(index);
                         } else if (self._raw_mode and index >= self._minimum_bytes_to_read) {
                             return @intCast(index);
                         }
+                        Receiver.wait_for_data();
                         continue;
                     }
 
-                    const result = Self.uart.read(ch[0..]) catch {
-                        continue;
-                    };
-
-                    if (result == 0) {
+                    const chunk = Receiver.buffered();
+                    if (chunk.len == 0) {
                         return @intCast(index);
                     }
 
-                    if (ch[0] == '\r' and !self._raw_mode) {
-                        ch[0] = '\n';
+                    const processed = self.process_input(chunk, buffer, &index);
+                    Receiver.consume(processed.consumed);
+                    if (processed.line_completed) {
+                        break;
+                    }
+                    if (timeout_ms != 0 and inter_byte and processed.consumed != 0) {
+                        kernel.timer.start(&deadline, timeout_ms);
+                        deadline_started = true;
+                    }
+                }
+                return @intCast(index);
+            }
+
+            const ProcessedInput = struct {
+                consumed: usize,
+                line_completed: bool,
+            };
+
+            // line discipline, echo for whole chunk is written at once
+            fn process_input(self: *Self, chunk: []const u8, buffer: []u8, index: *usize) ProcessedInput {
+                var echo: [3 * Receiver.pending.len]u8 = undefined;
+                var echo_length: usize = 0;
+                var result = ProcessedInput{ .consumed = 0, .line_completed = false };
+                for (chunk) |byte| {
+                    if (index.* >= buffer.len) {
+                        break;
+                    }
+                    result.consumed += 1;
+                    var ch = byte;
+                    if (ch == '\r' and !self._raw_mode) {
+                        ch = '\n';
                     }
 
-                    if ((ch[0] == 8 or ch[0] == 127) and self._icanonical) {
-                        if (index > 0) {
-                            buffer[index] = 0;
-                            index -= 1;
+                    if ((ch == 8 or ch == 127) and self._icanonical) {
+                        if (index.* > 0) {
+                            index.* -= 1;
                             if (self._echo) {
-                                ch[0] = 8;
-                                _ = Self.uart.write_some(ch[0..1]) catch {};
-                                ch[0] = ' ';
-                                _ = Self.uart.write_some(ch[0..1]) catch {};
-                                ch[0] = 8;
-                                _ = Self.uart.write_some(ch[0..1]) catch {};
+                                @memcpy(echo[echo_length..][0..3], "\x08 \x08");
+                                echo_length += 3;
                             }
                         }
                         continue;
                     }
-                    buffer[index] = ch[0];
+                    buffer[index.*] = ch;
+                    index.* += 1;
                     if (self._echo) {
-                        _ = uart.write_some(ch[0..1]) catch {};
+                        echo[echo_length] = ch;
+                        echo_length += 1;
                     }
-                    index += 1;
-                    if (self._icanonical) {
-                        if (ch[0] == 0 or ch[0] == '\n' or ch[0] == -1) {
-                            break;
-                        }
+                    if (self._icanonical and (ch == 0 or ch == '\n')) {
+                        result.line_completed = true;
+                        break;
                     }
-                    // return @intCast(index);
                 }
-                return @intCast(index);
+                if (echo_length != 0) {
+                    _ = Transmitter.write_all(echo[0..echo_length]);
+                }
+                return result;
             }
 
             pub fn write(self: *Self, data: []const u8) isize {
                 _ = self;
-                const result = uart.write_some(data) catch return 0;
-                return @intCast(result);
+                return @intCast(Transmitter.write_all(data));
             }
 
             pub fn seek(self: *Self, _: i64, _: i32) anyerror!i64 {
@@ -146,8 +280,19 @@ pub fn UartFile(comptime UartType: anytype) type {
                 return 0;
             }
 
+            // tcdrain semantics, returns when queued data was sent
             pub fn sync(self: *Self) i32 {
                 _ = self;
+                // space_available has single waiter, so wait as writer
+                Transmitter.writer_lock.lock();
+                defer Transmitter.writer_lock.unlock();
+                while (true) {
+                    Transmitter.space_available.reset();
+                    if (uart.bytes_to_write() == 0) {
+                        break;
+                    }
+                    Transmitter.wait_for_space();
+                }
                 return 0;
             }
 
@@ -213,6 +358,9 @@ pub fn UartFile(comptime UartType: anytype) type {
                             readable.* = @intCast(self.size());
                             return 0;
                         },
+                        @intFromEnum(IoctlCommonCommands.Poll) => {
+                            return self.poll_readiness(@ptrCast(@alignCast(termios_arg)));
+                        },
                         else => {
                             return -1;
                         },
@@ -221,6 +369,22 @@ pub fn UartFile(comptime UartType: anytype) type {
                 return -1;
             }
 
+            // writes are queued by driver, so only receiver readiness is tracked
+            fn poll_readiness(self: *Self, request: *poll.PollRequest) i32 {
+                _ = self;
+                if (Receiver.rx_notification) {
+                    request.watch(&Receiver.pollers);
+                } else {
+                    request.needs_polling = true;
+                }
+                var ready: i16 = poll.POLLOUT;
+                if (Receiver.is_readable()) {
+                    ready |= poll.POLLIN;
+                }
+                request.report(ready);
+                return 0;
+            }
+
             pub fn fcntl(self: *Self, op: i32, maybe_arg: ?*anyopaque) i32 {
                 var result: i32 = 0;
                 switch (op) {
@@ -245,7 +409,7 @@ pub fn UartFile(comptime UartType: anytype) type {
 
             pub fn size(self: *const Self) u64 {
                 _ = self;
-                return uart.bytes_to_read();
+                return uart.bytes_to_read() + Receiver.buffered().len;
             }
 
             pub fn filetype(self: *const Self) FileType {
@@ -315,6 +479,52 @@ test "UartFile.Write.ShouldWriteToUart" {
     try std.testing.expectEqualStrings(data, MockUart.get_written_data());
 }
 
+const TransmitOnContextSwitch = struct {
+    var count: usize = 0;
+
+    pub fn call() void {
+        count += 1;
+        MockUart.transmit(8);
+    }
+};
+
+test "UartFile.Write.ShouldWaitForSpaceWhenQueueIsFull" {
+    MockUart.reset();
+    defer MockUart.reset();
+    defer hal.irq.impl().clear();
+
+    var file = TestUartFile.InstanceType.create(std.testing.allocator, "uart0");
+    MockUart.tx_space = 4;
+    const data = "Hello, UART!";
+
+    TransmitOnContextSwitch.count = 0;
+    hal.irq.impl().set_irq_action(.pendsv, &TransmitOnContextSwitch.call);
+    const written = file.data().write(data);
+    try std.testing.expectEqual(@as(isize, @intCast(data.len)), written);
+    try std.testing.expectEqualStrings(data, MockUart.get_written_data());
+    try std.testing.expectEqual(1, TransmitOnContextSwitch.count);
+}
+
+test "UartFile.Sync.ShouldWaitUntilQueueIsSent" {
+    MockUart.reset();
+    defer MockUart.reset();
+    defer hal.irq.impl().clear();
+
+    var file = TestUartFile.InstanceType.create(std.testing.allocator, "uart0");
+    MockUart.tx_pending = 10;
+
+    TransmitOnContextSwitch.count = 0;
+    hal.irq.impl().set_irq_action(.pendsv, &TransmitOnContextSwitch.call);
+    try std.testing.expectEqual(@as(i32, 0), file.data().sync());
+    try std.testing.expectEqual(0, MockUart.bytes_to_write());
+    try std.testing.expectEqual(1, TransmitOnContextSwitch.count);
+
+    // writer lock is released after draining
+    const written = file.data().write("ok");
+    try std.testing.expectEqual(@as(isize, 2), written);
+    try std.testing.expectEqual(1, TransmitOnContextSwitch.count);
+}
+
 test "UartFile.Read.ShouldReadFromUart" {
     MockUart.reset();
     defer MockUart.reset();
@@ -396,6 +606,141 @@ test "UartFile.Read.ShouldReturnImmediatelyInNonBlockMode" {
     try std.testing.expectEqual(@as(isize, 0), bytes_read);
 }
 
+const ElapsedTicks = struct {
+    const irq_systick = @import("../../interrupts/systick.zig").irq_systick;
+    var count: usize = 0;
+
+    pub fn call() void {
+        count += 1;
+        irq_systick();
+    }
+};
+
+test "UartFile.Read.ShouldReturnAfterReadTimeout" {
+    MockUart.reset();
+    defer MockUart.reset();
+    defer hal.irq.impl().clear();
+    MockUart.readable = false;
+
+    var file = TestUartFile.InstanceType.create(std.testing.allocator, "uart0");
+    file.data()._read_timeout = 2;
+    file.data()._minimum_bytes_to_read = 0;
+    var buffer: [10]u8 = undefined;
+
+    // every yield advances time by one tick
+    ElapsedTicks.count = 0;
+    hal.irq.impl().set_irq_action(.pendsv, &ElapsedTicks.call);
+    const bytes_read = file.data().read(&buffer);
+    try std.testing.expectEqual(@as(isize, 0), bytes_read);
+    try std.testing.expectEqual(200, ElapsedTicks.count);
+}
+
+const ReceiveOnContextSwitch = struct {
+    var count: usize = 0;
+
+    pub fn call() void {
+        count += 1;
+        MockUart.receive("ok\n");
+    }
+};
+
+test "UartFile.Read.ShouldBlockUntilReceiveInterrupt" {
+    MockUart.reset();
+    defer MockUart.reset();
+    defer hal.irq.impl().clear();
+    MockUart.readable = false;
+
+    var file = TestUartFile.InstanceType.create(std.testing.allocator, "uart0");
+    file.data()._echo = false;
+    var buffer: [10]u8 = undefined;
+
+    ReceiveOnContextSwitch.count = 0;
+    hal.irq.impl().set_irq_action(.pendsv, &ReceiveOnContextSwitch.call);
+    const bytes_read = file.data().read(&buffer);
+    try std.testing.expectEqual(@as(isize, 3), bytes_read);
+    try std.testing.expectEqualStrings("ok\n", buffer[0..@intCast(bytes_read)]);
+    try std.testing.expectEqual(1, ReceiveOnContextSwitch.count);
+}
+
+const ReceiveBetweenTicks = struct {
+    const irq_systick = @import("../../interrupts/systick.zig").irq_systick;
+    var count: usize = 0;
+
+    pub fn call() void {
+        count += 1;
+        if (count == 1) {
+            MockUart.receive("ab");
+        } else if (count == 51) {
+            MockUart.receive("c");
+        } else {
+            irq_systick();
+        }
+    }
+};
+
+test "UartFile.Read.ShouldRestartInterByteTimerAfterEachReceivedByte" {
+    MockUart.reset();
+    defer MockUart.reset();
+    defer hal.irq.impl().clear();
+    MockUart.readable = false;
+    MockUart.drain_clears_readable = true;
+
+    var file = TestUartFile.InstanceType.create(std.testing.allocator, "uart0");
+    file.data()._icanonical = false;
+    file.data()._echo = false;
+    file.data()._raw_mode = true;
+    file.data()._read_timeout = 1;
+    file.data()._minimum_bytes_to_read = 5;
+    var buffer: [10]u8 = undefined;
+
+    ReceiveBetweenTicks.count = 0;
+    hal.irq.impl().set_irq_action(.pendsv, &ReceiveBetweenTicks.call);
+    const bytes_read = file.data().read(&buffer);
+    try std.testing.expectEqual(@as(isize, 3), bytes_read);
+    try std.testing.expectEqualStrings("abc", buffer[0..@intCast(bytes_read)]);
+    // timer is not running before first byte and is restarted by the second receive
+    try std.testing.expectEqual(151, ReceiveBetweenTicks.count);
+
+    // reader lock is released, so next reader is not blocked
+    file.data()._nonblock = true;
+    try std.testing.expectEqual(@as(isize, 0), file.data().read(&buffer));
+}
+
+test "UartFile.Ioctl.Poll.ShouldWakePollerOnReceiveInterrupt" {
+    MockUart.reset();
+    defer MockUart.reset();
+    MockUart.readable = false;
+
+    var file = TestUartFile.InstanceType.create(std.testing.allocator, "uart0");
+    var done = kernel.sync.Completion{};
+    var request = poll.PollRequest{ .events = poll.POLLIN, .completion = &done };
+    try std.testing.expectEqual(0, file.data().ioctl(@intFromEnum(IoctlCommonCommands.Poll), &request));
+    try std.testing.expectEqual(0, request.revents);
+
+    MockUart.receive("x");
+    try std.testing.expect(done.is_done());
+    request.release();
+    try std.testing.expectEqual(0, file.data().ioctl(@intFromEnum(IoctlCommonCommands.Poll), &request));
+    try std.testing.expectEqual(poll.POLLIN, request.revents);
+    request.release();
+}
+
+test "UartFile.Read.ShouldKeepBytesAfterLineEndForNextRead" {
+    MockUart.reset();
+    defer MockUart.reset();
+    MockUart.set_read_data("hello\nworld");
+
+    var file = TestUartFile.InstanceType.create(std.testing.allocator, "uart0");
+    file.data()._echo = false;
+    var buffer: [20]u8 = undefined;
+
+    try std.testing.expectEqual(@as(isize, 6), file.data().read(&buffer));
+    try std.testing.expectEqual(5, file.data().size());
+    const bytes_read = file.data().read(&buffer);
+    try std.testing.expectEqual(@as(isize, 5), bytes_read);
+    try std.testing.expectEqualStrings("world", buffer[0..@intCast(bytes_read)]);
+}
+
 test "UartFile.Ioctl.TCGETS.ShouldReturnCurrentSettings" {
     MockUart.reset();
     defer MockUart.reset();
@@ -51,6 +51,7 @@ pub const ErrnoSet = error{
     MathArgumentOutOfDomain,
     MathResultNotRepresentable,
     TooManySymbolicLinks,
+    NameTooLong,
     Invalid,
     NotImplemented,
 };
@@ -92,6 +93,7 @@ pub fn from_errno(rc: u16) anyerror {
         c.EDOM => ErrnoSet.MathArgumentOutOfDomain,
         c.ERANGE => ErrnoSet.MathResultNotRepresentable,
         c.ELOOP => ErrnoSet.TooManySymbolicLinks,
+        c.ENAMETOOLONG => ErrnoSet.NameTooLong,
         c.ENOSYS => ErrnoSet.NotImplemented,
         else => ErrnoSet.Invalid,
     };
@@ -134,6 +136,7 @@ pub fn to_errno(err: anyerror) u16 {
         ErrnoSet.MathArgumentOutOfDomain => c.EDOM,
         ErrnoSet.MathResultNotRepresentable => c.ERANGE,
         ErrnoSet.TooManySymbolicLinks => c.ELOOP,
+        ErrnoSet.NameTooLong => c.ENAMETOOLONG,
         ErrnoSet.NotImplemented => c.ENOSYS,
         else => c.EINVAL,
     };
@@ -177,6 +180,7 @@ test "Errno.ShouldConvertFromErrnoToErrorSet" {
     try std.testing.expectEqual(ErrnoSet.MathArgumentOutOfDomain, from_errno(c.EDOM));
     try std.testing.expectEqual(ErrnoSet.MathResultNotRepresentable, from_errno(c.ERANGE));
     try std.testing.expectEqual(ErrnoSet.TooManySymbolicLinks, from_errno(c.ELOOP));
+    try std.testing.expectEqual(ErrnoSet.NameTooLong, from_errno(c.ENAMETOOLONG));
     try std.testing.expectEqual(ErrnoSet.NotImplemented, from_errno(c.ENOSYS));
 }
 
@@ -221,6 +225,7 @@ test "Errno.ShouldConvertFromErrorSetToErrno" {
     try std.testing.expectEqual(@as(u16, c.EDOM), to_errno(ErrnoSet.MathArgumentOutOfDomain));
     try std.testing.expectEqual(@as(u16, c.ERANGE), to_errno(ErrnoSet.MathResultNotRepresentable));
     try std.testing.expectEqual(@as(u16, c.ELOOP), to_errno(ErrnoSet.TooManySymbolicLinks));
+    try std.testing.expectEqual(@as(u16, c.ENAMETOOLONG), to_errno(ErrnoSet.NameTooLong));
     try std.testing.expectEqual(@as(u16, c.ENOSYS), to_errno(ErrnoSet.NotImplemented));
 }
 
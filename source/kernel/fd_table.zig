@@ -0,0 +1,344 @@
+//
+// fd_table.zig
+//
+// Copyright (C) 2025 Mateusz Stadnik <matgla@live.com>
+//
+// This program is free software: you can redistribute it and/or
+// modify it under the terms of the GNU General Public License
+// as published by the Free Software Foundation, either version
+// 3 of the License, or (at your option) any later version.
+//
+// This program is distributed in the hope that it will be
+// useful, but WITHOUT ANY WARRANTY; without even the implied
+// warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR
+// PURPOSE. See the GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General
+// Public License along with this program. If not, see
+// <https://www.gnu.org/licenses/>.
+//
+
+const std = @import("std");
+
+const arch = @import("arch");
+
+const kernel = @import("kernel.zig");
+
+// Per-process file descriptor table. Descriptor is an index into slots, the first
+// inline_capacity slots are stored in the table itself, further ones are allocated
+// in chunks covered by a single bitmap word. Used slots are marked in bitmaps,
+// so the lowest free descriptor is found with a bit scan.
+// Handles are reference counted, descriptors created by dup and tables copied on vfork
+// share the same handle, which is closed when the last reference is released.
+pub fn FdTable(comptime Handle: type) type {
+    return struct {
+        const Self = @This();
+        const Word = usize;
+        const word_bits = @bitSizeOf(Word);
+        pub const inline_capacity = 8;
+        pub const chunk_size = word_bits;
+        pub const max_descriptors = std.math.maxInt(i16) + 1;
+        const InlineMask = std.meta.Int(.unsigned, inline_capacity);
+
+        const Entry = struct {
+            handle: Handle,
+            references: usize,
+        };
+        pub const Detached = *Entry;
+
+        _allocator: std.mem.Allocator,
+        _inline: [inline_capacity]?*Entry = [_]?*Entry{null} ** inline_capacity,
+        _inline_used: InlineMask = 0,
+        // overflow.len is always equal to overflow_used.len * chunk_size
+        _overflow: []?*Entry = &.{},
+        _overflow_used: []Word = &.{},
+
+        pub fn init(allocator: std.mem.Allocator) Self {
+            return .{
+                ._allocator = allocator,
+            };
+        }
+
+        pub fn deinit(self: *Self) void {
+            for (0..self.capacity()) |fd| {
+                self.remove(fd);
+            }
+            self._allocator.free(self._overflow);
+            self._allocator.free(self._overflow_used);
+            self._overflow = &.{};
+            self._overflow_used = &.{};
+        }
+
+        // every handle gets additional reference, tables share handles until released
+        pub fn clone(self: *const Self) !Self {
+            var table = Self.init(self._allocator);
+            table._overflow = try self._allocator.dupe(?*Entry, self._overflow);
+            errdefer self._allocator.free(table._overflow);
+            table._overflow_used = try self._allocator.dupe(Word, self._overflow_used);
+            table._inline = self._inline;
+            table._inline_used = self._inline_used;
+
+            const state = arch.sync.save_and_disable_interrupts();
+            defer arch.sync.restore_interrupts(state);
+            for (table._inline) |maybe_entry| {
+                if (maybe_entry) |entry| entry.references += 1;
+            }
+            for (table._overflow) |maybe_entry| {
+                if (maybe_entry) |entry| entry.references += 1;
+            }
+            return table;
+        }
+
+        pub fn capacity(self: *const Self) usize {
+            return inline_capacity + self._overflow.len;
+        }
+
+        pub fn lowest_free(self: *const Self) usize {
+            const inline_free = ~self._inline_used;
+            if (inline_free != 0) {
+                return @ctz(inline_free);
+            }
+            for (self._overflow_used, 0..) |used, index| {
+                if (~used != 0) {
+                    return inline_capacity + index * chunk_size + @ctz(~used);
+                }
+            }
+            return self.capacity();
+        }
+
+        pub fn get(self: *Self, fd: usize) ?*Handle {
+            const entry = self.entry_at(fd) orelse return null;
+            return &entry.handle;
+        }
+
+        // handle placed at used descriptor replaces previous one
+        pub fn install(self: *Self, fd: usize, handle: Handle) !void {
+            try self.reserve(fd);
+            const entry = try self._allocator.create(Entry);
+            entry.* = .{
+                .handle = handle,
+                .references = 1,
+            };
+            self.store(fd, entry);
+        }
+
+        // newfd refers to the same handle as fd, like dup2
+        pub fn share(self: *Self, fd: usize, newfd: usize) !void {
+            const entry = self.entry_at(fd) orelse return kernel.errno.ErrnoSet.BadFileDescriptor;
+            if (fd == newfd) {
+                return;
+            }
+            try self.reserve(newfd);
+            acquire(entry);
+            self.store(newfd, entry);
+        }
+
+        pub fn remove(self: *Self, fd: usize) void {
+            const entry = self.detach(fd) orelse return;
+            self.release(entry);
+        }
+
+        // frees descriptor, but handle is closed later by put, so closing may wait for I/O
+        pub fn detach(self: *Self, fd: usize) ?Detached {
+            const target = self.slot(fd) orelse return null;
+            const entry = target.* orelse return null;
+            target.* = null;
+            self.mark(fd, false);
+            return entry;
+        }
+
+        pub fn put(self: *Self, detached: Detached) void {
+            self.release(detached);
+        }
+
+        fn slot(self: *Self, fd: usize) ?*?*Entry {
+            if (fd < inline_capacity) {
+                return &self._inline[fd];
+            }
+            if (fd - inline_capacity < self._overflow.len) {
+                return &self._overflow[fd - inline_capacity];
+            }
+            return null;
+        }
+
+        fn entry_at(self: *Self, fd: usize) ?*Entry {
+            const target = self.slot(fd) orelse return null;
+            return target.*;
+        }
+
+        // descriptor must be reserved before
+        fn store(self: *Self, fd: usize, entry: *Entry) void {
+            const target = self.slot(fd).?;
+            const previous = target.*;
+            target.* = entry;
+            self.mark(fd, true);
+            if (previous) |old| {
+                self.release(old);
+            }
+        }
+
+        fn mark(self: *Self, fd: usize, used: bool) void {
+            if (fd < inline_capacity) {
+                const bit = @as(InlineMask, 1) << @intCast(fd);
+                self._inline_used = if (used) self._inline_used | bit else self._inline_used & ~bit;
+                return;
+            }
+            const index = fd - inline_capacity;
+            const bit = @as(Word, 1) << @intCast(index % chunk_size);
+            const word = &self._overflow_used[index / chunk_size];
+            word.* = if (used) word.* | bit else word.* & ~bit;
+        }
+
+        // grows overflow slots in whole chunks until fd fits
+        fn reserve(self: *Self, fd: usize) !void {
+            if (fd >= max_descriptors) {
+                return kernel.errno.ErrnoSet.TooManyOpenFiles;
+            }
+            if (fd < self.capacity()) {
+                return;
+            }
+            const chunks = (fd - inline_capacity) / chunk_size + 1;
+            const overflow = try self._allocator.alloc(?*Entry, chunks * chunk_size);
+            errdefer self._allocator.free(overflow);
+            const overflow_used = try self._allocator.alloc(Word, chunks);
+
+            @memcpy(overflow[0..self._overflow.len], self._overflow);
+            @memset(overflow[self._overflow.len..], null);
+            @memcpy(overflow_used[0..self._overflow_used.len], self._overflow_used);
+            @memset(overflow_used[self._overflow_used.len..], 0);
+
+            self._allocator.free(self._overflow);
+            self._allocator.free(self._overflow_used);
+            self._overflow = overflow;
+            self._overflow_used = overflow_used;
+        }
+
+        fn acquire(entry: *Entry) void {
+            const state = arch.sync.save_and_disable_interrupts();
+            defer arch.sync.restore_interrupts(state);
+            entry.references += 1;
+        }
+
+        fn release(self: *Self, entry: *Entry) void {
+            const state = arch.sync.save_and_disable_interrupts();
+            entry.references -= 1;
+            const last = entry.references == 0;
+            arch.sync.restore_interrupts(state);
+            if (last) {
+                entry.handle.close();
+                self._allocator.destroy(entry);
+            }
+        }
+    };
+}
+
+const HandleMock = struct {
+    var closed: usize = 0;
+    id: usize,
+
+    pub fn close(self: *HandleMock) void {
+        _ = self;
+        closed += 1;
+    }
+};
+
+const FdTableUnderTest = FdTable(HandleMock);
+
+test "FdTable.ShouldReturnLowestFreeDescriptor" {
+    var sut = FdTableUnderTest.init(std.testing.allocator);
+    defer sut.deinit();
+
+    try std.testing.expectEqual(0, sut.lowest_free());
+    try sut.install(0, .{ .id = 0 });
+    try sut.install(1, .{ .id = 1 });
+    try sut.install(2, .{ .id = 2 });
+    try std.testing.expectEqual(3, sut.lowest_free());
+
+    sut.remove(1);
+    try std.testing.expectEqual(1, sut.lowest_free());
+    try std.testing.expect(sut.get(1) == null);
+    try std.testing.expectEqual(2, sut.get(2).?.id);
+}
+
+test "FdTable.ShouldGrowInChunksAboveInlineSlots" {
+    var sut = FdTableUnderTest.init(std.testing.allocator);
+    defer sut.deinit();
+
+    for (0..FdTableUnderTest.inline_capacity + 1) |fd| {
+        try sut.install(sut.lowest_free(), .{ .id = fd });
+    }
+    try std.testing.expectEqual(FdTableUnderTest.inline_capacity + FdTableUnderTest.chunk_size, sut.capacity());
+    try std.testing.expectEqual(FdTableUnderTest.inline_capacity + 1, sut.lowest_free());
+    try std.testing.expectEqual(FdTableUnderTest.inline_capacity, sut.get(FdTableUnderTest.inline_capacity).?.id);
+
+    const far = FdTableUnderTest.inline_capacity + 3 * FdTableUnderTest.chunk_size;
+    try sut.install(far, .{ .id = far });
+    try std.testing.expectEqual(far, sut.get(far).?.id);
+    try std.testing.expectEqual(FdTableUnderTest.inline_capacity + 1, sut.lowest_free());
+    try std.testing.expect(sut.get(far + 1) == null);
+    try std.testing.expectError(error.TooManyOpenFiles, sut.install(FdTableUnderTest.max_descriptors, .{ .id = 0 }));
+}
+
+test "FdTable.ShouldCloseSharedHandleWithLastReference" {
+    HandleMock.closed = 0;
+    var sut = FdTableUnderTest.init(std.testing.allocator);
+    defer sut.deinit();
+
+    try sut.install(0, .{ .id = 7 });
+    try sut.share(0, 12);
+    try std.testing.expectEqual(sut.get(0).?, sut.get(12).?);
+    try std.testing.expectError(error.BadFileDescriptor, sut.share(3, 4));
+
+    sut.remove(0);
+    try std.testing.expectEqual(0, HandleMock.closed);
+    try std.testing.expectEqual(7, sut.get(12).?.id);
+    sut.remove(12);
+    try std.testing.expectEqual(1, HandleMock.closed);
+}
+
+test "FdTable.ShouldCloseDetachedHandleOnPut" {
+    var sut = FdTableUnderTest.init(std.testing.allocator);
+    defer sut.deinit();
+    HandleMock.closed = 0;
+
+    try sut.install(0, .{ .id = 0 });
+    const detached = sut.detach(0).?;
+    try std.testing.expect(sut.get(0) == null);
+    try std.testing.expectEqual(0, sut.lowest_free());
+    try std.testing.expectEqual(0, HandleMock.closed);
+    try std.testing.expect(sut.detach(0) == null);
+
+    sut.put(detached);
+    try std.testing.expectEqual(1, HandleMock.closed);
+}
+
+test "FdTable.ShouldReplaceHandleAtUsedDescriptor" {
+    HandleMock.closed = 0;
+    var sut = FdTableUnderTest.init(std.testing.allocator);
+    defer sut.deinit();
+
+    try sut.install(0, .{ .id = 1 });
+    try sut.install(1, .{ .id = 2 });
+    try sut.share(0, 1);
+    try std.testing.expectEqual(1, HandleMock.closed);
+    try std.testing.expectEqual(1, sut.get(1).?.id);
+}
+
+test "FdTable.ShouldShareHandlesWithClone" {
+    HandleMock.closed = 0;
+    var sut = FdTableUnderTest.init(std.testing.allocator);
+    defer sut.deinit();
+
+    try sut.install(0, .{ .id = 1 });
+    try sut.install(20, .{ .id = 2 });
+
+    var copy = try sut.clone();
+    try std.testing.expectEqual(sut.get(0).?, copy.get(0).?);
+    try std.testing.expectEqual(sut.get(20).?, copy.get(20).?);
+
+    copy.remove(0);
+    try std.testing.expect(sut.get(0) != null);
+    copy.deinit();
+    try std.testing.expectEqual(0, HandleMock.closed);
+    try std.testing.expectEqual(2, sut.get(20).?.id);
+}
@@ -0,0 +1,645 @@
+// Copyright (c) 2025 Mateusz Stadnik
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program. If not, see <https://www.gnu.org/licenses/>.
+
+const std = @import("std");
+
+const c = @import("libc_imports").c;
+const interface = @import("interface");
+
+const kernel = @import("../kernel.zig");
+
+const log = std.log.scoped(.@"vfs/block_cache");
+
+// Sector cache shared by all block devices used as filesystem backends.
+// Filesystems issue a lot of small reads of the same sectors (headers,
+// FAT tables, directory entries), those are served from memory here.
+// Writes are kept in cache until sync() or eviction of the sector.
+pub const BlockCache = struct {
+    const Self = @This();
+    pub const sector_size = 512;
+
+    pub const Device = struct {
+        file: kernel.fs.IFile,
+        size: u64,
+        _refcount: usize,
+    };
+
+    pub const Statistics = struct {
+        sectors: usize,
+        dirty: usize,
+        hits: u64,
+        misses: u64,
+        writebacks: u64,
+        bypassed: u64,
+    };
+
+    const Key = struct {
+        device: usize,
+        sector: u64,
+    };
+
+    const Entry = struct {
+        device: ?*Device = null,
+        sector: u64 = 0,
+        dirty: bool = false,
+        data: []u8,
+        node: std.DoublyLinkedList.Node = .{},
+    };
+
+    _allocator: std.mem.Allocator,
+    _storage_allocator: std.mem.Allocator,
+    _storage: []u8,
+    _entries: []Entry,
+    _index: std.AutoHashMapUnmanaged(Key, *Entry),
+    // most recently used first, unused entries are kept at the tail
+    _lru: std.DoublyLinkedList,
+    _lock: kernel.sync.IoLock,
+    _hits: u64,
+    _misses: u64,
+    _writebacks: u64,
+    _bypassed: u64,
+
+    // storage_allocator provides sector buffers, it may be different from allocator, i.e. PSRAM pages
+    pub fn init(allocator: std.mem.Allocator, storage_allocator: std.mem.Allocator, number_of_sectors: usize) !BlockCache {
+        const storage = try storage_allocator.alloc(u8, number_of_sectors * sector_size);
+        errdefer storage_allocator.free(storage);
+        const entries = try allocator.alloc(Entry, number_of_sectors);
+        errdefer allocator.free(entries);
+        var index: std.AutoHashMapUnmanaged(Key, *Entry) = .empty;
+        // index never holds more than number_of_sectors keys, so lookups never allocate
+        try index.ensureTotalCapacity(allocator, @intCast(number_of_sectors));
+
+        var cache = BlockCache{
+            ._allocator = allocator,
+            ._storage_allocator = storage_allocator,
+            ._storage = storage,
+            ._entries = entries,
+            ._index = index,
+            ._lru = .{},
+            ._lock = .{},
+            ._hits = 0,
+            ._misses = 0,
+            ._writebacks = 0,
+            ._bypassed = 0,
+        };
+        for (entries, 0..) |*entry, i| {
+            entry.* = .{ .data = storage[i * sector_size ..][0..sector_size] };
+            cache._lru.append(&entry.node);
+        }
+        return cache;
+    }
+
+    pub fn deinit(self: *Self) void {
+        _ = self.flush(null);
+        for (self._entries) |entry| {
+            if (entry.device != null) {
+                log.warn("device still attached on deinitialization", .{});
+                break;
+            }
+        }
+        self._index.deinit(self._allocator);
+        self._allocator.free(self._entries);
+        self._storage_allocator.free(self._storage);
+    }
+
+    pub fn attach(self: *Self, file: kernel.fs.IFile) !*Device {
+        const device = try self._allocator.create(Device);
+        errdefer self._allocator.destroy(device);
+        device.* = .{
+            .file = try file.clone(),
+            .size = 0,
+            ._refcount = 1,
+        };
+        device.size = device.file.interface.size();
+        return device;
+    }
+
+    pub fn share(self: *Self, device: *Device) *Device {
+        self._lock.lock();
+        defer self._lock.unlock();
+        device._refcount += 1;
+        return device;
+    }
+
+    // last user writes back and drops all sectors cached for device
+    pub fn detach(self: *Self, device: *Device) void {
+        self._lock.lock();
+        device._refcount -= 1;
+        if (device._refcount != 0) {
+            self._lock.unlock();
+            return;
+        }
+        for (self._entries) |*entry| {
+            if (entry.device == device) {
+                _ = self.write_back(entry);
+                self.forget(entry);
+            }
+        }
+        self._lock.unlock();
+        device.file.interface.delete();
+        self._allocator.destroy(device);
+    }
+
+    pub fn read(self: *Self, device: *Device, offset: u64, buffer: []u8) isize {
+        if (offset >= device.size) {
+            return 0;
+        }
+        const length: usize = @intCast(@min(buffer.len, device.size - offset));
+        self._lock.lock();
+        defer self._lock.unlock();
+
+        var done: usize = 0;
+        while (done < length) {
+            const position = offset + done;
+            const sector = position / sector_size;
+            const sector_offset: usize = @intCast(position % sector_size);
+            const remaining = length - done;
+            if (sector_offset == 0 and remaining >= 2 * sector_size) {
+                // bulk transfers go straight to device, they would only thrash cache
+                const count = self.uncached_run(device, sector, remaining / sector_size);
+                if (count >= 2) {
+                    const chunk = buffer[done..][0 .. count * sector_size];
+                    if (!device_read(device, sector, chunk)) break;
+                    self._bypassed += count;
+                    done += chunk.len;
+                    continue;
+                }
+            }
+            const entry = self.acquire(device, sector, true) orelse break;
+            const chunk_length = @min(sector_size - sector_offset, remaining);
+            @memcpy(buffer[done..][0..chunk_length], entry.data[sector_offset..][0..chunk_length]);
+            done += chunk_length;
+        }
+
+        if (done == 0 and length != 0) {
+            return -1;
+        }
+        return @intCast(done);
+    }
+
+    pub fn write(self: *Self, device: *Device, offset: u64, buffer: []const u8) isize {
+        if (offset >= device.size) {
+            return 0;
+        }
+        const length: usize = @intCast(@min(buffer.len, device.size - offset));
+        self._lock.lock();
+        defer self._lock.unlock();
+
+        var done: usize = 0;
+        while (done < length) {
+            const position = offset + done;
+            const sector = position / sector_size;
+            const sector_offset: usize = @intCast(position % sector_size);
+            const remaining = length - done;
+            if (sector_offset == 0 and remaining >= 2 * sector_size) {
+                const count = remaining / sector_size;
+                const chunk = buffer[done..][0 .. count * sector_size];
+                if (!device_write(device, sector, chunk)) break;
+                self.refresh(device, sector, chunk);
+                self._bypassed += count;
+                done += chunk.len;
+                continue;
+            }
+            // whole sector is overwritten, no need to fetch it from device
+            const whole_sector = sector_offset == 0 and remaining >= sector_size;
+            const entry = self.acquire(device, sector, !whole_sector) orelse break;
+            const chunk_length = @min(sector_size - sector_offset, remaining);
+            @memcpy(entry.data[sector_offset..][0..chunk_length], buffer[done..][0..chunk_length]);
+            entry.dirty = true;
+            done += chunk_length;
+        }
+
+        if (done == 0 and length != 0) {
+            return -1;
+        }
+        return @intCast(done);
+    }
+
+    // writes back dirty sectors of device, or of all devices when null
+    pub fn flush(self: *Self, device: ?*Device) i32 {
+        self._lock.lock();
+        defer self._lock.unlock();
+        var result: i32 = 0;
+        for (self._entries) |*entry| {
+            if (entry.device == null) continue;
+            if (device != null and entry.device != device) continue;
+            if (!self.write_back(entry)) {
+                result = -1;
+            }
+        }
+        return result;
+    }
+
+    pub fn get_statistics(self: *const Self) Statistics {
+        var dirty: usize = 0;
+        for (self._entries) |entry| {
+            if (entry.dirty) dirty += 1;
+        }
+        return .{
+            .sectors = self._entries.len,
+            .dirty = dirty,
+            .hits = self._hits,
+            .misses = self._misses,
+            .writebacks = self._writebacks,
+            .bypassed = self._bypassed,
+        };
+    }
+
+    fn find(self: *Self, device: *Device, sector: u64) ?*Entry {
+        return self._index.get(.{ .device = @intFromPtr(device), .sector = sector });
+    }
+
+    fn acquire(self: *Self, device: *Device, sector: u64, load: bool) ?*Entry {
+        if (self.find(device, sector)) |entry| {
+            self._hits += 1;
+            self.touch(entry);
+            return entry;
+        }
+
+        self._misses += 1;
+        const node = self._lru.last orelse return null;
+        const entry: *Entry = @fieldParentPtr("node", node);
+        if (entry.device != null) {
+            if (!self.write_back(entry)) return null;
+            self.forget(entry);
+        }
+        if (load and !device_read(device, sector, entry.data)) {
+            return null;
+        }
+        entry.device = device;
+        entry.sector = sector;
+        entry.dirty = false;
+        self._index.putAssumeCapacity(.{ .device = @intFromPtr(device), .sector = sector }, entry);
+        self.touch(entry);
+        return entry;
+    }
+
+    fn touch(self: *Self, entry: *Entry) void {
+        self._lru.remove(&entry.node);
+        self._lru.prepend(&entry.node);
+    }
+
+    fn forget(self: *Self, entry: *Entry) void {
+        _ = self._index.remove(.{ .device = @intFromPtr(entry.device.?), .sector = entry.sector });
+        entry.device = null;
+        entry.dirty = false;
+        self._lru.remove(&entry.node);
+        self._lru.append(&entry.node);
+    }
+
+    fn write_back(self: *Self, entry: *Entry) bool {
+        if (!entry.dirty) {
+            return true;
+        }
+        if (!device_write(entry.device.?, entry.sector, entry.data)) {
+            log.err("write back of sector {d} failed", .{entry.sector});
+            return false;
+        }
+        entry.dirty = false;
+        self._writebacks += 1;
+        return true;
+    }
+
+    fn uncached_run(self: *Self, device: *Device, sector: u64, max: usize) usize {
+        var count: usize = 0;
+        while (count < max and self.find(device, sector + count) == null) {
+            count += 1;
+        }
+        return count;
+    }
+
+    // sectors written directly to device must not be served stale from cache
+    fn refresh(self: *Self, device: *Device, sector: u64, data: []const u8) void {
+        for (0..data.len / sector_size) |i| {
+            if (self.find(device, sector + i)) |entry| {
+                @memcpy(entry.data, data[i * sector_size ..][0..sector_size]);
+                entry.dirty = false;
+            }
+        }
+    }
+
+    // last sector of device may be shorter than sector_size
+    fn device_span(device: *Device, sector: u64, length: usize) usize {
+        const offset = sector * sector_size;
+        if (offset >= device.size) {
+            return 0;
+        }
+        return @intCast(@min(length, device.size - offset));
+    }
+
+    fn device_read(device: *Device, sector: u64, buffer: []u8) bool {
+        const length = device_span(device, sector, buffer.len);
+        if (length == 0) {
+            return false;
+        }
+        _ = device.file.interface.seek(@intCast(sector * sector_size), c.SEEK_SET) catch return false;
+        const result = device.file.interface.read(buffer[0..length]);
+        if (result <= 0) {
+            return false;
+        }
+        @memset(buffer[@intCast(result)..], 0);
+        return true;
+    }
+
+    fn device_write(device: *Device, sector: u64, buffer: []const u8) bool {
+        const length = device_span(device, sector, buffer.len);
+        if (length == 0) {
+            return false;
+        }
+        _ = device.file.interface.seek(@intCast(sector * sector_size), c.SEEK_SET) catch return false;
+        return device.file.interface.write(buffer[0..length]) == @as(isize, @intCast(length));
+    }
+};
+
+// Block device seen through the cache, each clone keeps own position
+pub const BlockCacheFile = interface.DeriveFromBase(kernel.fs.IFile, struct {
+    const Self = @This();
+    _cache: *BlockCache,
+    _device: *BlockCache.Device,
+    _position: u64,
+
+    pub fn create(cache: *BlockCache, dev: kernel.fs.IFile) !BlockCacheFile {
+        return BlockCacheFile.init(.{
+            ._cache = cache,
+            ._device = try cache.attach(dev),
+            ._position = 0,
+        });
+    }
+
+    pub fn __clone(self: *Self, other: *Self) void {
+        self._cache = other._cache;
+        self._device = other._cache.share(other._device);
+        self._position = 0;
+    }
+
+    pub fn read(self: *Self, buf: []u8) isize {
+        const result = self._cache.read(self._device, self._position, buf);
+        if (result > 0) {
+            self._position += @intCast(result);
+        }
+        return result;
+    }
+
+    pub fn write(self: *Self, buf: []const u8) isize {
+        const result = self._cache.write(self._device, self._position, buf);
+        if (result > 0) {
+            self._position += @intCast(result);
+        }
+        return result;
+    }
+
+    pub fn seek(self: *Self, offset: i64, base: i32) anyerror!i64 {
+        const new_position: i64 = switch (base) {
+            c.SEEK_SET => offset,
+            c.SEEK_CUR => @as(i64, @intCast(self._position)) + offset,
+            c.SEEK_END => @as(i64, @intCast(self._device.size)) + offset,
+            else => return kernel.errno.ErrnoSet.InvalidArgument,
+        };
+        if (new_position < 0) {
+            return kernel.errno.ErrnoSet.InvalidArgument;
+        }
+        self._position = @intCast(new_position);
+        return new_position;
+    }
+
+    pub fn sync(self: *Self) i32 {
+        if (self._cache.flush(self._device) != 0) {
+            return -1;
+        }
+        return self._device.file.interface.sync();
+    }
+
+    pub fn tell(self: *Self) i64 {
+        return @intCast(self._position);
+    }
+
+    pub fn name(self: *const Self) []const u8 {
+        return self._device.file.interface.name();
+    }
+
+    pub fn ioctl(self: *Self, cmd: i32, arg: ?*anyopaque) i32 {
+        return self._device.file.interface.ioctl(cmd, arg);
+    }
+
+    pub fn fcntl(self: *Self, cmd: i32, arg: ?*anyopaque) i32 {
+        return self._device.file.interface.fcntl(cmd, arg);
+    }
+
+    pub fn size(self: *const Self) u64 {
+        return self._device.size;
+    }
+
+    pub fn filetype(self: *const Self) kernel.fs.FileType {
+        return self._device.file.interface.filetype();
+    }
+
+    pub fn delete(self: *Self) void {
+        self._cache.detach(self._device);
+    }
+});
+
+var block_cache_instance: ?BlockCache = null;
+
+pub fn block_cache_init(allocator: std.mem.Allocator, storage_allocator: std.mem.Allocator, number_of_sectors: usize) !void {
+    log.info("initialization with {d} sectors", .{number_of_sectors});
+    block_cache_instance = try BlockCache.init(allocator, storage_allocator, number_of_sectors);
+}
+
+pub fn block_cache_deinit() void {
+    log.info("deinitialization...", .{});
+    if (block_cache_instance) |*cache| {
+        cache.deinit();
+        block_cache_instance = null;
+    }
+}
+
+pub fn get_block_cache() ?*BlockCache {
+    if (block_cache_instance) |*cache| {
+        return cache;
+    }
+    return null;
+}
+
+const BlockDeviceState = @import("tests/block_device_stub.zig").BlockDeviceState;
+const BlockDeviceStub = @import("tests/block_device_stub.zig").BlockDeviceStub;
+
+fn create_device(state: *BlockDeviceState) !kernel.fs.IFile {
+    for (state.data, 0..) |*byte, i| {
+        byte.* = @truncate(i / BlockCache.sector_size);
+    }
+    return try BlockDeviceStub.InstanceType.create(state).interface.new(std.testing.allocator);
+}
+
+test "BlockCache.ShouldServeRepeatedReadsFromCache" {
+    var data: [8 * BlockCache.sector_size]u8 = undefined;
+    var state = BlockDeviceState{ .data = &data };
+    var device = try create_device(&state);
+    defer device.interface.delete();
+
+    var cache = try BlockCache.init(std.testing.allocator, std.testing.allocator, 4);
+    defer cache.deinit();
+    var sut = try (try BlockCacheFile.InstanceType.create(&cache, device)).interface.new(std.testing.allocator);
+    defer sut.interface.delete();
+
+    var buffer: [16]u8 = undefined;
+    _ = try sut.interface.seek(1030, c.SEEK_SET);
+    try std.testing.expectEqual(16, sut.interface.read(&buffer));
+    try std.testing.expectEqualSlices(u8, &([_]u8{2} ** 16), &buffer);
+    _ = try sut.interface.seek(1100, c.SEEK_SET);
+    try std.testing.expectEqual(16, sut.interface.read(&buffer));
+    try std.testing.expectEqual(1116, sut.interface.tell());
+
+    try std.testing.expectEqual(1, state.reads);
+    const stats = cache.get_statistics();
+    try std.testing.expectEqual(1, stats.hits);
+    try std.testing.expectEqual(1, stats.misses);
+}
+
+test "BlockCache.ShouldEvictLeastRecentlyUsedSector" {
+    var data: [8 * BlockCache.sector_size]u8 = undefined;
+    var state = BlockDeviceState{ .data = &data };
+    var device = try create_device(&state);
+    defer device.interface.delete();
+
+    var cache = try BlockCache.init(std.testing.allocator, std.testing.allocator, 2);
+    defer cache.deinit();
+    var sut = try (try BlockCacheFile.InstanceType.create(&cache, device)).interface.new(std.testing.allocator);
+    defer sut.interface.delete();
+
+    var buffer: [4]u8 = undefined;
+    for ([_]u64{ 0, 1, 0, 2 }) |sector| {
+        _ = try sut.interface.seek(@intCast(sector * BlockCache.sector_size), c.SEEK_SET);
+        try std.testing.expectEqual(4, sut.interface.read(&buffer));
+        try std.testing.expectEqual(@as(u8, @intCast(sector)), buffer[0]);
+    }
+    try std.testing.expectEqual(3, state.reads);
+
+    // sector 1 was least recently used
+    _ = try sut.interface.seek(0, c.SEEK_SET);
+    _ = sut.interface.read(&buffer);
+    try std.testing.expectEqual(3, state.reads);
+    _ = try sut.interface.seek(BlockCache.sector_size, c.SEEK_SET);
+    _ = sut.interface.read(&buffer);
+    try std.testing.expectEqual(4, state.reads);
+}
+
+test "BlockCache.ShouldWriteBackDirtySectorsOnSync" {
+    var data: [8 * BlockCache.sector_size]u8 = undefined;
+    var state = BlockDeviceState{ .data = &data };
+    var device = try create_device(&state);
+    defer device.interface.delete();
+
+    var cache = try BlockCache.init(std.testing.allocator, std.testing.allocator, 4);
+    defer cache.deinit();
+    var sut = try (try BlockCacheFile.InstanceType.create(&cache, device)).interface.new(std.testing.allocator);
+    defer sut.interface.delete();
+
+    _ = try sut.interface.seek(BlockCache.sector_size + 3, c.SEEK_SET);
+    try std.testing.expectEqual(4, sut.interface.write("abcd"));
+    try std.testing.expectEqual(0, state.writes);
+    try std.testing.expectEqual(1, cache.get_statistics().dirty);
+
+    var buffer: [4]u8 = undefined;
+    _ = try sut.interface.seek(BlockCache.sector_size + 3, c.SEEK_SET);
+    _ = sut.interface.read(&buffer);
+    try std.testing.expectEqualStrings("abcd", &buffer);
+
+    try std.testing.expectEqual(0, sut.interface.sync());
+    try std.testing.expectEqual(1, state.writes);
+    try std.testing.expectEqual(1, state.syncs);
+    try std.testing.expectEqualStrings("abcd", data[BlockCache.sector_size + 3 ..][0..4]);
+    try std.testing.expectEqual(1, data[BlockCache.sector_size + 7]);
+    try std.testing.expectEqual(0, cache.get_statistics().dirty);
+    try std.testing.expectEqual(1, cache.get_statistics().writebacks);
+}
+
+test "BlockCache.ShouldWriteBackDirtySectorOnEviction" {
+    var data: [8 * BlockCache.sector_size]u8 = undefined;
+    var state = BlockDeviceState{ .data = &data };
+    var device = try create_device(&state);
+    defer device.interface.delete();
+
+    var cache = try BlockCache.init(std.testing.allocator, std.testing.allocator, 1);
+    defer cache.deinit();
+    var sut = try (try BlockCacheFile.InstanceType.create(&cache, device)).interface.new(std.testing.allocator);
+    defer sut.interface.delete();
+
+    // whole sector write doesn't fetch sector from device
+    const sector = [_]u8{0xaa} ** BlockCache.sector_size;
+    try std.testing.expectEqual(BlockCache.sector_size, sut.interface.write(&sector));
+    try std.testing.expectEqual(0, state.reads);
+    try std.testing.expectEqual(0, state.writes);
+
+    var buffer: [1]u8 = undefined;
+    _ = sut.interface.read(&buffer);
+    try std.testing.expectEqual(1, state.writes);
+    try std.testing.expectEqualSlices(u8, &sector, data[0..BlockCache.sector_size]);
+}
+
+test "BlockCache.ShouldBypassCacheForBulkTransfers" {
+    var data: [8 * BlockCache.sector_size]u8 = undefined;
+    var state = BlockDeviceState{ .data = &data };
+    var device = try create_device(&state);
+    defer device.interface.delete();
+
+    var cache = try BlockCache.init(std.testing.allocator, std.testing.allocator, 4);
+    defer cache.deinit();
+    var sut = try (try BlockCacheFile.InstanceType.create(&cache, device)).interface.new(std.testing.allocator);
+    defer sut.interface.delete();
+
+    // dirty sector in the middle of bulk read must be taken from cache
+    _ = try sut.interface.seek(2 * BlockCache.sector_size, c.SEEK_SET);
+    try std.testing.expectEqual(1, sut.interface.write("x"));
+    try std.testing.expectEqual(1, state.reads);
+
+    var buffer: [6 * BlockCache.sector_size]u8 = undefined;
+    _ = try sut.interface.seek(0, c.SEEK_SET);
+    try std.testing.expectEqual(buffer.len, sut.interface.read(&buffer));
+    try std.testing.expectEqual(3, state.reads);
+    try std.testing.expectEqual(1, buffer[BlockCache.sector_size]);
+    try std.testing.expectEqual('x', buffer[2 * BlockCache.sector_size]);
+    try std.testing.expectEqual(2, buffer[2 * BlockCache.sector_size + 1]);
+    try std.testing.expectEqual(5, buffer[5 * BlockCache.sector_size]);
+    try std.testing.expectEqual(5, cache.get_statistics().bypassed);
+
+    // bulk write replaces cached copy
+    const sectors = [_]u8{0x55} ** (4 * BlockCache.sector_size);
+    _ = try sut.interface.seek(0, c.SEEK_SET);
+    try std.testing.expectEqual(sectors.len, sut.interface.write(&sectors));
+    try std.testing.expectEqual(0, cache.get_statistics().dirty);
+    _ = try sut.interface.seek(2 * BlockCache.sector_size, c.SEEK_SET);
+    _ = sut.interface.read(buffer[0..1]);
+    try std.testing.expectEqual(0x55, buffer[0]);
+    try std.testing.expectEqual(3, state.reads);
+}
+
+test "BlockCache.ShouldWriteBackWhenLastFileIsDeleted" {
+    var data: [8 * BlockCache.sector_size]u8 = undefined;
+    var state = BlockDeviceState{ .data = &data };
+    var device = try create_device(&state);
+    defer device.interface.delete();
+
+    var cache = try BlockCache.init(std.testing.allocator, std.testing.allocator, 4);
+    defer cache.deinit();
+    var sut = try (try BlockCacheFile.InstanceType.create(&cache, device)).interface.new(std.testing.allocator);
+    var second = try sut.clone();
+
+    try std.testing.expectEqual(1, second.interface.write("z"));
+    sut.interface.delete();
+    try std.testing.expectEqual(0, state.writes);
+    second.interface.delete();
+    try std.testing.expectEqual(1, state.writes);
+    try std.testing.expectEqual('z', data[0]);
+}
@@ -29,6 +29,7 @@ pub const IDirectoryIterator = @import("idirectory.zig").IDirectoryIterator;
 pub const IFileSystem = @import("ifilesystem.zig").IFileSystem;
 
 pub const FileMemoryMapAttributes = @import("ifile.zig").FileMemoryMapAttributes;
+pub const FileMemoryRegion = @import("ifile.zig").FileMemoryRegion;
 pub const FileName = @import("ifile.zig").FileName;
 pub const FileType = @import("ifile.zig").FileType;
 pub const IFile = @import("ifile.zig").IFile;
@@ -37,6 +38,20 @@ pub const ReadOnlyFile = @import("ifile.zig").ReadOnlyFile;
 pub const MBR = @import("mbr.zig").MBR;
 pub const MBRPartitionEntry = @import("mbr.zig").MBRPartitionEntry;
 pub const Node = @import("node.zig").Node;
+pub const PathBuffer = @import("path.zig").PathBuffer;
+pub const Pipe = @import("pipe.zig").Pipe;
+pub const PipeFile = @import("pipe.zig").PipeFile;
+pub const poll = @import("poll.zig");
+pub const create_pipe = @import("pipe.zig").create_pipe;
+pub const create_fifo_node = @import("pipe.zig").create_fifo_node;
+pub const max_path_length = @import("path.zig").max_path_length;
+pub const resolve_path = @import("path.zig").resolve;
+pub const ScratchPath = @import("path.zig").ScratchPath;
 pub const IDirectory = @import("idirectory.zig").IDirectory;
 pub const DirectoryEntry = @import("idirectory.zig").DirectoryEntry;
 pub const BufferedFile = @import("buffered_file.zig").BufferedFile;
+pub const BlockCache = @import("block_cache.zig").BlockCache;
+pub const BlockCacheFile = @import("block_cache.zig").BlockCacheFile;
+pub const block_cache_init = @import("block_cache.zig").block_cache_init;
+pub const block_cache_deinit = @import("block_cache.zig").block_cache_deinit;
+pub const get_block_cache = @import("block_cache.zig").get_block_cache;
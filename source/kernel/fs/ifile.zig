@@ -38,6 +38,13 @@ pub const FileType = enum(u8) {
 
 pub const IoctlCommonCommands = enum(u32) {
     GetMemoryMappingStatus,
+    // argument is FileMemoryRegion, fails when file content is not memory mapped
+    MapFileRegion,
+    // argument is pointer to open flags, connects opened named FIFO and may block
+    // until the other end is opened, negative errno is returned on failure
+    OpenFifo,
+    // argument is PollRequest, sets revents and adds waiters to queues woken on readiness change
+    Poll,
 };
 
 pub const FileMemoryMapAttributes = extern struct {
@@ -46,6 +53,15 @@ pub const FileMemoryMapAttributes = extern struct {
     mapped_address_w: ?*anyopaque,
 };
 
+// Region of file content available for in-place reads.
+// offset and length are provided by caller, length equal to 0 requests data till end of file.
+// On success address is set and length is trimmed to available data.
+pub const FileMemoryRegion = extern struct {
+    offset: usize,
+    length: usize,
+    address: ?*const anyopaque,
+};
+
 pub const FileName = struct {
     _name: []const u8,
     _allocator: ?std.mem.Allocator,
@@ -30,6 +30,74 @@ const interface = @import("interface");
 
 const log = std.log.scoped(.@"kernel/fs/mount_points");
 
+// Single path component of mounted paths, lookup walks path components down the trie,
+// so mount point is found in one pass and only on component boundaries.
+const PathTrie = struct {
+    const List = std.DoublyLinkedList;
+    component: []const u8 = "",
+    mount: ?*MountPoint = null,
+    children: List = .{},
+    list_node: List.Node = .{},
+
+    fn find_child(self: *const PathTrie, component: []const u8) ?*PathTrie {
+        var next = self.children.first;
+        while (next) |node| {
+            const child: *PathTrie = @fieldParentPtr("list_node", node);
+            next = node.next;
+            if (std.mem.eql(u8, child.component, component)) {
+                return child;
+            }
+        }
+        return null;
+    }
+
+    // creates missing nodes for all components of path
+    fn insert(self: *PathTrie, allocator: std.mem.Allocator, path: []const u8) !*PathTrie {
+        var trie = self;
+        var it = std.mem.tokenizeScalar(u8, path, '/');
+        while (it.next()) |component| {
+            if (trie.find_child(component)) |child| {
+                trie = child;
+                continue;
+            }
+            const child = try allocator.create(PathTrie);
+            errdefer allocator.destroy(child);
+            child.* = .{
+                .component = try allocator.dupe(u8, component),
+            };
+            trie.children.append(&child.list_node);
+            trie = child;
+        }
+        return trie;
+    }
+
+    // removes nodes that lead to no mount point
+    fn prune(self: *PathTrie, allocator: std.mem.Allocator) void {
+        var next = self.children.first;
+        while (next) |node| {
+            const child: *PathTrie = @fieldParentPtr("list_node", node);
+            next = node.next;
+            child.prune(allocator);
+            if (child.mount == null and child.children.first == null) {
+                self.children.remove(&child.list_node);
+                allocator.free(child.component);
+                allocator.destroy(child);
+            }
+        }
+    }
+
+    fn deinit(self: *PathTrie, allocator: std.mem.Allocator) void {
+        var it = self.children.pop();
+        while (it) |node| {
+            const child: *PathTrie = @fieldParentPtr("list_node", node);
+            child.deinit(allocator);
+            allocator.free(child.component);
+            allocator.destroy(child);
+            it = self.children.pop();
+        }
+    }
+};
+
 pub const MountPoint = struct {
     pub const List = std.DoublyLinkedList;
     path_buffer: [config.fs.max_mount_point_size]u8,
@@ -37,8 +105,9 @@ pub const MountPoint = struct {
     filesystem: IFileSystem,
     children: List,
     list_node: List.Node,
+    trie: ?*PathTrie = null,
 
-    pub fn appendChild(self: *MountPoint, allocator: std.mem.Allocator, path: []const u8, filesystem: IFileSystem) !void {
+    pub fn appendChild(self: *MountPoint, allocator: std.mem.Allocator, path: []const u8, filesystem: IFileSystem) !*MountPoint {
         const point = try allocator.create(MountPoint);
         point.* = .{
             .path_buffer = undefined,
@@ -50,6 +119,7 @@ pub const MountPoint = struct {
         @memcpy(point.path_buffer[0..path.len], path);
         point.path = point.path_buffer[0..path.len];
         self.children.append(&point.list_node);
+        return point;
     }
 
     pub fn removeChild(self: *MountPoint, allocator: std.mem.Allocator, child_path: []const u8) void {
@@ -75,6 +145,10 @@ pub const MountPoint = struct {
             allocator.destroy(child);
         }
 
+        if (self.trie) |trie| {
+            trie.mount = null;
+            self.trie = null;
+        }
         self.filesystem.interface.delete();
     }
 };
@@ -91,6 +165,8 @@ pub const MountPointError = error{
 pub const MountPoints = struct {
     allocator: std.mem.Allocator,
     root: ?MountPoint = null,
+    // components of all mounted paths, root mount point is implied by trie root
+    trie: PathTrie = .{},
 
     pub fn init(allocator: std.mem.Allocator) MountPoints {
         return .{
@@ -102,6 +178,7 @@ pub const MountPoints = struct {
         if (self.root) |*root| {
             root.deinit(self.allocator);
         }
+        self.trie.deinit(self.allocator);
     }
 
     pub fn find_longest_matching_point(self: anytype, T: type, path: []const u8) ?struct {
@@ -112,45 +189,22 @@ pub const MountPoints = struct {
         if (self.root == null) {
             return null;
         }
-        var maybe_node: ?T = &self.root.?;
-        var last_matched_point: T = &self.root.?;
+        var point: T = &self.root.?;
         var parent: T = &self.root.?;
-        // skip root searching, already checked
         var left: []const u8 = std.mem.trim(u8, path, "/");
-        while (maybe_node) |mountpoint| {
-            // already finished
-            if (left.len == 0) {
-                break;
+        var trie: *const PathTrie = &self.trie;
+        var it = std.mem.tokenizeScalar(u8, left, '/');
+        while (it.next()) |component| {
+            trie = trie.find_child(component) orelse break;
+            if (trie.mount) |mount| {
+                parent = point;
+                point = mount;
+                left = it.rest();
             }
-
-            // traverse children
-            var next = mountpoint.children.first;
-            var bestchild: ?*MountPoint = null;
-
-            while (next) |node| {
-                const child: *MountPoint = @fieldParentPtr("list_node", node);
-                next = node.next;
-                if (std.mem.startsWith(u8, left, child.path)) {
-                    if (bestchild == null) {
-                        bestchild = child;
-                        continue;
-                    }
-                    if (child.path.len > bestchild.?.path.len) {
-                        bestchild = child;
-                    }
-                }
-            }
-
-            if (bestchild) |child| {
-                parent = mountpoint;
-                left = std.mem.trimLeft(u8, left[child.path.len..], "/");
-                last_matched_point = child;
-            }
-            maybe_node = bestchild;
         }
         return .{
             .left = left,
-            .point = last_matched_point,
+            .point = point,
             .parent = parent,
         };
     }
@@ -196,7 +250,14 @@ pub const MountPoints = struct {
         // verify if path exists in FS and mount if so
         var n = try longest_matching_point.point.filesystem.interface.get(longest_matching_point.left);
         n.delete();
-        try longest_matching_point.point.appendChild(self.allocator, longest_matching_point.left, filesystem);
+        const trie = self.trie.insert(self.allocator, path) catch |err| {
+            self.trie.prune(self.allocator);
+            return err;
+        };
+        errdefer self.trie.prune(self.allocator);
+        const point = try longest_matching_point.point.appendChild(self.allocator, longest_matching_point.left, filesystem);
+        point.trie = trie;
+        trie.mount = point;
 
         var fs = filesystem;
         if (fs.interface.mount() < 0) {
@@ -222,6 +283,7 @@ pub const MountPoints = struct {
         if (std.mem.eql(u8, path, "/")) {
             self.root = null;
         }
+        self.trie.prune(self.allocator);
     }
 };
 
@@ -546,3 +608,45 @@ test "MountPoints.RemoveChilds" {
     child = maybe_child.?;
     try std.testing.expectEqualStrings("", child.left);
 }
+
+test "MountPoints.MatchOnlyWholePathComponents" {
+    const FileMock = @import("tests/file_mock.zig").FileMock;
+    var sut = MountPoints.init(std.testing.allocator);
+    defer sut.deinit();
+
+    var file_mock = try FileMock.create(std.testing.allocator);
+    var file = file_mock.get_interface();
+    defer file.interface.delete();
+
+    var file_to_return: kernel.fs.Node = kernel.fs.Node.create_file(file);
+
+    const CallContext = struct {
+        file: *kernel.fs.Node,
+    };
+    const context = CallContext{
+        .file = &file_to_return,
+    };
+
+    try sut.mount_filesystem("/", try create_filesystem_mock(&context));
+    try sut.mount_filesystem("/tmp", try create_filesystem_mock(&context));
+    try sut.mount_filesystem("/tmp/a/b", try create_filesystem_mock(&context));
+
+    var child = sut.find_longest_matching_point(*const MountPoint, "/tmpfoo/file").?;
+    try std.testing.expectEqualStrings("tmpfoo/file", child.left);
+    try std.testing.expectEqualStrings("/", child.point.path);
+
+    child = sut.find_longest_matching_point(*const MountPoint, "/tmp//a/bc").?;
+    try std.testing.expectEqualStrings("a/bc", child.left);
+    try std.testing.expectEqualStrings("tmp", child.point.path);
+
+    child = sut.find_longest_matching_point(*const MountPoint, "/tmp/a/b/").?;
+    try std.testing.expectEqualStrings("", child.left);
+    try std.testing.expectEqualStrings("a/b", child.point.path);
+    try std.testing.expectEqualStrings("tmp", child.parent.?.path);
+
+    try sut.umount("/tmp/a/b");
+    child = sut.find_longest_matching_point(*const MountPoint, "/tmp/a/b/c").?;
+    try std.testing.expectEqualStrings("a/b/c", child.left);
+    try std.testing.expectEqualStrings("tmp", child.point.path);
+    try std.testing.expectEqual(1, sut.trie.children.len());
+}
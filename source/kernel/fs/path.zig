@@ -0,0 +1,146 @@
+// Copyright (c) 2025 Mateusz Stadnik
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program. If not, see <https://www.gnu.org/licenses/>.
+
+const std = @import("std");
+const c = @import("libc_imports").c;
+
+const kernel = @import("../kernel.zig");
+
+// same limit as in userspace, so every path accepted by libc can be resolved,
+// 1024 is PATH_MAX of newlib when libc headers do not provide it
+pub const max_path_length = if (@hasDecl(c, "PATH_MAX")) c.PATH_MAX else 1024;
+pub const PathBuffer = [max_path_length]u8;
+
+const scratch_buffers_count = 4;
+var scratch_buffers: [scratch_buffers_count]PathBuffer = undefined;
+var scratch_used = std.StaticBitSet(scratch_buffers_count).initEmpty();
+const ScratchLock = kernel.sync.IrqLock;
+
+// Path buffer owned by caller until release. Resolution may block on I/O, so buffers
+// are taken from small pool shared by all processes, when all of them are in use
+// buffer is allocated.
+pub const ScratchPath = struct {
+    buffer: *PathBuffer,
+    _allocator: ?std.mem.Allocator = null,
+
+    pub fn acquire(allocator: std.mem.Allocator) !ScratchPath {
+        {
+            const state = ScratchLock.lock();
+            defer ScratchLock.unlock(state);
+            var free = scratch_used.iterator(.{ .kind = .unset });
+            if (free.next()) |index| {
+                scratch_used.set(index);
+                return .{ .buffer = &scratch_buffers[index] };
+            }
+        }
+        return .{ .buffer = try allocator.create(PathBuffer), ._allocator = allocator };
+    }
+
+    pub fn release(self: ScratchPath) void {
+        if (self._allocator) |allocator| {
+            allocator.destroy(self.buffer);
+            return;
+        }
+        const index = (@intFromPtr(self.buffer) - @intFromPtr(&scratch_buffers[0])) / @sizeOf(PathBuffer);
+        const state = ScratchLock.lock();
+        defer ScratchLock.unlock(state);
+        scratch_used.unset(index);
+    }
+};
+
+// Joins parts into buffer and normalizes result in place, without heap allocations.
+// Result is always absolute, absolute part discards previous ones, empty components
+// and '.' are skipped and '..' removes the previous component, but never goes above root.
+pub fn resolve(buffer: []u8, parts: []const []const u8) ![]const u8 {
+    var length: usize = 0;
+    for (parts) |part| {
+        if (part.len > 0 and part[0] == '/') {
+            length = 0;
+        }
+        var it = std.mem.tokenizeScalar(u8, part, '/');
+        while (it.next()) |component| {
+            if (std.mem.eql(u8, component, ".")) {
+                continue;
+            }
+            if (std.mem.eql(u8, component, "..")) {
+                length = std.mem.lastIndexOfScalar(u8, buffer[0..length], '/') orelse 0;
+                continue;
+            }
+            if (length + component.len + 1 > buffer.len) {
+                return kernel.errno.ErrnoSet.NameTooLong;
+            }
+            buffer[length] = '/';
+            @memcpy(buffer[length + 1 ..][0..component.len], component);
+            length += component.len + 1;
+        }
+    }
+    if (length == 0) {
+        if (buffer.len == 0) {
+            return kernel.errno.ErrnoSet.NameTooLong;
+        }
+        buffer[0] = '/';
+        length = 1;
+    }
+    return buffer[0..length];
+}
+
+test "Path.ShouldJoinRelativePathWithDirectory" {
+    var buffer: PathBuffer = undefined;
+    try std.testing.expectEqualStrings("/home/user/file.txt", try resolve(&buffer, &.{ "/home/user", "file.txt" }));
+    try std.testing.expectEqualStrings("/home/user/file.txt", try resolve(&buffer, &.{ "/home/user/", "./file.txt" }));
+    try std.testing.expectEqualStrings("/dev/null", try resolve(&buffer, &.{ "/home/user", "/dev/null" }));
+}
+
+test "Path.ShouldResolveDotComponents" {
+    var buffer: PathBuffer = undefined;
+    try std.testing.expectEqualStrings("/usr/lib", try resolve(&buffer, &.{ "/usr/bin/", "../lib/." }));
+    try std.testing.expectEqualStrings("/a/c", try resolve(&buffer, &.{"//a/./b/..//c/"}));
+    try std.testing.expectEqualStrings("/", try resolve(&buffer, &.{ "/", "../../.." }));
+    try std.testing.expectEqualStrings("/etc", try resolve(&buffer, &.{ "/bin", "../../etc" }));
+    try std.testing.expectEqualStrings("/", try resolve(&buffer, &.{""}));
+}
+
+test "Path.ShouldRejectPathLongerThanBuffer" {
+    var buffer: [8]u8 = undefined;
+    try std.testing.expectEqualStrings("/abc/def", try resolve(&buffer, &.{ "/abc", "def" }));
+    try std.testing.expectError(error.NameTooLong, resolve(&buffer, &.{ "/abc", "defg" }));
+    // components removed by '..' do not count into the limit
+    try std.testing.expectEqualStrings("/abc/xyz", try resolve(&buffer, &.{ "/abc/def", "../xyz" }));
+}
+
+test "Path.ScratchPath.ShouldReuseSharedBuffers" {
+    const first = try ScratchPath.acquire(std.testing.allocator);
+    try std.testing.expect(first._allocator == null);
+    first.release();
+
+    const second = try ScratchPath.acquire(std.testing.allocator);
+    defer second.release();
+    try std.testing.expectEqual(first.buffer, second.buffer);
+}
+
+test "Path.ScratchPath.ShouldAllocateWhenAllBuffersAreInUse" {
+    var taken: [scratch_buffers_count]ScratchPath = undefined;
+    for (&taken) |*scratch| {
+        scratch.* = try ScratchPath.acquire(std.testing.allocator);
+    }
+    const allocated = try ScratchPath.acquire(std.testing.allocator);
+    try std.testing.expect(allocated._allocator != null);
+    // released to allocator, testing allocator reports leak otherwise
+    allocated.release();
+    for (taken) |scratch| {
+        scratch.release();
+    }
+    try std.testing.expectEqual(0, scratch_used.count());
+}
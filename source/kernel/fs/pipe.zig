@@ -0,0 +1,540 @@
+//
+// pipe.zig
+//
+// Copyright (C) 2025 Mateusz Stadnik <matgla@live.com>
+//
+// This program is free software: you can redistribute it and/or
+// modify it under the terms of the GNU General Public License
+// as published by the Free Software Foundation, either version
+// 3 of the License, or (at your option) any later version.
+//
+// This program is distributed in the hope that it will be
+// useful, but WITHOUT ANY WARRANTY; without even the implied
+// warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR
+// PURPOSE. See the GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General
+// Public License along with this program. If not, see
+// <https://www.gnu.org/licenses/>.
+//
+
+const std = @import("std");
+
+const c = @import("libc_imports").c;
+const interface = @import("interface");
+const arch = @import("arch");
+const config = @import("config");
+
+const kernel = @import("../kernel.zig");
+
+const IFile = @import("ifile.zig").IFile;
+const FileType = @import("ifile.zig").FileType;
+const IoctlCommonCommands = @import("ifile.zig").IoctlCommonCommands;
+const Node = @import("node.zig").Node;
+const poll = @import("poll.zig");
+
+const Completion = @import("../interrupts/kernel_completion.zig").Completion;
+const WaitQueue = @import("../interrupts/kernel_wait_queue.zig").WaitQueue;
+const process_manager = @import("../process_manager.zig");
+
+// Data shared by both ends of a pipe or by all openers of a named FIFO.
+// Bytes are kept in a fixed size ring buffer, readers sleep while it is empty
+// and writers while it is full. Pipe is released with the last PipeFile.
+pub const Pipe = struct {
+    const Self = @This();
+    pub const capacity: usize = config.fs.pipe_buffer_size;
+
+    _allocator: std.mem.Allocator,
+    _buffer: [capacity]u8 = undefined,
+    _head: usize = 0,
+    _length: usize = 0,
+    _readers: usize = 0,
+    _writers: usize = 0,
+    _references: usize = 0,
+    // woken when data or end of stream may be available
+    readable: WaitQueue = .{},
+    // woken when space or broken pipe may be available
+    writable: WaitQueue = .{},
+
+    pub fn create(allocator: std.mem.Allocator) !*Self {
+        const pipe = try allocator.create(Self);
+        pipe.* = .{
+            ._allocator = allocator,
+        };
+        return pipe;
+    }
+
+    fn acquire(self: *Self) void {
+        const state = arch.sync.save_and_disable_interrupts();
+        defer arch.sync.restore_interrupts(state);
+        self._references += 1;
+    }
+
+    fn release(self: *Self) void {
+        const state = arch.sync.save_and_disable_interrupts();
+        self._references -= 1;
+        const last = self._references == 0;
+        arch.sync.restore_interrupts(state);
+        if (last) {
+            self._allocator.destroy(self);
+        }
+    }
+
+    fn connect(self: *Self, reader: bool, writer: bool) void {
+        const state = arch.sync.save_and_disable_interrupts();
+        if (reader) self._readers += 1;
+        if (writer) self._writers += 1;
+        arch.sync.restore_interrupts(state);
+        // FIFO openers wait for the other end
+        self.readable.wake_all();
+        self.writable.wake_all();
+    }
+
+    fn disconnect(self: *Self, reader: bool, writer: bool) void {
+        const state = arch.sync.save_and_disable_interrupts();
+        if (reader) self._readers -= 1;
+        if (writer) self._writers -= 1;
+        arch.sync.restore_interrupts(state);
+        // readers see end of stream, writers see broken pipe
+        self.readable.wake_all();
+        self.writable.wake_all();
+    }
+
+    pub fn bytes_available(self: *const Self) usize {
+        const length: *const volatile usize = &self._length;
+        return length.*;
+    }
+
+    pub fn has_readers(self: *const Self) bool {
+        const readers: *const volatile usize = &self._readers;
+        return readers.* != 0;
+    }
+
+    pub fn has_writers(self: *const Self) bool {
+        const writers: *const volatile usize = &self._writers;
+        return writers.* != 0;
+    }
+
+    // returns number of bytes read, 0 at end of stream or negative errno
+    pub fn read(self: *Self, buffer: []u8, nonblock: bool) isize {
+        if (buffer.len == 0) {
+            return 0;
+        }
+        while (true) {
+            var done = Completion{};
+            var waiter = WaitQueue.Waiter{ .completion = &done };
+            const state = arch.sync.save_and_disable_interrupts();
+            if (self._length != 0) {
+                const length = @min(buffer.len, self._length);
+                const first = @min(length, capacity - self._head);
+                @memcpy(buffer[0..first], self._buffer[self._head..][0..first]);
+                @memcpy(buffer[first..length], self._buffer[0 .. length - first]);
+                self._head = (self._head + length) % capacity;
+                self._length -= length;
+                arch.sync.restore_interrupts(state);
+                self.writable.wake_all();
+                return @intCast(length);
+            }
+            if (self._writers == 0) {
+                arch.sync.restore_interrupts(state);
+                return 0;
+            }
+            if (nonblock) {
+                arch.sync.restore_interrupts(state);
+                return -c.EAGAIN;
+            }
+            self.readable.add(&waiter);
+            arch.sync.restore_interrupts(state);
+            done.wait(process_manager.get_running_process());
+            self.readable.remove(&waiter);
+        }
+    }
+
+    // Blocking writes wait until all data is written, writes up to capacity are never
+    // interleaved with other writers. Returns number of written bytes or negative errno.
+    pub fn write(self: *Self, data: []const u8, nonblock: bool) isize {
+        var written: usize = 0;
+        while (written < data.len) {
+            var done = Completion{};
+            var waiter = WaitQueue.Waiter{ .completion = &done };
+            const remaining = data.len - written;
+            const required = if (remaining <= capacity) remaining else 1;
+            const state = arch.sync.save_and_disable_interrupts();
+            if (self._readers == 0) {
+                arch.sync.restore_interrupts(state);
+                return if (written != 0) @intCast(written) else -c.EPIPE;
+            }
+            const free = capacity - self._length;
+            if (free >= required) {
+                const length = @min(remaining, free);
+                const tail = (self._head + self._length) % capacity;
+                const first = @min(length, capacity - tail);
+                @memcpy(self._buffer[tail..][0..first], data[written..][0..first]);
+                @memcpy(self._buffer[0 .. length - first], data[written + first ..][0 .. length - first]);
+                self._length += length;
+                written += length;
+                arch.sync.restore_interrupts(state);
+                self.readable.wake_all();
+                continue;
+            }
+            if (nonblock) {
+                arch.sync.restore_interrupts(state);
+                return if (written != 0) @intCast(written) else -c.EAGAIN;
+            }
+            self.writable.add(&waiter);
+            arch.sync.restore_interrupts(state);
+            done.wait(process_manager.get_running_process());
+            self.writable.remove(&waiter);
+        }
+        return @intCast(written);
+    }
+
+    // FIFO opened only for reading or only for writing waits until the other end exists
+    fn wait_for_peer(self: *Self, reader: bool, writer: bool, nonblock: bool) isize {
+        if (reader == writer) {
+            return 0;
+        }
+        while (true) {
+            var done = Completion{};
+            var waiter = WaitQueue.Waiter{ .completion = &done };
+            const queue = if (reader) &self.readable else &self.writable;
+            const state = arch.sync.save_and_disable_interrupts();
+            const connected = if (reader) self._writers != 0 else self._readers != 0;
+            if (connected) {
+                arch.sync.restore_interrupts(state);
+                return 0;
+            }
+            if (nonblock) {
+                arch.sync.restore_interrupts(state);
+                // reader opened without writer gets end of stream, writer without reader fails
+                return if (reader) 0 else -c.ENXIO;
+            }
+            queue.add(&waiter);
+            arch.sync.restore_interrupts(state);
+            done.wait(process_manager.get_running_process());
+            queue.remove(&waiter);
+        }
+    }
+};
+
+// Single end of a pipe. Ends created by pipe() are connected on creation, while
+// a FIFO node stored in filesystem is not connected, each open gets a clone
+// connected according to the open flags.
+pub const PipeFile = interface.DeriveFromBase(IFile, struct {
+    const Self = @This();
+    _pipe: *Pipe,
+    _reader: bool,
+    _writer: bool,
+    _nonblock: bool,
+    _name: []const u8,
+
+    // pipe reference and connection are taken by create_node
+    pub fn create(pipe: *Pipe, reader: bool, writer: bool, nonblock: bool, filename: []const u8) PipeFile {
+        return PipeFile.init(.{
+            ._pipe = pipe,
+            ._reader = reader,
+            ._writer = writer,
+            ._nonblock = nonblock,
+            ._name = filename,
+        });
+    }
+
+    pub fn create_node(allocator: std.mem.Allocator, pipe: *Pipe, reader: bool, writer: bool, nonblock: bool, filename: []const u8) anyerror!Node {
+        const file = try create(pipe, reader, writer, nonblock, filename).interface.new(allocator);
+        pipe.acquire();
+        pipe.connect(reader, writer);
+        return Node.create_file(file);
+    }
+
+    pub fn __clone(self: *Self, other: *const Self) void {
+        other._pipe.acquire();
+        self._pipe = other._pipe;
+        self._reader = false;
+        self._writer = false;
+        self._nonblock = false;
+        self._name = other._name;
+    }
+
+    // connects clone of FIFO node, flags are taken from open
+    fn open(self: *Self, flags: c_int) i32 {
+        if (self._reader or self._writer) {
+            return -c.EINVAL;
+        }
+        const mode = flags & c.O_ACCMODE;
+        self._reader = mode == c.O_RDONLY or mode == c.O_RDWR;
+        self._writer = mode == c.O_WRONLY or mode == c.O_RDWR;
+        self._nonblock = (flags & c.O_NONBLOCK) != 0;
+        if (self._writer and !self._reader and self._nonblock and !self._pipe.has_readers()) {
+            self._writer = false;
+            return -c.ENXIO;
+        }
+        self._pipe.connect(self._reader, self._writer);
+        return @intCast(self._pipe.wait_for_peer(self._reader, self._writer, self._nonblock));
+    }
+
+    // reader is woken by data or last writer gone, writer by space or last reader gone
+    fn poll_readiness(self: *Self, request: *poll.PollRequest) i32 {
+        if (self._reader) {
+            request.watch(&self._pipe.readable);
+        }
+        if (self._writer) {
+            request.watch(&self._pipe.writable);
+        }
+        const length = self._pipe.bytes_available();
+        var ready: i16 = 0;
+        if (self._reader) {
+            if (length != 0) {
+                ready |= poll.POLLIN;
+            }
+            if (!self._pipe.has_writers()) {
+                ready |= poll.POLLHUP;
+            }
+        }
+        if (self._writer) {
+            if (!self._pipe.has_readers()) {
+                ready |= poll.POLLERR;
+            } else if (length < Pipe.capacity) {
+                ready |= poll.POLLOUT;
+            }
+        }
+        request.report(ready);
+        return 0;
+    }
+
+    pub fn read(self: *Self, buffer: []u8) isize {
+        if (!self._reader) {
+            return -c.EBADF;
+        }
+        return self._pipe.read(buffer, self._nonblock);
+    }
+
+    pub fn write(self: *Self, data: []const u8) isize {
+        if (!self._writer) {
+            return -c.EBADF;
+        }
+        return self._pipe.write(data, self._nonblock);
+    }
+
+    pub fn seek(self: *Self, _: i64, _: i32) anyerror!i64 {
+        _ = self;
+        return kernel.errno.ErrnoSet.IllegalSeek;
+    }
+
+    pub fn sync(self: *Self) i32 {
+        _ = self;
+        return 0;
+    }
+
+    pub fn tell(self: *Self) i64 {
+        _ = self;
+        return 0;
+    }
+
+    pub fn name(self: *const Self) []const u8 {
+        return self._name;
+    }
+
+    pub fn ioctl(self: *Self, cmd: i32, arg: ?*anyopaque) i32 {
+        switch (cmd) {
+            @intFromEnum(IoctlCommonCommands.OpenFifo) => {
+                const flags: *const c_int = @ptrCast(@alignCast(arg orelse return -c.EINVAL));
+                return self.open(flags.*);
+            },
+            @intFromEnum(IoctlCommonCommands.Poll) => {
+                return self.poll_readiness(@ptrCast(@alignCast(arg orelse return -c.EINVAL)));
+            },
+            c.FIONREAD => {
+                const readable: *c_int = @ptrCast(@alignCast(arg orelse return -1));
+                readable.* = @intCast(self._pipe.bytes_available());
+                return 0;
+            },
+            else => return -1,
+        }
+    }
+
+    pub fn fcntl(self: *Self, op: i32, maybe_arg: ?*anyopaque) i32 {
+        switch (op) {
+            c.F_GETFL => {
+                var flags: i32 = if (self._reader and self._writer) c.O_RDWR else if (self._writer) c.O_WRONLY else c.O_RDONLY;
+                if (self._nonblock) {
+                    flags |= c.O_NONBLOCK;
+                }
+                return flags;
+            },
+            c.F_SETFL => {
+                const flags: c_int = if (maybe_arg) |a| @truncate(@as(c_int, @intCast(@intFromPtr(a)))) else 0;
+                self._nonblock = (flags & c.O_NONBLOCK) != 0;
+                return 0;
+            },
+            else => return -1,
+        }
+    }
+
+    pub fn size(self: *const Self) u64 {
+        return self._pipe.bytes_available();
+    }
+
+    pub fn filetype(self: *const Self) FileType {
+        _ = self;
+        return FileType.Fifo;
+    }
+
+    pub fn delete(self: *Self) void {
+        self._pipe.disconnect(self._reader, self._writer);
+        self._pipe.release();
+    }
+});
+
+pub const PipeEnds = struct {
+    reader: Node,
+    writer: Node,
+};
+
+pub fn create_pipe(allocator: std.mem.Allocator, nonblock: bool) !PipeEnds {
+    const pipe = try Pipe.create(allocator);
+    // each end holds own reference, so pipe is released with the last one
+    pipe.acquire();
+    defer pipe.release();
+    var reader = try PipeFile.InstanceType.create_node(allocator, pipe, true, false, nonblock, "pipe");
+    errdefer reader.delete();
+    const writer = try PipeFile.InstanceType.create_node(allocator, pipe, false, true, nonblock, "pipe");
+    return .{
+        .reader = reader,
+        .writer = writer,
+    };
+}
+
+// named FIFO as stored in filesystem, every open connects own clone of it
+pub fn create_fifo_node(allocator: std.mem.Allocator, filename: []const u8) !Node {
+    const pipe = try Pipe.create(allocator);
+    pipe.acquire();
+    defer pipe.release();
+    return try PipeFile.InstanceType.create_node(allocator, pipe, false, false, false, filename);
+}
+
+test "Pipe.ShouldPassDataFromWriterToReader" {
+    var ends = try create_pipe(std.testing.allocator, false);
+    defer ends.reader.delete();
+    var writer = ends.writer.as_file().?;
+    var reader = ends.reader.as_file().?;
+
+    try std.testing.expectEqual(FileType.Fifo, reader.interface.filetype());
+    try std.testing.expectEqual(5, writer.interface.write("hello"));
+    try std.testing.expectEqual(5, reader.interface.size());
+    var buffer: [8]u8 = undefined;
+    try std.testing.expectEqual(3, reader.interface.read(buffer[0..3]));
+    try std.testing.expectEqualStrings("hel", buffer[0..3]);
+    try std.testing.expectEqual(-c.EBADF, reader.interface.write("x"));
+    try std.testing.expectEqual(-c.EBADF, writer.interface.read(&buffer));
+
+    ends.writer.delete();
+    // remaining data is still delivered, then end of stream is reported
+    try std.testing.expectEqual(2, reader.interface.read(&buffer));
+    try std.testing.expectEqualStrings("lo", buffer[0..2]);
+    try std.testing.expectEqual(0, reader.interface.read(&buffer));
+}
+
+test "Pipe.ShouldWrapAroundRingBuffer" {
+    var ends = try create_pipe(std.testing.allocator, true);
+    defer ends.reader.delete();
+    defer ends.writer.delete();
+    var writer = ends.writer.as_file().?;
+    var reader = ends.reader.as_file().?;
+
+    var data: [Pipe.capacity]u8 = undefined;
+    for (&data, 0..) |*byte, index| {
+        byte.* = @truncate(index);
+    }
+    var buffer: [Pipe.capacity]u8 = undefined;
+    try std.testing.expectEqual(Pipe.capacity - 3, writer.interface.write(data[0 .. Pipe.capacity - 3]));
+    try std.testing.expectEqual(Pipe.capacity - 3, reader.interface.read(&buffer));
+    try std.testing.expectEqual(Pipe.capacity, writer.interface.write(&data));
+    try std.testing.expectEqual(Pipe.capacity, reader.interface.read(&buffer));
+    try std.testing.expectEqualSlices(u8, &data, &buffer);
+}
+
+test "Pipe.ShouldNotBlockInNonBlockingMode" {
+    var ends = try create_pipe(std.testing.allocator, true);
+    defer ends.writer.delete();
+    var writer = ends.writer.as_file().?;
+    var reader = ends.reader.as_file().?;
+
+    var buffer: [4]u8 = undefined;
+    try std.testing.expectEqual(-c.EAGAIN, reader.interface.read(&buffer));
+    try std.testing.expect((reader.interface.fcntl(c.F_GETFL, null) & c.O_NONBLOCK) != 0);
+
+    const data = [_]u8{0} ** (Pipe.capacity + 8);
+    try std.testing.expectEqual(Pipe.capacity, writer.interface.write(&data));
+    try std.testing.expectEqual(-c.EAGAIN, writer.interface.write("x"));
+
+    ends.reader.delete();
+    try std.testing.expectEqual(-c.EPIPE, writer.interface.write("x"));
+}
+
+const hal = @import("hal");
+
+const WriteOnContextSwitch = struct {
+    var writer: ?IFile = null;
+    var calls: usize = 0;
+
+    pub fn call() void {
+        calls += 1;
+        if (writer) |*file| {
+            _ = file.interface.write("data");
+            writer = null;
+        }
+    }
+};
+
+test "Pipe.ShouldBlockReaderUntilDataIsWritten" {
+    defer hal.irq.impl().clear();
+    var ends = try create_pipe(std.testing.allocator, false);
+    defer ends.reader.delete();
+    defer ends.writer.delete();
+    var reader = ends.reader.as_file().?;
+
+    WriteOnContextSwitch.writer = ends.writer.as_file().?;
+    WriteOnContextSwitch.calls = 0;
+    defer WriteOnContextSwitch.writer = null;
+    hal.irq.impl().set_irq_action(.pendsv, &WriteOnContextSwitch.call);
+
+    var buffer: [8]u8 = undefined;
+    try std.testing.expectEqual(4, reader.interface.read(&buffer));
+    try std.testing.expectEqualStrings("data", buffer[0..4]);
+    try std.testing.expectEqual(1, WriteOnContextSwitch.calls);
+}
+
+test "Pipe.ShouldConnectFifoEndsOnOpen" {
+    var fifo = try create_fifo_node(std.testing.allocator, "fifo");
+    defer fifo.delete();
+
+    var reader_node = try fifo.clone();
+    defer reader_node.delete();
+    var reader = reader_node.as_file().?;
+    var flags: c_int = c.O_RDONLY | c.O_NONBLOCK;
+    try std.testing.expectEqual(0, reader.interface.ioctl(@intFromEnum(IoctlCommonCommands.OpenFifo), &flags));
+
+    var writer_node = try fifo.clone();
+    defer writer_node.delete();
+    var writer = writer_node.as_file().?;
+    flags = c.O_WRONLY;
+    try std.testing.expectEqual(0, writer.interface.ioctl(@intFromEnum(IoctlCommonCommands.OpenFifo), &flags));
+    try std.testing.expectEqual(-c.EINVAL, writer.interface.ioctl(@intFromEnum(IoctlCommonCommands.OpenFifo), &flags));
+
+    try std.testing.expectEqual(3, writer.interface.write("abc"));
+    var buffer: [4]u8 = undefined;
+    try std.testing.expectEqual(3, reader.interface.read(&buffer));
+    try std.testing.expectEqualStrings("abc", buffer[0..3]);
+}
+
+test "Pipe.ShouldRejectNonBlockingFifoWriterWithoutReader" {
+    var fifo = try create_fifo_node(std.testing.allocator, "fifo");
+    defer fifo.delete();
+
+    var writer_node = try fifo.clone();
+    defer writer_node.delete();
+    var writer = writer_node.as_file().?;
+    var flags: c_int = c.O_WRONLY | c.O_NONBLOCK;
+    try std.testing.expectEqual(-c.ENXIO, writer.interface.ioctl(@intFromEnum(IoctlCommonCommands.OpenFifo), &flags));
+    try std.testing.expectEqual(-c.EBADF, writer.interface.write("abc"));
+}
@@ -0,0 +1,287 @@
+//
+// poll.zig
+//
+// Copyright (C) 2025 Mateusz Stadnik <matgla@live.com>
+//
+// This program is free software: you can redistribute it and/or
+// modify it under the terms of the GNU General Public License
+// as published by the Free Software Foundation, either version
+// 3 of the License, or (at your option) any later version.
+//
+// This program is distributed in the hope that it will be
+// useful, but WITHOUT ANY WARRANTY; without even the implied
+// warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR
+// PURPOSE. See the GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General
+// Public License along with this program. If not, see
+// <https://www.gnu.org/licenses/>.
+//
+
+const std = @import("std");
+
+const IFile = @import("ifile.zig").IFile;
+const IoctlCommonCommands = @import("ifile.zig").IoctlCommonCommands;
+
+const Completion = @import("../interrupts/kernel_completion.zig").Completion;
+const WaitQueue = @import("../interrupts/kernel_wait_queue.zig").WaitQueue;
+const process_manager = @import("../process_manager.zig");
+const timer = @import("../timer.zig");
+
+// Waiting for many files at once. Each file reports own readiness for
+// IoctlCommonCommands.Poll and adds shared completion to wait queues that are
+// woken when readiness may change, so poller sleeps until any of them or
+// the timeout timer completes it. Files that never report readiness never block.
+
+// same values as used by Linux, poll.h is not provided by libc
+pub const POLLIN: i16 = 0x001;
+pub const POLLPRI: i16 = 0x002;
+pub const POLLOUT: i16 = 0x004;
+pub const POLLERR: i16 = 0x008;
+pub const POLLHUP: i16 = 0x010;
+pub const POLLNVAL: i16 = 0x020;
+
+// reported even when not requested
+const always_reported: i16 = POLLERR | POLLHUP | POLLNVAL;
+
+pub const PollFd = extern struct {
+    fd: c_int,
+    events: c_short,
+    revents: c_short,
+};
+
+// Argument of IoctlCommonCommands.Poll, must not be moved while waiters are queued.
+pub const PollRequest = struct {
+    const Self = @This();
+    const max_queues = 2;
+
+    events: i16,
+    revents: i16 = 0,
+    // null when only readiness is checked
+    completion: ?*Completion = null,
+    // set by files that cannot signal readiness change, they are checked again on next tick
+    needs_polling: bool = false,
+    // set by report, ioctl result alone can't be trusted as many files return 0 for any command
+    handled: bool = false,
+    _waiters: [max_queues]WaitQueue.Waiter = undefined,
+    _queues: [max_queues]?*WaitQueue = .{ null, null },
+
+    // must be called before readiness is checked, so change in between is not lost
+    pub fn watch(self: *Self, queue: *WaitQueue) void {
+        const completion = self.completion orelse return;
+        for (&self._queues, &self._waiters) |*slot, *waiter| {
+            if (slot.* == null) {
+                waiter.* = .{ .completion = completion };
+                slot.* = queue;
+                queue.add(waiter);
+                return;
+            }
+        }
+        self.needs_polling = true;
+    }
+
+    // sets revents from readiness of the file, requested events and errors only
+    pub fn report(self: *Self, ready: i16) void {
+        self.revents = ready & (self.events | always_reported);
+        self.handled = true;
+    }
+
+    pub fn release(self: *Self) void {
+        for (&self._queues, &self._waiters) |*slot, *waiter| {
+            if (slot.*) |queue| {
+                queue.remove(waiter);
+                slot.* = null;
+            }
+        }
+    }
+};
+
+pub const PollEntry = struct {
+    // null for ignored entries (negative fd) or invalid descriptors
+    file: ?IFile = null,
+    invalid: bool = false,
+    request: PollRequest,
+};
+
+fn check(entry: *PollEntry, completion: ?*Completion) void {
+    entry.request.revents = 0;
+    entry.request.needs_polling = false;
+    entry.request.handled = false;
+    entry.request.completion = completion;
+    if (entry.file) |*file| {
+        _ = file.interface.ioctl(@intFromEnum(IoctlCommonCommands.Poll), &entry.request);
+        if (!entry.request.handled) {
+            // files without readiness tracking (i.e. regular files) never block
+            entry.request.report(POLLIN | POLLOUT);
+        }
+    } else if (entry.invalid) {
+        entry.request.revents = POLLNVAL;
+    }
+}
+
+fn release(entries: []PollEntry) void {
+    for (entries) |*entry| {
+        entry.request.release();
+    }
+}
+
+// Returns number of entries with non zero revents. Timeout is given in
+// milliseconds, null waits until any entry is ready and 0 only checks readiness.
+pub fn wait_for_events(entries: []PollEntry, timeout_ms: ?u64) usize {
+    const blocking = timeout_ms == null or timeout_ms.? != 0;
+    var done = Completion{};
+    var deadline = timer.Timer{
+        .callback = &Completion.signal,
+        .context = &done,
+    };
+    var recheck = timer.Timer{
+        .callback = &Completion.signal,
+        .context = &done,
+    };
+    if (timeout_ms) |ms| {
+        if (ms != 0) {
+            timer.start(&deadline, ms);
+        }
+    }
+    defer timer.cancel(&deadline);
+    defer timer.cancel(&recheck);
+
+    while (true) {
+        done.reset();
+        var ready: usize = 0;
+        var needs_polling = false;
+        for (entries) |*entry| {
+            check(entry, if (blocking) &done else null);
+            if (entry.request.revents != 0) {
+                ready += 1;
+            }
+            needs_polling = needs_polling or entry.request.needs_polling;
+        }
+        const expired = timeout_ms != null and !deadline.is_armed();
+        if (ready != 0 or !blocking or expired) {
+            release(entries);
+            return ready;
+        }
+        if (needs_polling) {
+            timer.start(&recheck, 1);
+        }
+        done.wait(process_manager.get_running_process());
+        release(entries);
+    }
+}
+
+const create_pipe = @import("pipe.zig").create_pipe;
+const hal = @import("hal");
+
+test "Poll.ShouldReportReadinessOfPipeEnds" {
+    var ends = try create_pipe(std.testing.allocator, true);
+    defer ends.reader.delete();
+    defer ends.writer.delete();
+    var writer = ends.writer.as_file().?;
+
+    var entries = [_]PollEntry{
+        .{ .file = ends.reader.as_file().?, .request = .{ .events = POLLIN } },
+        .{ .file = ends.writer.as_file().?, .request = .{ .events = POLLOUT } },
+        .{ .invalid = true, .request = .{ .events = POLLIN } },
+        .{ .request = .{ .events = POLLIN } },
+    };
+    try std.testing.expectEqual(2, wait_for_events(&entries, 0));
+    try std.testing.expectEqual(0, entries[0].request.revents);
+    try std.testing.expectEqual(POLLOUT, entries[1].request.revents);
+    try std.testing.expectEqual(POLLNVAL, entries[2].request.revents);
+    try std.testing.expectEqual(0, entries[3].request.revents);
+
+    try std.testing.expectEqual(4, writer.interface.write("data"));
+    try std.testing.expectEqual(3, wait_for_events(&entries, 0));
+    try std.testing.expectEqual(POLLIN, entries[0].request.revents);
+}
+
+test "Poll.ShouldReportHangupWhenWriterIsClosed" {
+    var ends = try create_pipe(std.testing.allocator, true);
+    defer ends.reader.delete();
+
+    var entries = [_]PollEntry{
+        .{ .file = ends.reader.as_file().?, .request = .{ .events = POLLIN } },
+    };
+    ends.writer.delete();
+    try std.testing.expectEqual(1, wait_for_events(&entries, null));
+    try std.testing.expectEqual(POLLHUP, entries[0].request.revents);
+}
+
+const FileMock = @import("tests/file_mock.zig").FileMock;
+
+test "Poll.ShouldTreatFileThatDoesNotReportAsReady" {
+    var file_mock = try FileMock.create(std.testing.allocator);
+    defer file_mock.delete();
+
+    // like procfs files, ioctl succeeds for any command without reporting readiness
+    _ = file_mock
+        .expectCall("ioctl")
+        .willReturn(@as(i32, 0));
+
+    var entries = [_]PollEntry{
+        .{ .file = file_mock.get_interface(), .request = .{ .events = POLLIN | POLLOUT } },
+    };
+    try std.testing.expectEqual(1, wait_for_events(&entries, null));
+    try std.testing.expectEqual(POLLIN | POLLOUT, entries[0].request.revents);
+}
+
+const WriteOnContextSwitch = struct {
+    var writer: ?IFile = null;
+    var calls: usize = 0;
+
+    pub fn call() void {
+        calls += 1;
+        if (writer) |*file| {
+            _ = file.interface.write("x");
+            writer = null;
+        }
+    }
+};
+
+test "Poll.ShouldSleepUntilPipeBecomesReadable" {
+    defer hal.irq.impl().clear();
+    var ends = try create_pipe(std.testing.allocator, true);
+    defer ends.reader.delete();
+    defer ends.writer.delete();
+
+    var entries = [_]PollEntry{
+        .{ .file = ends.reader.as_file().?, .request = .{ .events = POLLIN } },
+    };
+    WriteOnContextSwitch.writer = ends.writer.as_file().?;
+    WriteOnContextSwitch.calls = 0;
+    defer WriteOnContextSwitch.writer = null;
+    hal.irq.impl().set_irq_action(.pendsv, &WriteOnContextSwitch.call);
+
+    try std.testing.expectEqual(1, wait_for_events(&entries, null));
+    try std.testing.expectEqual(POLLIN, entries[0].request.revents);
+    try std.testing.expectEqual(1, WriteOnContextSwitch.calls);
+    // waiters are removed from pipe queues before returning
+    try std.testing.expect(entries[0].request._queues[0] == null);
+}
+
+const TickOnContextSwitch = struct {
+    var calls: usize = 0;
+
+    pub fn call() void {
+        calls += 1;
+        _ = timer.tick();
+    }
+};
+
+test "Poll.ShouldReturnZeroAfterTimeout" {
+    defer hal.irq.impl().clear();
+    var ends = try create_pipe(std.testing.allocator, true);
+    defer ends.reader.delete();
+    defer ends.writer.delete();
+
+    var entries = [_]PollEntry{
+        .{ .file = ends.reader.as_file().?, .request = .{ .events = POLLIN } },
+    };
+    TickOnContextSwitch.calls = 0;
+    hal.irq.impl().set_irq_action(.pendsv, &TickOnContextSwitch.call);
+
+    try std.testing.expectEqual(0, wait_for_events(&entries, 20));
+    try std.testing.expectEqual(0, entries[0].request.revents);
+    try std.testing.expectEqual(20, TickOnContextSwitch.calls);
+}
@@ -17,5 +17,9 @@ comptime {
     _ = @import("mount_points.zig");
     _ = @import("vfs.zig");
     _ = @import("mbr.zig");
+    _ = @import("path.zig");
+    _ = @import("pipe.zig");
+    _ = @import("poll.zig");
     _ = @import("buffered_file.zig");
+    _ = @import("block_cache.zig");
 }
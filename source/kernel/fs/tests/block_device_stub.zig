@@ -0,0 +1,115 @@
+// Copyright (c) 2025 Mateusz Stadnik
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program. If not, see <https://www.gnu.org/licenses/>.
+
+const c = @import("libc_imports").c;
+const interface = @import("interface");
+
+const kernel = @import("../../kernel.zig");
+
+// RAM backed block device, state is owned by test and shared between clones
+pub const BlockDeviceState = struct {
+    data: []u8,
+    reads: usize = 0,
+    writes: usize = 0,
+    syncs: usize = 0,
+};
+
+pub const BlockDeviceStub = interface.DeriveFromBase(kernel.fs.IFile, struct {
+    const Self = @This();
+    _state: *BlockDeviceState,
+    _position: usize,
+
+    pub fn create(state: *BlockDeviceState) BlockDeviceStub {
+        return BlockDeviceStub.init(.{
+            ._state = state,
+            ._position = 0,
+        });
+    }
+
+    pub fn __clone(self: *Self, other: *Self) void {
+        self._state = other._state;
+        self._position = other._position;
+    }
+
+    pub fn read(self: *Self, buf: []u8) isize {
+        self._state.reads += 1;
+        if (self._position >= self._state.data.len) {
+            return 0;
+        }
+        const length = @min(buf.len, self._state.data.len - self._position);
+        @memcpy(buf[0..length], self._state.data[self._position..][0..length]);
+        self._position += length;
+        return @intCast(length);
+    }
+
+    pub fn write(self: *Self, buf: []const u8) isize {
+        self._state.writes += 1;
+        if (self._position + buf.len > self._state.data.len) {
+            return -1;
+        }
+        @memcpy(self._state.data[self._position..][0..buf.len], buf);
+        self._position += buf.len;
+        return @intCast(buf.len);
+    }
+
+    pub fn seek(self: *Self, offset: i64, base: i32) anyerror!i64 {
+        switch (base) {
+            c.SEEK_SET => self._position = @intCast(offset),
+            else => return kernel.errno.ErrnoSet.InvalidArgument,
+        }
+        return offset;
+    }
+
+    pub fn sync(self: *Self) i32 {
+        self._state.syncs += 1;
+        return 0;
+    }
+
+    pub fn tell(self: *Self) i64 {
+        return @intCast(self._position);
+    }
+
+    pub fn name(self: *const Self) []const u8 {
+        _ = self;
+        return "blockdev";
+    }
+
+    pub fn ioctl(self: *Self, cmd: i32, arg: ?*anyopaque) i32 {
+        _ = self;
+        _ = cmd;
+        _ = arg;
+        return 0;
+    }
+
+    pub fn fcntl(self: *Self, cmd: i32, arg: ?*anyopaque) i32 {
+        _ = self;
+        _ = cmd;
+        _ = arg;
+        return 0;
+    }
+
+    pub fn size(self: *const Self) u64 {
+        return self._state.data.len;
+    }
+
+    pub fn filetype(self: *const Self) kernel.fs.FileType {
+        _ = self;
+        return kernel.fs.FileType.BlockDevice;
+    }
+
+    pub fn delete(self: *Self) void {
+        _ = self;
+    }
+});
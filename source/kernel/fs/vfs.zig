@@ -37,6 +37,8 @@ const log = std.log.scoped(.vfs);
 pub const VirtualFileSystem = interface.DeriveFromBase(IFileSystem, struct {
     const Self = @This();
     mount_points: MountPoints,
+    // incremented when filesystem is mounted or unmounted, lets callers keep caches of resolved paths
+    generation: usize = 0,
 
     pub fn mount(self: *Self) i32 {
         _ = self;
@@ -116,9 +118,15 @@ pub const VirtualFileSystem = interface.DeriveFromBase(IFileSystem, struct {
     }
 
     pub fn mount_filesystem(self: *Self, path: []const u8, fs: IFileSystem) !void {
+        self.generation +%= 1;
         try self.mount_points.mount_filesystem(path, fs);
     }
 
+    pub fn umount_filesystem(self: *Self, path: []const u8) !void {
+        self.generation +%= 1;
+        try self.mount_points.umount(path);
+    }
+
     pub fn link(self: *Self, old_path: []const u8, new_path: []const u8) anyerror!void {
         _ = self;
         _ = old_path;
@@ -485,3 +493,25 @@ test "VirtualFileSystem.GetShouldFailIfNoFilesystemMounted" {
 
     try std.testing.expectError(kernel.errno.ErrnoSet.NoEntry, sut.get("/file.txt"));
 }
+
+test "VirtualFileSystem.ShouldChangeGenerationOnlyWhenMountPointsChange" {
+    const FileSystemMock = @import("tests/filesystem_mock.zig").FileSystemMock;
+    var fs_mock = try FileSystemMock.create(std.testing.allocator);
+    const fs = fs_mock.get_interface();
+
+    vfs_init(std.testing.allocator);
+    const sut = get_vfs();
+    defer vfs_deinit();
+
+    const initial = sut.generation;
+    try sut.mount_filesystem("/", fs);
+    const mounted = sut.generation;
+    try std.testing.expect(mounted != initial);
+
+    _ = fs_mock
+        .expectCall("unlink")
+        .withArgs(.{"lib/libc.so"});
+
+    try sut.unlink("/lib/libc.so");
+    try std.testing.expectEqual(mounted, sut.generation);
+}
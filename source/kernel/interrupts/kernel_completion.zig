@@ -0,0 +1,159 @@
+//
+// kernel_completion.zig
+//
+// Copyright (C) 2025 Mateusz Stadnik <matgla@live.com>
+//
+// This program is free software: you can redistribute it and/or
+// modify it under the terms of the GNU General Public License
+// as published by the Free Software Foundation, either version
+// 3 of the License, or (at your option) any later version.
+//
+// This program is distributed in the hope that it will be
+// useful, but WITHOUT ANY WARRANTY; without even the implied
+// warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR
+// PURPOSE. See the GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General
+// Public License along with this program. If not, see
+// <https://www.gnu.org/licenses/>.
+//
+
+const std = @import("std");
+
+const hal = @import("hal");
+const arch = @import("arch");
+
+const Process = @import("../process.zig").Process;
+const Semaphore = @import("../semaphore.zig").Semaphore;
+
+// Completion is signalled from interrupt handlers (i.e. DMA transfer finished),
+// waiting process is kept in Blocked state until that happens, so scheduler
+// doesn't waste time slices on polling.
+
+pub const Completion = struct {
+    const Self = @This();
+    // used only as blocking token for process state
+    _event: Semaphore = Semaphore.create(0),
+    _done: bool = false,
+    _waiter: ?*Process = null,
+
+    // callback compatible with HAL completion handlers, context must point to Completion
+    pub fn signal(context: ?*anyopaque) void {
+        const self: *Self = @ptrCast(@alignCast(context.?));
+        self.complete();
+    }
+
+    pub fn complete(self: *Self) void {
+        const done: *volatile bool = &self._done;
+        done.* = true;
+        if (self._waiter) |waiter| {
+            waiter.unblock_semaphore(&self._event);
+        }
+    }
+
+    pub fn is_done(self: *const Self) bool {
+        const done: *const volatile bool = &self._done;
+        return done.*;
+    }
+
+    pub fn reset(self: *Self) void {
+        self._done = false;
+        self._waiter = null;
+    }
+
+    // waiter may be null when called outside of process context, then it just yields until done,
+    // context switching must be enabled, as completion may be waiting for other process
+    pub fn wait(self: *Self, waiter: ?*Process) void {
+        const state = arch.sync.save_and_disable_interrupts();
+        if (!self.is_done()) {
+            // PendSV is ignored while context switching is blocked, so yielding would spin forever
+            std.debug.assert(!kernel.process.is_context_switch_blocked());
+            if (waiter) |process| {
+                self._waiter = process;
+                process.block_semaphore(&self._event);
+            }
+        }
+        arch.sync.restore_interrupts(state);
+
+        while (!self.is_done()) {
+            hal.irq.trigger(.pendsv);
+        }
+
+        if (self._waiter) |process| {
+            process.unblock_semaphore(&self._event);
+        }
+        self._waiter = null;
+    }
+
+    // busy waits without yielding, only for completions signalled from interrupt handlers,
+    // usable when context switching is blocked
+    pub fn wait_for_interrupt(self: *const Self) void {
+        while (!self.is_done()) {}
+    }
+};
+
+const kernel = @import("../kernel.zig");
+
+fn test_entry() void {}
+
+const CompleteOnContextSwitch = struct {
+    var completion: ?*Completion = null;
+    var process: ?*Process = null;
+    var observed_state: ?Process.State = null;
+
+    pub fn call() void {
+        if (process) |p| {
+            observed_state = p.state;
+        }
+        if (completion) |c| {
+            c.complete();
+        }
+    }
+};
+
+test "Completion.ShouldReturnImmediatelyWhenAlreadyCompleted" {
+    var sut = Completion{};
+    Completion.signal(&sut);
+    try std.testing.expect(sut.is_done());
+    sut.wait(null);
+    try std.testing.expect(sut.is_done());
+    sut.reset();
+    try std.testing.expect(!sut.is_done());
+}
+
+test "Completion.ShouldBlockWaiterUntilCompleted" {
+    kernel.process.process_manager.initialize_process_manager(std.testing.allocator);
+    defer kernel.process.process_manager.deinitialize_process_manager();
+    defer hal.irq.impl().clear();
+
+    var proc_arg: usize = 0;
+    try kernel.process.process_manager.instance.create_process(1024, &test_entry, &proc_arg, "test");
+    _ = kernel.process.process_manager.instance.schedule_next();
+    _ = kernel.process.process_manager.process_set_next_task();
+    const process = kernel.process.process_manager.get_running_process().?;
+
+    var sut = Completion{};
+    CompleteOnContextSwitch.completion = &sut;
+    CompleteOnContextSwitch.process = process;
+    CompleteOnContextSwitch.observed_state = null;
+    defer {
+        CompleteOnContextSwitch.completion = null;
+        CompleteOnContextSwitch.process = null;
+    }
+    hal.irq.impl().set_irq_action(.pendsv, &CompleteOnContextSwitch.call);
+
+    sut.wait(process);
+    try std.testing.expectEqual(Process.State.Blocked, CompleteOnContextSwitch.observed_state.?);
+    try std.testing.expect(sut.is_done());
+    process.reevaluate_state();
+    try std.testing.expectEqual(Process.State.Ready, process.state);
+}
+
+test "Completion.ShouldWaitForInterruptWhenContextSwitchIsBlocked" {
+    kernel.process.block_context_switch();
+    defer kernel.process.unblock_context_switch();
+    var sut = Completion{};
+    sut.complete();
+    sut.wait_for_interrupt();
+    try std.testing.expect(sut.is_done());
+}
@@ -0,0 +1,121 @@
+//
+// kernel_io_lock.zig
+//
+// Copyright (C) 2025 Mateusz Stadnik <matgla@live.com>
+//
+// This program is free software: you can redistribute it and/or
+// modify it under the terms of the GNU General Public License
+// as published by the Free Software Foundation, either version
+// 3 of the License, or (at your option) any later version.
+//
+// This program is distributed in the hope that it will be
+// useful, but WITHOUT ANY WARRANTY; without even the implied
+// warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR
+// PURPOSE. See the GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General
+// Public License along with this program. If not, see
+// <https://www.gnu.org/licenses/>.
+//
+
+const std = @import("std");
+
+const hal = @import("hal");
+const arch = @import("arch");
+
+const process_manager = @import("../process_manager.zig");
+const Completion = @import("kernel_completion.zig").Completion;
+
+// Serializes requests to a single device without masking interrupts.
+// Requests that find the device busy are queued in arrival order and the
+// issuing processes stay Blocked until the lock is handed over to them.
+
+pub const IoLock = struct {
+    const Self = @This();
+
+    const Request = struct {
+        granted: Completion = .{},
+        node: std.DoublyLinkedList.Node = .{},
+    };
+
+    _locked: bool = false,
+    _queue: std.DoublyLinkedList = .{},
+
+    pub fn lock(self: *Self) void {
+        var request = Request{};
+        const state = arch.sync.save_and_disable_interrupts();
+        if (!self._locked) {
+            self._locked = true;
+            arch.sync.restore_interrupts(state);
+            return;
+        }
+        self._queue.append(&request.node);
+        arch.sync.restore_interrupts(state);
+
+        request.granted.wait(process_manager.get_running_process());
+    }
+
+    pub fn unlock(self: *Self) void {
+        const state = arch.sync.save_and_disable_interrupts();
+        defer arch.sync.restore_interrupts(state);
+        if (self._queue.popFirst()) |node| {
+            // lock stays taken, ownership goes directly to the oldest request
+            const request: *Request = @fieldParentPtr("node", node);
+            request.granted.complete();
+            return;
+        }
+        self._locked = false;
+    }
+
+    pub fn is_locked(self: *const Self) bool {
+        const locked: *const volatile bool = &self._locked;
+        return locked.*;
+    }
+
+    pub fn pending_requests(self: *const Self) usize {
+        return self._queue.len();
+    }
+};
+
+const UnlockOnContextSwitch = struct {
+    var lock: ?*IoLock = null;
+    var queued: usize = 0;
+
+    pub fn call() void {
+        if (lock) |l| {
+            queued = l.pending_requests();
+            l.unlock();
+        }
+    }
+};
+
+test "IoLock.ShouldLockFreeDeviceImmediately" {
+    var sut = IoLock{};
+    try std.testing.expect(!sut.is_locked());
+    sut.lock();
+    try std.testing.expect(sut.is_locked());
+    try std.testing.expectEqual(0, sut.pending_requests());
+    sut.unlock();
+    try std.testing.expect(!sut.is_locked());
+}
+
+test "IoLock.ShouldQueueRequestUntilOwnerUnlocks" {
+    defer hal.irq.impl().clear();
+    var sut = IoLock{};
+    sut.lock();
+
+    UnlockOnContextSwitch.lock = &sut;
+    UnlockOnContextSwitch.queued = 0;
+    defer UnlockOnContextSwitch.lock = null;
+    hal.irq.impl().set_irq_action(.pendsv, &UnlockOnContextSwitch.call);
+
+    // second request waits in queue, owner releases device from other context
+    sut.lock();
+    try std.testing.expectEqual(1, UnlockOnContextSwitch.queued);
+    try std.testing.expect(sut.is_locked());
+    try std.testing.expectEqual(0, sut.pending_requests());
+
+    UnlockOnContextSwitch.lock = null;
+    sut.unlock();
+    try std.testing.expect(!sut.is_locked());
+}
@@ -0,0 +1,34 @@
+//
+// kernel_irq_lock.zig
+//
+// Copyright (C) 2025 Mateusz Stadnik <matgla@live.com>
+//
+// This program is free software: you can redistribute it and/or
+// modify it under the terms of the GNU General Public License
+// as published by the Free Software Foundation, either version
+// 3 of the License, or (at your option) any later version.
+//
+// This program is distributed in the hope that it will be
+// useful, but WITHOUT ANY WARRANTY; without even the implied
+// warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR
+// PURPOSE. See the GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General
+// Public License along with this program. If not, see
+// <https://www.gnu.org/licenses/>.
+//
+
+const arch = @import("arch");
+
+// Protects kernel data used both from interrupts and process context on a single
+// core. Interrupts are masked, so the owner is never preempted while holding the
+// lock. Previous mask is restored on unlock, so nested sections are allowed.
+pub const IrqLock = struct {
+    pub fn lock() usize {
+        return arch.sync.save_and_disable_interrupts();
+    }
+
+    pub fn unlock(state: usize) void {
+        arch.sync.restore_interrupts(state);
+    }
+};
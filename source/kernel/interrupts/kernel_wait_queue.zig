@@ -0,0 +1,108 @@
+//
+// kernel_wait_queue.zig
+//
+// Copyright (C) 2025 Mateusz Stadnik <matgla@live.com>
+//
+// This program is free software: you can redistribute it and/or
+// modify it under the terms of the GNU General Public License
+// as published by the Free Software Foundation, either version
+// 3 of the License, or (at your option) any later version.
+//
+// This program is distributed in the hope that it will be
+// useful, but WITHOUT ANY WARRANTY; without even the implied
+// warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR
+// PURPOSE. See the GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General
+// Public License along with this program. If not, see
+// <https://www.gnu.org/licenses/>.
+//
+
+const std = @import("std");
+
+const arch = @import("arch");
+
+const Completion = @import("kernel_completion.zig").Completion;
+
+// Processes waiting for a state change of some object (i.e. data available in pipe).
+// Waiter must be added before the condition is checked, so wake up that happens
+// in between is not lost. Waiters only point to completion, so single process can
+// wait on many queues at once. Condition must be checked again after wake up.
+
+pub const WaitQueue = struct {
+    const Self = @This();
+
+    pub const Waiter = struct {
+        completion: *Completion,
+        node: std.DoublyLinkedList.Node = .{},
+        queued: bool = false,
+    };
+
+    _waiters: std.DoublyLinkedList = .{},
+
+    pub fn add(self: *Self, waiter: *Waiter) void {
+        const state = arch.sync.save_and_disable_interrupts();
+        defer arch.sync.restore_interrupts(state);
+        if (!waiter.queued) {
+            self._waiters.append(&waiter.node);
+            waiter.queued = true;
+        }
+    }
+
+    pub fn remove(self: *Self, waiter: *Waiter) void {
+        const state = arch.sync.save_and_disable_interrupts();
+        defer arch.sync.restore_interrupts(state);
+        if (waiter.queued) {
+            self._waiters.remove(&waiter.node);
+            waiter.queued = false;
+        }
+    }
+
+    // every waiter is woken up and removed from queue
+    pub fn wake_all(self: *Self) void {
+        const state = arch.sync.save_and_disable_interrupts();
+        defer arch.sync.restore_interrupts(state);
+        while (self._waiters.popFirst()) |node| {
+            const waiter: *Waiter = @fieldParentPtr("node", node);
+            waiter.queued = false;
+            waiter.completion.complete();
+        }
+    }
+
+    pub fn is_empty(self: *const Self) bool {
+        return self._waiters.first == null;
+    }
+};
+
+test "WaitQueue.ShouldCompleteAllWaiters" {
+    var sut = WaitQueue{};
+    var first_done = Completion{};
+    var second_done = Completion{};
+    var first = WaitQueue.Waiter{ .completion = &first_done };
+    var second = WaitQueue.Waiter{ .completion = &second_done };
+
+    sut.add(&first);
+    sut.add(&second);
+    sut.add(&second);
+    try std.testing.expectEqual(2, sut._waiters.len());
+
+    sut.wake_all();
+    try std.testing.expect(sut.is_empty());
+    try std.testing.expect(first_done.is_done());
+    try std.testing.expect(second_done.is_done());
+    try std.testing.expect(!first.queued);
+}
+
+test "WaitQueue.ShouldNotCompleteRemovedWaiter" {
+    var sut = WaitQueue{};
+    var done = Completion{};
+    var waiter = WaitQueue.Waiter{ .completion = &done };
+
+    sut.add(&waiter);
+    sut.remove(&waiter);
+    sut.remove(&waiter);
+    try std.testing.expect(sut.is_empty());
+
+    sut.wake_all();
+    try std.testing.expect(!done.is_done());
+}
@@ -28,6 +28,7 @@ const kernel = @import("../kernel.zig");
 const log = std.log.scoped(.syscall);
 
 const systick = @import("systick.zig");
+const time = @import("../time.zig");
 
 const config = @import("config");
 
@@ -46,18 +47,6 @@ pub fn init(allocator: std.mem.Allocator) void {
 }
 
 // most stupid way to keep track of the last file
-fn fill_dirent(entry: kernel.fs.DirectoryEntry, dirent_address: *anyopaque) isize {
-    const required_space = std.mem.alignForward(usize, @sizeOf(c.dirent) - 1 + entry.name.len, @alignOf(c.dirent));
-    // skip files that were already traversed
-    const dirp: *c.dirent = @as(*c.dirent, @ptrCast(@alignCast(dirent_address)));
-    dirp.d_ino = 0xdead;
-    dirp.d_off = 0xbeef;
-    dirp.d_reclen = @intCast(required_space);
-    std.mem.copyForwards(u8, dirp.d_name[0..], entry.name);
-    dirp.d_name[entry.name.len] = 0;
-    return @intCast(required_space);
-}
-
 fn get_file_from_process(fd: u16) !kernel.fs.IFile {
     const process = process_manager.instance.get_current_process();
     const maybe_handle = process.get_file_handle(fd);
@@ -71,6 +60,14 @@ fn get_file_from_process(fd: u16) !kernel.fs.IFile {
     return kernel.errno.ErrnoSet.NoSuchProcess;
 }
 
+// descriptor is looked up with context switching blocked, file is used after it is enabled again,
+// as filesystems may wait for I/O done by other processes
+fn get_file_from_process_blocked(fd: u16) !kernel.fs.IFile {
+    kernel.process.block_context_switch();
+    defer kernel.process.unblock_context_switch();
+    return try get_file_from_process(fd);
+}
+
 const DirentTraverseTracker = struct {
     dirp: *allowzero c.dirent,
     offset: usize,
@@ -150,9 +147,11 @@ pub fn sys_getpid(arg: *const volatile anyopaque) !i32 {
 
 pub fn sys_mkdir(arg: *const volatile anyopaque) !i32 {
     const context: *const volatile c.mkdir_context = @ptrCast(@alignCast(arg));
-    const path = try determine_path_for_file(kernel_allocator, context.path, context.fd);
-    defer kernel_allocator.free(path);
+    const scratch = try kernel.fs.ScratchPath.acquire(kernel_allocator);
+    defer scratch.release();
+    const path = try determine_path_for_file(scratch, context.path, context.fd);
     try fs.get_ivfs().interface.mkdir(path, @intCast(context.mode));
+    dynamic_loader.invalidate_library_index_for(path);
     return 0;
 }
 
@@ -180,54 +179,49 @@ pub fn sys_isatty(arg: *const volatile anyopaque) !i32 {
     return 0;
 }
 
-fn determine_path_for_file(allocator: std.mem.Allocator, maybe_path: [*c]const u8, fd: i32) ![]const u8 {
-    var prefix: []const u8 = "";
+// path is resolved into scratch buffer, returned slice is valid until scratch is released
+fn determine_path_for_file(scratch: kernel.fs.ScratchPath, maybe_path: [*c]const u8, fd: i32) ![]const u8 {
+    const current_process = process_manager.instance.get_current_process();
+    const buffer = scratch.buffer;
     if (maybe_path) |cpath| {
         const path = std.mem.span(@as([*:0]const u8, @ptrCast(cpath)));
+        if (path.len == 0) {
+            return kernel.errno.ErrnoSet.NoEntry;
+        }
+        var prefix: []const u8 = current_process.get_current_directory();
         if (fd >= 0) {
-            const current_process = process_manager.instance.get_current_process();
-            prefix = current_process.get_current_directory();
-            const maybe_handle = current_process.get_file_handle(@intCast(fd));
-            if (maybe_handle) |handle| {
-                if (handle.node.is_directory()) {
-                    prefix = handle.path;
-                }
-            } else {
-                return error.CannotDeterminePathForFd;
-            }
-            const full_path = try std.fmt.allocPrint(allocator, "{s}/{s}", .{ prefix, path });
-            defer allocator.free(full_path);
-            const real = try std.fs.path.resolve(allocator, &.{full_path});
-            return real;
-        } else {
-            if (path.len > 0 and path[0] != '/') {
-                const current_process = process_manager.instance.get_current_process();
-                const pwd = current_process.get_current_directory();
-                const full_path = try std.fmt.allocPrint(allocator, "{s}/{s}/{s}", .{ pwd, prefix, path });
-                defer allocator.free(full_path);
-                const real = try std.fs.path.resolve(allocator, &.{full_path});
-                return real;
-            } else {
-                return try allocator.dupe(u8, path);
+            const handle = current_process.get_file_handle(fd) orelse return error.CannotDeterminePathForFd;
+            if (handle.node.is_directory()) {
+                prefix = handle.path;
             }
         }
+        return try kernel.fs.resolve_path(buffer, &.{ prefix, path });
     } else if (fd >= 0) {
-        const current_process = process_manager.instance.get_current_process();
-        const maybe_handle = current_process.get_file_handle(@intCast(fd));
+        const maybe_handle = current_process.get_file_handle(fd);
         if (maybe_handle) |handle| {
-            return try allocator.dupe(u8, handle.path);
+            return try kernel.fs.resolve_path(buffer, &.{handle.path});
         }
     }
     return error.CannotDeterminePath;
 }
 
 pub fn sys_open(arg: *const volatile anyopaque) !i32 {
-    kernel.process.block_context_switch();
-    defer kernel.process.unblock_context_switch();
     const context: *const volatile c.open_context = @ptrCast(@alignCast(arg));
-    const path = try determine_path_for_file(kernel_allocator, context.path, context.fd);
-    defer kernel_allocator.free(path);
+    const fd = try open_file(context);
+    // named FIFO may wait for the other end, so it is connected with context switching enabled
+    errdefer _ = close_fd(fd);
+    try connect_fifo(fd, context.flags);
+    return fd;
+}
+
+fn open_file(context: *const volatile c.open_context) !i32 {
+    const scratch = try kernel.fs.ScratchPath.acquire(kernel_allocator);
+    defer scratch.release();
+    const path = try determine_path_for_file(scratch, context.path, context.fd);
     const process = process_manager.instance.get_current_process();
+    if ((context.flags & (c.O_WRONLY | c.O_RDWR | c.O_TRUNC | c.O_APPEND | c.O_CREAT)) != 0) {
+        dynamic_loader.invalidate_library_index_for(path);
+    }
     const maybe_node: ?kernel.fs.Node = fs.get_ivfs().interface.get(path) catch |err| blk: {
         break :blk switch (err) {
             error.NoEntry => null,
@@ -235,15 +229,53 @@ pub fn sys_open(arg: *const volatile anyopaque) !i32 {
         };
     };
     if (maybe_node) |file| {
-        return try process.attach_file(path, file);
+        if ((context.flags & (c.O_WRONLY | c.O_RDWR | c.O_TRUNC | c.O_APPEND)) != 0) {
+            if (file.as_file()) |f| {
+                dynamic_loader.invalidate_relocation_cache_for(f);
+            }
+        }
+        return try attach_file(process, path, file);
     } else if ((context.flags & c.O_CREAT) != 0) {
         try fs.get_ivfs().interface.create(path, context.mode);
         const ifile = try fs.get_ivfs().interface.get(path);
-        return try process.attach_file(path, ifile);
+        return try attach_file(process, path, ifile);
     }
     return -1;
 }
 
+// filesystem may wait for I/O, so only descriptor table update is done with context switching blocked
+fn attach_file(process: *kernel.process.Process, path: []const u8, node: kernel.fs.Node) !i32 {
+    kernel.process.block_context_switch();
+    defer kernel.process.unblock_context_switch();
+    return try process.attach_file(path, node);
+}
+
+fn connect_fifo(fd: i32, flags: c_int) !void {
+    kernel.process.block_context_switch();
+    const process = process_manager.instance.get_current_process();
+    const maybe_handle = process.get_file_handle(fd);
+    kernel.process.unblock_context_switch();
+    const handle = maybe_handle orelse return;
+    var file = handle.node.as_file() orelse return;
+    if (file.interface.filetype() != FileType.Fifo) {
+        return;
+    }
+    var open_flags: c_int = flags;
+    const result = file.interface.ioctl(@intFromEnum(kernel.fs.IoctlCommonCommands.OpenFifo), &open_flags);
+    // -1 is returned by FIFOs that are not backed by pipes (i.e. on romfs)
+    if (result < -1) {
+        return kernel.errno.from_errno(@intCast(-result));
+    }
+}
+
+// pipes report errors as negative errno values
+fn file_result(result: isize) !isize {
+    if (result < -1) {
+        return kernel.errno.from_errno(@intCast(-result));
+    }
+    return result;
+}
+
 fn close_fd(fd: i32) i32 {
     if (fd < 0) {
         return -1;
@@ -254,8 +286,6 @@ fn close_fd(fd: i32) i32 {
 }
 
 pub fn sys_close(arg: *const volatile anyopaque) !i32 {
-    kernel.process.block_context_switch();
-    defer kernel.process.unblock_context_switch();
     const fd: *const volatile c_int = @ptrCast(@alignCast(arg));
     return close_fd(fd.*);
 }
@@ -284,7 +314,9 @@ pub fn sys_read(arg: *const volatile anyopaque) !i32 {
     if (maybe_handle) |handle| {
         var maybe_file = handle.node.as_file();
         if (maybe_file) |*file| {
-            context.result.* = file.interface.read(@as([*]u8, @ptrCast(context.buf.?))[0..context.count]);
+            const result = file.interface.read(@as([*]u8, @ptrCast(context.buf.?))[0..context.count]);
+            context.result.* = result;
+            _ = try file_result(result);
 
             return 0;
         }
@@ -313,7 +345,9 @@ pub fn sys_write(arg: *const volatile anyopaque) !i32 {
     if (maybe_handle) |handle| {
         var maybe_file = handle.node.as_file();
         if (maybe_file) |*file| {
-            context.result.* = file.interface.write(@as([*]const u8, @ptrCast(context.buf.?))[0..context.count]);
+            const result = file.interface.write(@as([*]const u8, @ptrCast(context.buf.?))[0..context.count]);
+            context.result.* = result;
+            _ = try file_result(result);
         }
         return 0;
     }
@@ -326,33 +360,37 @@ pub fn sys_vfork(arg: *const volatile anyopaque) !i32 {
 }
 
 pub fn sys_unlink(arg: *const volatile anyopaque) !i32 {
-    kernel.process.block_context_switch();
-    defer kernel.process.unblock_context_switch();
     const context: *const volatile c.unlink_context = @ptrCast(@alignCast(arg));
-    const path = try determine_path_for_file(kernel_allocator, context.pathname, context.dirfd);
-    defer kernel_allocator.free(path);
+    const scratch = try kernel.fs.ScratchPath.acquire(kernel_allocator);
+    defer scratch.release();
+    const path = try determine_path_for_file(scratch, context.pathname, context.dirfd);
     try fs.get_ivfs().interface.unlink(path);
+    dynamic_loader.invalidate_library_index_for(path);
     return 0;
 }
 pub fn sys_link(arg: *const volatile anyopaque) !i32 {
     const context: *const volatile c.link_context = @ptrCast(@alignCast(arg));
-    const old_path = try determine_path_for_file(kernel_allocator, context.oldpath, context.olddirfd);
-    defer kernel_allocator.free(old_path);
-    const new_path = try determine_path_for_file(kernel_allocator, context.newpath, context.newdirfd);
-    defer kernel_allocator.free(new_path);
+    const old_scratch = try kernel.fs.ScratchPath.acquire(kernel_allocator);
+    defer old_scratch.release();
+    const new_scratch = try kernel.fs.ScratchPath.acquire(kernel_allocator);
+    defer new_scratch.release();
+    const old_path = try determine_path_for_file(old_scratch, context.oldpath, context.olddirfd);
+    const new_path = try determine_path_for_file(new_scratch, context.newpath, context.newdirfd);
     try fs.get_ivfs().interface.link(old_path, new_path);
+    dynamic_loader.invalidate_library_index_for(new_path);
     return 0;
 }
 
 pub fn sys_stat(arg: *const volatile anyopaque) !i32 {
+    const started = kernel.benchmark.start();
+    defer kernel.benchmark.stop(.stat, started);
     const context: *const volatile c.stat_context = @ptrCast(@alignCast(arg));
     if (context.statbuf == null) {
         return kernel.errno.ErrnoSet.InvalidArgument;
     }
-    kernel.process.block_context_switch();
-    defer kernel.process.unblock_context_switch();
-    const path = try determine_path_for_file(kernel_allocator, context.pathname, context.fd);
-    defer kernel_allocator.free(path);
+    const scratch = try kernel.fs.ScratchPath.acquire(kernel_allocator);
+    defer scratch.release();
+    const path = try determine_path_for_file(scratch, context.pathname, context.fd);
     try fs.get_ivfs().interface.stat(path, context.statbuf, context.follow_links != 0);
     return 0;
 }
@@ -363,10 +401,8 @@ pub fn sys_getentropy(arg: *const volatile anyopaque) !i32 {
 }
 
 pub fn sys_lseek(arg: *const volatile anyopaque) !i32 {
-    kernel.process.block_context_switch();
-    defer kernel.process.unblock_context_switch();
     const context: *const volatile c.lseek_context = @ptrCast(@alignCast(arg));
-    var file = try get_file_from_process(@intCast(context.fd));
+    var file = try get_file_from_process_blocked(@intCast(context.fd));
     context.result.* = @intCast(try file.interface.seek(@intCast(context.offset), context.whence));
     return 0;
 }
@@ -381,31 +417,33 @@ pub fn sys_times(arg: *const volatile anyopaque) !i32 {
 }
 
 pub fn sys_getdents(arg: *const volatile anyopaque) !i32 {
-    kernel.process.block_context_switch();
-    defer kernel.process.unblock_context_switch();
+    const started = kernel.benchmark.start();
+    defer kernel.benchmark.stop(.getdents, started);
     const context: *const volatile c.getdents_context = @ptrCast(@alignCast(arg));
 
     context.result.* = -1;
-    if (context.dirp == null) {} else {
-        const process = process_manager.instance.get_current_process();
-        const maybe_handle = process.get_file_handle(@intCast(context.fd));
-        if (maybe_handle) |handle| {
-            // if iterator not exists create one
-            const diriter: ?*kernel.fs.IDirectoryIterator = handle.get_iterator() catch null;
-            // still can be null if path not exists or is not a directory
-            if (diriter) |it| {
-                const maybe_entry = it.interface.next();
-                if (maybe_entry) |entry| {
-                    context.result.* = fill_dirent(entry, context.dirp);
-                } else {
-                    handle.remove_iterator();
-                }
-            }
-            return 0;
-        }
+    if (context.dirp == null) {
         return -1;
     }
-    return -1;
+    const process = process_manager.instance.get_current_process();
+    kernel.process.block_context_switch();
+    const maybe_handle = process.get_file_handle(@intCast(context.fd));
+    kernel.process.unblock_context_switch();
+    const handle = maybe_handle orelse return -1;
+    // still can fail if path not exists or is not a directory
+    const buffer: [*]u8 = @ptrCast(context.dirp);
+    const written = handle.read_dirents(buffer[0..@intCast(context.count)]) catch |err| {
+        if (err == kernel.errno.ErrnoSet.InvalidArgument) {
+            return err;
+        }
+        return 0;
+    };
+    if (written == 0) {
+        handle.remove_iterator();
+        return 0;
+    }
+    context.result.* = @intCast(written);
+    return 0;
 }
 
 pub fn sys_ioctl(arg: *const volatile anyopaque) !i32 {
@@ -430,8 +468,16 @@ pub fn sys_execve(arg: *const volatile anyopaque) !i32 {
 }
 
 pub fn sys_nanosleep(arg: *const volatile anyopaque) !i32 {
-    _ = arg;
-    return -1;
+    const context: *const volatile c.nanosleep_context = @ptrCast(@alignCast(arg));
+    if (context.req == null) {
+        return kernel.errno.ErrnoSet.InvalidArgument;
+    }
+    try time.sleep_timespec(context.req.*);
+    // sleep is never interrupted by signals, so nothing remains
+    if (context.rem != null) {
+        context.rem.* = std.mem.zeroes(c.timespec);
+    }
+    return 0;
 }
 pub fn sys_mmap(arg: *const volatile anyopaque) !i32 {
     kernel.process.block_context_switch();
@@ -472,30 +518,23 @@ pub fn sys_getcwd(arg: *const volatile anyopaque) !i32 {
 }
 
 pub fn sys_chdir(arg: *const volatile anyopaque) !i32 {
-    kernel.process.block_context_switch();
-    defer kernel.process.unblock_context_switch();
     const context: *const volatile c.chdir_context = @ptrCast(@alignCast(arg));
     const process = process_manager.instance.get_current_process();
-    var slice_allocated = false;
-    var path_slice: []const u8 = std.mem.span(@as([*:0]const u8, @ptrCast(context.path.?)));
-    if (path_slice[0] != '/') {
-        if (process.cwd[process.cwd.len - 1] == '/') {
-            path_slice = try std.fmt.allocPrint(kernel_allocator, "{s}{s}", .{ process.cwd, path_slice });
-            slice_allocated = true;
-        }
-    }
-    defer if (slice_allocated) kernel_allocator.free(path_slice);
-
-    const resolved_path = try std.fs.path.resolve(kernel_allocator, &.{ process.cwd, path_slice });
-    defer kernel_allocator.free(resolved_path);
-
-    if (resolved_path.len == 0) {
+    const path_slice: []const u8 = std.mem.span(@as([*:0]const u8, @ptrCast(context.path.?)));
+    if (path_slice.len == 0) {
         return kernel.errno.ErrnoSet.InvalidArgument;
     }
 
+    // change_directory copies path, so scratch buffer can be used
+    const scratch = try kernel.fs.ScratchPath.acquire(kernel_allocator);
+    defer scratch.release();
+    const resolved_path = try kernel.fs.resolve_path(scratch.buffer, &.{ process.cwd, path_slice });
+
     var node = try fs.get_ivfs().interface.get(resolved_path);
     defer node.delete();
     if (node.is_directory()) {
+        kernel.process.block_context_switch();
+        defer kernel.process.unblock_context_switch();
         try process.change_directory(resolved_path);
         return 0;
     }
@@ -509,10 +548,8 @@ pub fn sys_time(arg: *const volatile anyopaque) !i32 {
     return 0;
 }
 pub fn sys_fcntl(arg: *const volatile anyopaque) !i32 {
-    kernel.process.block_context_switch();
-    defer kernel.process.unblock_context_switch();
     const context: *const volatile c.fcntl_context = @ptrCast(@alignCast(arg));
-    var file = try get_file_from_process(@intCast(context.fd));
+    var file = try get_file_from_process_blocked(@intCast(context.fd));
     return file.interface.fcntl(context.op, @ptrFromInt(@as(usize, @intCast(context.arg))));
 }
 pub fn sys_remove(arg: *const volatile anyopaque) !i32 {
@@ -558,6 +595,232 @@ pub fn sys_dlsym(arg: *const volatile anyopaque) !i32 {
     return -1;
 }
 
+// issued by yasld trampoline on the first call through lazily bound function pointer, arg is the binding record
+pub fn sys_lazy_bind(arg: *const volatile anyopaque) !i32 {
+    const started = kernel.benchmark.start();
+    defer kernel.benchmark.stop(.lazy_bind, started);
+    const process = process_manager.instance.get_current_process();
+    try dynamic_loader.bind_lazy_symbol(process.pid, @intFromPtr(arg));
+    return 0;
+}
+
+const PipeContext = extern struct {
+    fds: ?*[2]c_int,
+};
+
+const Pipe2Context = extern struct {
+    fds: ?*[2]c_int,
+    flags: c_int,
+};
+
+// O_CLOEXEC is rejected, file descriptors have no close on exec flag and are always inherited
+const pipe_flags: c_int = c.O_NONBLOCK;
+
+fn create_pipe(fds: *[2]c_int, flags: c_int) !i32 {
+    if ((flags & ~pipe_flags) != 0) {
+        return kernel.errno.ErrnoSet.InvalidArgument;
+    }
+    kernel.process.block_context_switch();
+    defer kernel.process.unblock_context_switch();
+    const process = process_manager.instance.get_current_process();
+    var ends = try kernel.fs.create_pipe(kernel_allocator, (flags & c.O_NONBLOCK) != 0);
+    const reader = process.attach_file("pipe", ends.reader) catch |err| {
+        ends.writer.delete();
+        return err;
+    };
+    errdefer process.release_file(reader);
+    const writer = try process.attach_file("pipe", ends.writer);
+    fds[0] = reader;
+    fds[1] = writer;
+    return 0;
+}
+
+pub fn sys_pipe(arg: *const volatile anyopaque) !i32 {
+    const context: *const volatile PipeContext = @ptrCast(@alignCast(arg));
+    const fds = context.fds orelse return kernel.errno.ErrnoSet.BadAddress;
+    return try create_pipe(fds, 0);
+}
+
+pub fn sys_pipe2(arg: *const volatile anyopaque) !i32 {
+    const context: *const volatile Pipe2Context = @ptrCast(@alignCast(arg));
+    const fds = context.fds orelse return kernel.errno.ErrnoSet.BadAddress;
+    return try create_pipe(fds, context.flags);
+}
+
+// arguments are the same as for mkdirat
+pub fn sys_mkfifo(arg: *const volatile anyopaque) !i32 {
+    const context: *const volatile c.mkdir_context = @ptrCast(@alignCast(arg));
+    const scratch = try kernel.fs.ScratchPath.acquire(kernel_allocator);
+    defer scratch.release();
+    const path = try determine_path_for_file(scratch, context.path, context.fd);
+    const permissions: i32 = @as(i32, @intCast(context.mode)) & ~@as(i32, c.S_IFMT);
+    try fs.get_ivfs().interface.create(path, permissions | c.S_IFIFO);
+    return 0;
+}
+
+const PollEntry = kernel.fs.poll.PollEntry;
+
+const PollContext = extern struct {
+    fds: ?[*]kernel.fs.poll.PollFd,
+    nfds: c_ulong,
+    timeout: c_int,
+};
+
+// fd sets are bit arrays of c_ulong words as fd_set, timeval is converted to timespec by libc
+const SelectContext = extern struct {
+    nfds: c_int,
+    readfds: ?[*]c_ulong,
+    writefds: ?[*]c_ulong,
+    exceptfds: ?[*]c_ulong,
+    timeout: ?*const c.timespec,
+};
+
+const fd_set_word_bits = @bitSizeOf(c_ulong);
+
+fn fd_set_mask(fd: usize) c_ulong {
+    return @as(c_ulong, 1) << @as(std.math.Log2Int(c_ulong), @intCast(fd % fd_set_word_bits));
+}
+
+fn fd_set_contains(set: ?[*]c_ulong, fd: usize) bool {
+    const words = set orelse return false;
+    return (words[fd / fd_set_word_bits] & fd_set_mask(fd)) != 0;
+}
+
+// negative fd is ignored, descriptors that are not open are reported as invalid
+fn open_poll_entry(entry: *PollEntry, fd: c_int) void {
+    if (fd < 0) {
+        return;
+    }
+    const process = process_manager.instance.get_current_process();
+    const handle = process.get_file_handle(fd) orelse {
+        entry.invalid = true;
+        return;
+    };
+    // directories are not pollable
+    entry.file = handle.node.as_file();
+    entry.invalid = entry.file == null;
+}
+
+pub fn sys_poll(arg: *const volatile anyopaque) !i32 {
+    const context: *const volatile PollContext = @ptrCast(@alignCast(arg));
+    const count: usize = @intCast(context.nfds);
+    if (count != 0 and context.fds == null) {
+        return kernel.errno.ErrnoSet.BadAddress;
+    }
+    const fds = context.fds;
+    const entries = try kernel_allocator.alloc(PollEntry, count);
+    defer kernel_allocator.free(entries);
+
+    kernel.process.block_context_switch();
+    for (entries, 0..) |*entry, index| {
+        entry.* = .{ .request = .{ .events = fds.?[index].events } };
+        open_poll_entry(entry, fds.?[index].fd);
+    }
+    kernel.process.unblock_context_switch();
+
+    const timeout: ?u64 = if (context.timeout < 0) null else @intCast(context.timeout);
+    const ready = kernel.fs.poll.wait_for_events(entries, timeout);
+    for (entries, 0..) |*entry, index| {
+        fds.?[index].revents = entry.request.revents;
+    }
+    return @intCast(ready);
+}
+
+fn select_timeout_ms(maybe_timeout: ?*const c.timespec) !?u64 {
+    const timeout = maybe_timeout orelse return null;
+    if (timeout.tv_sec < 0 or timeout.tv_nsec < 0 or timeout.tv_nsec >= 1_000_000_000) {
+        return kernel.errno.ErrnoSet.InvalidArgument;
+    }
+    return @as(u64, @intCast(timeout.tv_sec)) * 1000 + std.math.divCeil(u64, @intCast(timeout.tv_nsec), 1_000_000) catch unreachable;
+}
+
+// select is served by poll, each descriptor from any set becomes single entry
+pub fn sys_select(arg: *const volatile anyopaque) !i32 {
+    const context: *const volatile SelectContext = @ptrCast(@alignCast(arg));
+    if (context.nfds < 0) {
+        return kernel.errno.ErrnoSet.InvalidArgument;
+    }
+    const count: usize = @intCast(context.nfds);
+    const timeout = try select_timeout_ms(context.timeout);
+    const entries = try kernel_allocator.alloc(PollEntry, count);
+    defer kernel_allocator.free(entries);
+
+    kernel.process.block_context_switch();
+    for (entries, 0..) |*entry, fd| {
+        var events: i16 = 0;
+        if (fd_set_contains(context.readfds, fd)) {
+            events |= kernel.fs.poll.POLLIN;
+        }
+        if (fd_set_contains(context.writefds, fd)) {
+            events |= kernel.fs.poll.POLLOUT;
+        }
+        if (fd_set_contains(context.exceptfds, fd)) {
+            events |= kernel.fs.poll.POLLPRI;
+        }
+        entry.* = .{ .request = .{ .events = events } };
+        if (events != 0) {
+            open_poll_entry(entry, @intCast(fd));
+        }
+        if (entry.invalid) {
+            kernel.process.unblock_context_switch();
+            return kernel.errno.ErrnoSet.BadFileDescriptor;
+        }
+    }
+    kernel.process.unblock_context_switch();
+
+    _ = kernel.fs.poll.wait_for_events(entries, timeout);
+    const words = std.math.divCeil(usize, count, fd_set_word_bits) catch unreachable;
+    for ([_]?[*]c_ulong{ context.readfds, context.writefds, context.exceptfds }) |maybe_set| {
+        if (maybe_set) |set| {
+            @memset(set[0..words], 0);
+        }
+    }
+    // end of stream and errors make descriptor readable or writable, so next call does not block
+    const results = [_]struct { set: ?[*]c_ulong, requested: i16, reported: i16 }{
+        .{ .set = context.readfds, .requested = kernel.fs.poll.POLLIN, .reported = kernel.fs.poll.POLLIN | kernel.fs.poll.POLLHUP | kernel.fs.poll.POLLERR },
+        .{ .set = context.writefds, .requested = kernel.fs.poll.POLLOUT, .reported = kernel.fs.poll.POLLOUT | kernel.fs.poll.POLLERR },
+        .{ .set = context.exceptfds, .requested = kernel.fs.poll.POLLPRI, .reported = kernel.fs.poll.POLLPRI },
+    };
+    var ready: i32 = 0;
+    for (entries, 0..) |*entry, fd| {
+        for (results) |result| {
+            const set = result.set orelse continue;
+            if ((entry.request.events & result.requested) != 0 and (entry.request.revents & result.reported) != 0) {
+                set[fd / fd_set_word_bits] |= fd_set_mask(fd);
+                ready += 1;
+            }
+        }
+    }
+    return ready;
+}
+
+fn priority_target(which: c_int, who: c_int) !i32 {
+    if (which != c.PRIO_PROCESS or who < 0) {
+        return kernel.errno.ErrnoSet.InvalidArgument;
+    }
+    if (who == 0) {
+        return process_manager.instance.get_current_process().pid;
+    }
+    return who;
+}
+
+pub fn sys_setpriority(arg: *const volatile anyopaque) !i32 {
+    const context: *const volatile c.setpriority_context = @ptrCast(@alignCast(arg));
+    const pid = try priority_target(context.which, context.who);
+    try process_manager.instance.set_priority(pid, context.prio);
+    return 0;
+}
+
+pub fn sys_getpriority(arg: *const volatile anyopaque) !i32 {
+    const context: *const volatile c.getpriority_context = @ptrCast(@alignCast(arg));
+    if (context.result == null) {
+        return kernel.errno.ErrnoSet.BadAddress;
+    }
+    const pid = try priority_target(context.which, context.who);
+    context.result.* = try process_manager.instance.get_priority(pid);
+    return 0;
+}
+
 pub fn sys_getuid(arg: *const volatile anyopaque) !i32 {
     _ = arg;
     // we are always root until we implement user management
@@ -573,18 +836,14 @@ pub fn sys_geteuid(arg: *const volatile anyopaque) !i32 {
 pub fn sys_dup(arg: *const volatile anyopaque) !i32 {
     const context: *const volatile c.dup_context = @ptrCast(@alignCast(arg));
     const process = process_manager.instance.get_current_process();
-    const maybe_handle = process.get_file_handle(@intCast(context.fd));
-    if (maybe_handle) |handle| {
-        var fd: i32 = 0;
-        if (context.newfd >= 0) {
-            fd = context.newfd;
-            _ = close_fd(fd);
-        } else {
-            fd = process.get_free_fd();
-        }
-        return try process.attach_file_with_fd(@intCast(fd), handle.path, handle.node.share());
+    if (process.get_file_handle(@intCast(context.fd)) == null) {
+        return -1;
     }
-    return -1;
+    // both descriptors refer to the same handle, newfd is closed if it was open
+    if (context.newfd >= 0) {
+        return try process.duplicate_file(@intCast(context.fd), context.newfd);
+    }
+    return try process.duplicate_file(@intCast(context.fd), null);
 }
 
 pub fn sys_sysinfo(arg: *const volatile anyopaque) !i32 {
@@ -614,11 +873,10 @@ pub fn sys_sysconf(arg: *const volatile anyopaque) !i32 {
 }
 
 pub fn sys_access(arg: *const volatile anyopaque) !i32 {
-    kernel.process.block_context_switch();
-    defer kernel.process.unblock_context_switch();
     const context: *const volatile c.access_context = @ptrCast(@alignCast(arg));
-    const path = try determine_path_for_file(kernel_allocator, context.pathname, context.dirfd);
-    defer kernel_allocator.free(path);
+    const scratch = try kernel.fs.ScratchPath.acquire(kernel_allocator);
+    defer scratch.release();
+    const path = try determine_path_for_file(scratch, context.pathname, context.dirfd);
     try fs.get_ivfs().interface.access(path, context.mode, context.flags);
     return 0;
 }
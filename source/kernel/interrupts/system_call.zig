@@ -43,6 +43,24 @@ comptime {
 
 extern fn store_and_switch_to_next_task(is_fpu_used: usize) void;
 
+// numbers outside of libc range are fixed in yasos/kernel_syscall.h
+comptime {
+    std.debug.assert(c.SYSCALL_KERNEL_BASE >= c.SYSCALL_COUNT);
+}
+
+// internal system call, trampoline in yasld reads number from exported symbol
+pub const sys_lazy_bind = c.sys_kernel_lazy_bind;
+export const yasld_lazy_binding_syscall: u32 = sys_lazy_bind;
+// system calls not yet numbered by libc
+pub const sys_pipe = c.sys_kernel_pipe;
+pub const sys_pipe2 = c.sys_kernel_pipe2;
+pub const sys_mkfifo = c.sys_kernel_mkfifo;
+pub const sys_poll = c.sys_kernel_poll;
+pub const sys_select = c.sys_kernel_select;
+pub const sys_setpriority = c.sys_kernel_setpriority;
+pub const sys_getpriority = c.sys_kernel_getpriority;
+const syscall_count = sys_getpriority + 1;
+
 const SyscallHandler = *const fn (arg: *const volatile anyopaque) anyerror!i32;
 
 var context_switch_enabled: bool = true;
@@ -70,6 +88,11 @@ pub fn unblock_context_switch() void {
     }
 }
 
+pub fn is_context_switch_blocked() bool {
+    const ptr: *const volatile bool = &context_switch_enabled;
+    return !ptr.*;
+}
+
 export fn do_context_switch(is_fpu_used: usize) linksection(".time_critical") usize {
     _ = is_fpu_used;
     const ptr: *volatile bool = &context_switch_enabled;
@@ -150,6 +173,14 @@ fn SyscallFactory(comptime index: usize) SyscallHandler {
             c.sys_sysinfo => return handlers.sys_sysinfo,
             c.sys_sysconf => return handlers.sys_sysconf,
             c.sys_access => return handlers.sys_access,
+            sys_lazy_bind => return handlers.sys_lazy_bind,
+            sys_pipe => return handlers.sys_pipe,
+            sys_pipe2 => return handlers.sys_pipe2,
+            sys_mkfifo => return handlers.sys_mkfifo,
+            sys_poll => return handlers.sys_poll,
+            sys_select => return handlers.sys_select,
+            sys_setpriority => return handlers.sys_setpriority,
+            sys_getpriority => return handlers.sys_getpriority,
             else => return sys_unhandled_factory(index).handler,
         }
     }
@@ -163,7 +194,7 @@ fn create_syscall_lookup_table(comptime count: usize) [count]SyscallHandler {
     return syscalls;
 }
 
-const syscall_lookup_table = create_syscall_lookup_table(c.SYSCALL_COUNT);
+const syscall_lookup_table = create_syscall_lookup_table(syscall_count);
 
 fn write_result(ptr: *volatile anyopaque, result_or_error: anyerror!i32) linksection(".time_critical") isize {
     const c_result: *volatile c.syscall_result = @ptrCast(@alignCast(ptr));
@@ -181,7 +212,7 @@ fn write_result(ptr: *volatile anyopaque, result_or_error: anyerror!i32) linksec
 pub export fn _irq_svcall(number: u32, arg: *const volatile anyopaque, out: *volatile anyopaque) linksection(".time_critical") callconv(.c) isize {
     process_manager.instance.get_current_process().processes_syscall = true;
     // log.err("System call processing started for: {d}", .{number});
-    if (number >= c.SYSCALL_COUNT) {
+    if (number >= syscall_lookup_table.len) {
         return write_result(out, kernel.errno.ErrnoSet.NotImplemented);
     }
     const result = write_result(out, syscall_lookup_table[number](arg));
@@ -243,6 +274,14 @@ test "SystemCall.VerifyLookupTable" {
     try std.testing.expectEqual(handlers.sys_sysinfo, syscall_lookup_table[c.sys_sysinfo]);
     try std.testing.expectEqual(handlers.sys_sysconf, syscall_lookup_table[c.sys_sysconf]);
     try std.testing.expectEqual(handlers.sys_access, syscall_lookup_table[c.sys_access]);
+    try std.testing.expectEqual(handlers.sys_lazy_bind, syscall_lookup_table[sys_lazy_bind]);
+    try std.testing.expectEqual(handlers.sys_pipe, syscall_lookup_table[sys_pipe]);
+    try std.testing.expectEqual(handlers.sys_pipe2, syscall_lookup_table[sys_pipe2]);
+    try std.testing.expectEqual(handlers.sys_mkfifo, syscall_lookup_table[sys_mkfifo]);
+    try std.testing.expectEqual(handlers.sys_poll, syscall_lookup_table[sys_poll]);
+    try std.testing.expectEqual(handlers.sys_select, syscall_lookup_table[sys_select]);
+    try std.testing.expectEqual(handlers.sys_setpriority, syscall_lookup_table[sys_setpriority]);
+    try std.testing.expectEqual(handlers.sys_getpriority, syscall_lookup_table[sys_getpriority]);
 }
 
 test "SystemCall.UnhandledSyscallReturnsError" {
@@ -283,7 +322,7 @@ test "SystemCall.ShouldErrorOnUnhandledSyscall" {
         .err = 0,
     };
     var arg: i32 = 0;
-    _ = _irq_svcall(c.SYSCALL_COUNT, &arg, &result_data);
+    _ = _irq_svcall(syscall_lookup_table.len, &arg, &result_data);
     try std.testing.expectEqual(-1, result_data.result);
     try std.testing.expectEqual(kernel.errno.to_errno(kernel.errno.ErrnoSet.NotImplemented), result_data.err);
 }
@@ -119,14 +119,7 @@ pub export fn _fcntl(fd: c_int, request: c_int, data: ?*anyopaque) c_int {
 }
 
 pub export fn _nanosleep(ts: c.timespec) c_int {
-    if (ts.tv_sec != 0) {
-        time.sleep_ms(@intCast(ts.tv_sec * 1000));
-    }
-
-    if (ts.tv_nsec != 0) {
-        time.sleep_us(@intCast(@divTrunc(ts.tv_nsec, 1000)));
-    }
-
+    time.sleep_timespec(ts) catch return -1;
     return 0;
 }
 
@@ -24,6 +24,7 @@ const hal = @import("hal");
 const arch = @import("arch");
 
 const process_manager = @import("../process_manager.zig");
+const timer = @import("../timer.zig");
 
 var tick_counter: u64 = 0;
 var last_time: u64 = 0;
@@ -34,7 +35,9 @@ pub export fn irq_systick() void {
 
     const tick_counter_ptr: *volatile u64 = &tick_counter;
     tick_counter_ptr.* += 1;
-    if (tick_counter_ptr.* - last_time >= 100) { //config.process.context_switch_period) {
+    // woken up processes are scheduled right away instead of waiting for end of time slice
+    const woken_up = timer.tick() != 0;
+    if (woken_up or tick_counter_ptr.* - last_time >= 100) { //config.process.context_switch_period) {
         hal.irq.trigger(.pendsv);
         last_time = tick_counter_ptr.*;
     }
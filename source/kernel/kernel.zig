@@ -32,13 +32,20 @@ pub const process = struct {
     pub const ProcFs = @import("process/procfs.zig").ProcFs;
     pub const block_context_switch = @import("interrupts/system_call.zig").block_context_switch;
     pub const unblock_context_switch = @import("interrupts/system_call.zig").unblock_context_switch;
+    pub const is_context_switch_blocked = @import("interrupts/system_call.zig").is_context_switch_blocked;
 };
 
 pub const sync = struct {
     pub const Mutex = @import("interrupts/kernel_mutex.zig").KernelMutex;
     pub const Semaphore = @import("semaphore.zig").Semaphore;
+    pub const Completion = @import("interrupts/kernel_completion.zig").Completion;
+    pub const IoLock = @import("interrupts/kernel_io_lock.zig").IoLock;
+    pub const WaitQueue = @import("interrupts/kernel_wait_queue.zig").WaitQueue;
+    pub const IrqLock = @import("interrupts/kernel_irq_lock.zig").IrqLock;
 };
 
+pub const timer = @import("timer.zig");
+
 pub const spawn = @import("spawn.zig");
 pub const fs = @import("fs/fs.zig");
 pub const dynamic_loader = @import("modules.zig");
@@ -18,5 +18,6 @@
 // CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
 
 pub const malloc = @import("malloc.zig");
+pub const SlabAllocator = @import("slab.zig").SlabAllocator;
 pub const ProcessPageAllocator = @import("process_page_allocator.zig").ProcessPageAllocator;
 pub const ProcessMemoryPool = @import("process_memory_pool.zig").ProcessMemoryPool;
@@ -22,14 +22,17 @@ const std = @import("std");
 
 const c = @import("c").c;
 
-const log = std.log.scoped(.malloc);
+const config = @import("config");
 
-const arch = @import("arch");
+const log = std.log.scoped(.malloc);
 
 var memory_in_use: isize = 0;
 var surpressed_memory: isize = 0;
 var counter: isize = 0;
 
+// malloc and realloc return blocks aligned for any fundamental type
+const malloc_alignment = std.mem.Alignment.of(std.c.max_align_t);
+
 pub fn get_usage() usize {
     return if (memory_in_use < 0) 0 else @intCast(memory_in_use);
 }
@@ -40,92 +43,214 @@ pub fn reset() void {
     counter = 0;
 }
 
-const Tracker = extern struct {
-    next: ?*Tracker,
-    prev: ?*Tracker,
+const max_stack_depth = 8;
+const tracker_capacity = config.instrumentation.allocation_tracker_size;
+
+comptime {
+    if (!std.math.isPowerOfTwo(tracker_capacity)) {
+        @compileError("CONFIG_INSTRUMENTATION_ALLOCATION_TRACKER_SIZE must be power of two");
+    }
+}
+
+const AllocationRecord = struct {
+    address: usize = Tracker.empty,
+    length: usize = 0,
     surpressed: bool = false,
-    data_len: usize,
-    data: [*]usize,
-    allocated_length: usize,
-
-    pub fn push(self: *Tracker, next: *Tracker) void {
-        var node: ?*Tracker = self;
-        while (node != null) {
-            if (node) |n| {
-                if (n.next == null) {
-                    n.next = next;
-                    next.prev = n;
-                    break;
-                }
-                node = n.next;
+    depth: usize = 0,
+    stack: [max_stack_depth]usize = [_]usize{0} ** max_stack_depth,
+
+    fn is_live(self: *const AllocationRecord) bool {
+        return self.address != Tracker.empty and self.address != Tracker.removed;
+    }
+
+    fn call_site(self: *const AllocationRecord) usize {
+        return if (self.depth > 0) self.stack[0] else 0;
+    }
+};
+
+// Live allocations are kept in open addressing table keyed by address with linear probing.
+// Records are preallocated, so tracking never allocates and lookups are O(1) on average.
+// Table is filled up to 3/4, so probe sequences stay short, further allocations are dropped.
+const Tracker = struct {
+    const empty: usize = 0;
+    // malloc results are aligned, so 1 is never a valid address
+    const removed: usize = 1;
+    const mask = tracker_capacity - 1;
+    const max_live = tracker_capacity / 4 * 3;
+
+    records: [tracker_capacity]AllocationRecord = [_]AllocationRecord{.{}} ** tracker_capacity,
+    live: usize = 0,
+    // allocations that didn't fit into table, they are not tracked
+    dropped: usize = 0,
+
+    fn slot(address: usize) usize {
+        const hash = (address >> 3) *% 0x9e3779b1;
+        return (hash ^ (hash >> 16)) & mask;
+    }
+
+    pub fn insert(self: *Tracker, address: usize, length: usize) ?*AllocationRecord {
+        if (self.live >= max_live) {
+            self.dropped += 1;
+            return null;
+        }
+        var index = slot(address);
+        for (0..tracker_capacity) |_| {
+            const record = &self.records[index];
+            if (!record.is_live()) {
+                record.* = .{ .address = address, .length = length };
+                self.live += 1;
+                return record;
+            }
+            index = (index + 1) & mask;
+        }
+        self.dropped += 1;
+        return null;
+    }
+
+    pub fn find(self: *Tracker, address: usize) ?*AllocationRecord {
+        var index = slot(address);
+        for (0..tracker_capacity) |_| {
+            const record = &self.records[index];
+            if (record.address == address) {
+                return record;
+            }
+            if (record.address == empty) {
+                return null;
             }
+            index = (index + 1) & mask;
+        }
+        return null;
+    }
+
+    fn release(self: *Tracker, record: *AllocationRecord) void {
+        record.address = removed;
+        self.live -= 1;
+        // tombstones followed by empty slot are not part of any probe sequence
+        var index = (@intFromPtr(record) - @intFromPtr(&self.records[0])) / @sizeOf(AllocationRecord);
+        if (self.records[(index + 1) & mask].address != empty) {
+            return;
+        }
+        for (0..tracker_capacity) |_| {
+            if (self.records[index].address != removed) {
+                break;
+            }
+            self.records[index].address = empty;
+            index = (index + mask) & mask;
         }
     }
 
     pub fn remove(self: *Tracker, ptr: *anyopaque, alloc_len: usize) void {
-        var node: ?*Tracker = self;
-        while (node != null) {
-            if (node) |n| {
-                node = n.next;
-                if (n.data_len > 0 and n.data[0] == @intFromPtr(ptr)) {
-                    if (n.prev) |p| {
-                        p.next = n.next;
-                    }
-                    if (n.next) |ne| {
-                        ne.prev = n.prev;
-                    }
-                    if (n.allocated_length != alloc_len) {
-                        log.err("Mismatched free size for pointer 0x{x}: allocated {d}B, freeing {d}B", .{ @intFromPtr(ptr), n.allocated_length, alloc_len });
-                    }
-                    c.free(n.data);
-                    c.free(n);
-                    return;
-                }
+        const record = self.find(@intFromPtr(ptr)) orelse {
+            // dropped allocations can't be validated
+            if (self.dropped == 0) {
+                log.err("Invalid free for: 0x{x}", .{@intFromPtr(ptr)});
             }
+            return;
+        };
+        if (record.length != alloc_len) {
+            log.err("Mismatched free size for pointer 0x{x}: allocated {d}B, freeing {d}B", .{ @intFromPtr(ptr), record.length, alloc_len });
+        }
+        self.release(record);
+    }
+
+    pub fn update(self: *Tracker, ptr: *anyopaque, new_ptr: *anyopaque, new_len: usize) void {
+        const record = self.find(@intFromPtr(ptr)) orelse {
+            if (self.dropped == 0) {
+                log.err("Invalid resize for: 0x{x}", .{@intFromPtr(ptr)});
+            }
+            return;
+        };
+        if (ptr == new_ptr) {
+            record.length = new_len;
+            return;
+        }
+        const previous = record.*;
+        self.release(record);
+        if (self.insert(@intFromPtr(new_ptr), new_len)) |moved| {
+            moved.surpressed = previous.surpressed;
+            moved.depth = previous.depth;
+            moved.stack = previous.stack;
         }
-        log.err("Invalid free for: 0x{x}", .{@intFromPtr(ptr)});
     }
 
     pub fn suppress_all(self: *Tracker) void {
-        var node: ?*Tracker = self;
-        while (node != null) {
-            if (node) |n| {
-                node = n.next;
-                n.surpressed = true;
+        for (&self.records) |*record| {
+            if (record.is_live()) {
+                record.surpressed = true;
             }
         }
     }
 
     pub fn print_leaks(self: *Tracker) void {
-        var node: ?*Tracker = self;
-        while (node != null) {
-            if (node) |n| {
-                if (n.data_len > 0 and !n.surpressed) {
-                    log.err("---------------------------------", .{});
-                    log.err("leaked memory allocated at: ", .{});
-                    var index: usize = 0;
-                    while (index < n.data_len) {
-                        log.err("{d}: 0x{x}", .{ index, n.data[index + 1] });
-                        index += 1;
-                    }
-                    log.err("--------------------------------", .{});
-                }
-                node = n.next;
+        for (&self.records) |*record| {
+            if (!record.is_live() or record.surpressed) {
+                continue;
+            }
+            log.err("---------------------------------", .{});
+            log.err("leaked {d}B at 0x{x} allocated at: ", .{ record.length, record.address });
+            for (record.stack[0..record.depth], 0..) |address, index| {
+                log.err("{d}: 0x{x}", .{ index, address });
             }
+            log.err("--------------------------------", .{});
+        }
+        if (self.dropped != 0) {
+            log.err("{d} allocations were not tracked, tracker is full", .{self.dropped});
         }
     }
 };
 
+var tracker: Tracker = .{};
+
+const CallSiteSummary = struct {
+    site: usize = 0,
+    count: usize = 0,
+    bytes: usize = 0,
+};
+
+// Writes live allocations grouped by call site, valid only when leak detection is enabled.
+// Call sites are grouped in small hash table, so dump takes single pass over tracker.
+pub fn dump_allocations(buffer: []u8) []const u8 {
+    const max_sites = 64;
+    var sites = [_]CallSiteSummary{.{}} ** max_sites;
+    var others = CallSiteSummary{};
+    for (&tracker.records) |*record| {
+        if (!record.is_live()) {
+            continue;
+        }
+        const site = record.call_site();
+        var index = Tracker.slot(site) & (max_sites - 1);
+        const summary = for (0..max_sites) |_| {
+            const entry = &sites[index];
+            if (entry.count == 0) {
+                entry.site = site;
+                break entry;
+            }
+            if (entry.site == site) {
+                break entry;
+            }
+            index = (index + 1) & (max_sites - 1);
+        } else &others;
+        summary.count += 1;
+        summary.bytes += record.length;
+    }
+
+    var written = (std.fmt.bufPrint(buffer, "Live: {d} Untracked: {d}\nCallSite   Count      Bytes\n", .{ tracker.live, tracker.dropped }) catch return buffer[0..0]).len;
+    for (sites) |summary| {
+        if (summary.count == 0) {
+            continue;
+        }
+        const line = std.fmt.bufPrint(buffer[written..], "0x{x:0>8} {d: >5} {d: >10}\n", .{ summary.site, summary.count, summary.bytes }) catch return buffer[0..written];
+        written += line.len;
+    }
+    if (others.count != 0) {
+        const line = std.fmt.bufPrint(buffer[written..], "Other      {d: >5} {d: >10}\n", .{ others.count, others.bytes }) catch return buffer[0..written];
+        written += line.len;
+    }
+    return buffer[0..written];
+}
+
 pub fn MallocAllocator(comptime options: anytype) type {
     return struct {
-        var tracker: Tracker = .{
-            .next = null,
-            .prev = null,
-            .data_len = 0,
-            .data = &.{},
-            .allocated_length = 0,
-        };
-
         pub const Self = @This();
         pub fn init() Self {
             return .{};
@@ -184,26 +309,20 @@ pub fn MallocAllocator(comptime options: anytype) type {
             counter += 1;
             if (comptime is_leaks_detection_enabled()) {
                 log.debug("allocating {d}B at 0x{x}", .{ len, @intFromPtr(ptr) });
-                const stack_trace_depth = arch.panic.get_stack_trace_depth(return_address);
-                const stack_trace_size = @sizeOf(usize) * (stack_trace_depth);
-                log.debug("allocating tracker object with size: {d}", .{@sizeOf(Tracker)});
-                const tracker_object = @as(*Tracker, @ptrCast(@alignCast(c.malloc(@sizeOf(Tracker)) orelse return null)));
-                tracker_object.next = null;
-                tracker_object.prev = null;
-                tracker_object.data_len = stack_trace_depth;
-                tracker_object.surpressed = false;
-                tracker_object.data = @as([*]usize, @ptrCast(@alignCast(c.malloc(@sizeOf(usize) * (stack_trace_size + 1)) orelse return null)));
-                tracker_object.data[0] = @intFromPtr(ptr);
-                tracker_object.allocated_length = len;
-                tracker.push(tracker_object);
-                var index: usize = 1;
-                var stack = std.debug.StackIterator.init(return_address, @frameAddress());
-                while (stack.next()) |ret| {
-                    if (@hasField(@TypeOf(options), "verbose") and options.verbose) {
-                        log.debug("{d}: 0x{x}", .{ index - 1, ret });
+                if (tracker.insert(@intFromPtr(ptr), len)) |record| {
+                    // call site is always recorded, even if stack can't be unwound
+                    record.stack[0] = return_address;
+                    record.depth = 1;
+                    var stack = std.debug.StackIterator.init(return_address, @frameAddress());
+                    _ = stack.next();
+                    while (record.depth < max_stack_depth) {
+                        const ret = stack.next() orelse break;
+                        if (@hasField(@TypeOf(options), "verbose") and options.verbose) {
+                            log.debug("{d}: 0x{x}", .{ record.depth, ret });
+                        }
+                        record.stack[record.depth] = ret;
+                        record.depth += 1;
                     }
-                    tracker_object.data[index] = ret;
-                    index += 1;
                 }
             }
             if (@hasField(@TypeOf(options), "dump_stats") and options.dump_stats) {
@@ -213,6 +332,7 @@ pub fn MallocAllocator(comptime options: anytype) type {
             return ptr;
         }
 
+        // shrinking keeps block in place, tail stays unused until free
         fn resize(
             ctx: *anyopaque,
             buf: []u8,
@@ -223,11 +343,15 @@ pub fn MallocAllocator(comptime options: anytype) type {
             _ = ctx;
             _ = return_address;
             _ = log2_buf_align;
-            _ = buf;
-            _ = new_len;
-            return false;
+            if (new_len > buf.len) {
+                return false;
+            }
+            update_allocation(buf, buf.ptr, new_len);
+            return true;
         }
 
+        // realloc may grow block in place or move it, copying is done by allocator,
+        // over-aligned blocks are moved by caller, because realloc could break alignment
         fn remap(
             context: *anyopaque,
             memory: []u8,
@@ -235,7 +359,22 @@ pub fn MallocAllocator(comptime options: anytype) type {
             new_len: usize,
             return_address: usize,
         ) ?[*]u8 {
-            return if (resize(context, memory, alignment, new_len, return_address)) memory.ptr else null;
+            if (resize(context, memory, alignment, new_len, return_address)) {
+                return memory.ptr;
+            }
+            if (alignment.compare(.gt, malloc_alignment)) {
+                return null;
+            }
+            const ptr = @as([*]u8, @ptrCast(c.realloc(memory.ptr, new_len) orelse return null));
+            update_allocation(memory, ptr, new_len);
+            return ptr;
+        }
+
+        fn update_allocation(memory: []u8, new_ptr: [*]u8, new_len: usize) void {
+            memory_in_use += @as(isize, @intCast(new_len)) - @as(isize, @intCast(memory.len));
+            if (comptime is_leaks_detection_enabled()) {
+                tracker.update(memory.ptr, new_ptr, new_len);
+            }
         }
 
         fn free(
@@ -513,3 +652,146 @@ test "MallocAllocator.ShouldShrinkAllocation" {
         try std.testing.expectEqual(@as(u8, 123), byte);
     }
 }
+
+test "MallocAllocator.ShouldShrinkInPlace" {
+    const initial_usage = @import("malloc.zig").get_usage();
+    var malloc_alloc = MallocAllocator(.{}).init();
+    defer malloc_alloc.deinit();
+
+    const allocator = malloc_alloc.allocator();
+
+    const ptr = try allocator.alloc(u8, 1000);
+    try std.testing.expect(allocator.resize(ptr, 100));
+    try std.testing.expectEqual(initial_usage + 100, @import("malloc.zig").get_usage());
+    try std.testing.expect(!allocator.resize(ptr[0..100], 2000));
+
+    allocator.free(ptr[0..100]);
+    try std.testing.expectEqual(initial_usage, @import("malloc.zig").get_usage());
+}
+
+test "MallocAllocator.ShouldGrowArrayListWithRemap" {
+    const initial_usage = @import("malloc.zig").get_usage();
+    var malloc_alloc = MallocAllocator(.{}).init();
+    defer malloc_alloc.deinit();
+
+    const allocator = malloc_alloc.allocator();
+
+    var list: std.ArrayList(u32) = .empty;
+    for (0..1000) |i| {
+        try list.append(allocator, @intCast(i));
+    }
+    try std.testing.expectEqual(initial_usage + list.capacity * @sizeOf(u32), @import("malloc.zig").get_usage());
+    for (list.items, 0..) |item, i| {
+        try std.testing.expectEqual(@as(u32, @intCast(i)), item);
+    }
+    list.deinit(allocator);
+    try std.testing.expectEqual(initial_usage, @import("malloc.zig").get_usage());
+}
+
+test "MallocAllocator.ShouldNotRemapOverAlignedAllocation" {
+    const initial_usage = @import("malloc.zig").get_usage();
+    var malloc_alloc = MallocAllocator(.{}).init();
+    defer malloc_alloc.deinit();
+
+    const allocator = malloc_alloc.allocator();
+    const alignment = std.mem.Alignment.fromByteUnits(malloc_alignment.toByteUnits() * 2);
+
+    const memory = allocator.rawAlloc(16, alignment, @returnAddress()) orelse return error.OutOfMemory;
+    try std.testing.expectEqual(null, allocator.rawRemap(memory[0..16], alignment, 4096, @returnAddress()));
+    // shrinking keeps block in place
+    try std.testing.expectEqual(memory, allocator.rawRemap(memory[0..16], alignment, 8, @returnAddress()).?);
+    allocator.rawFree(memory[0..8], alignment, @returnAddress());
+    try std.testing.expectEqual(initial_usage, @import("malloc.zig").get_usage());
+}
+
+test "MallocAllocator.ShouldGroupLiveAllocationsByCallSite" {
+    tracker = .{};
+    defer tracker = .{};
+    var malloc_alloc = MallocAllocator(.{ .leak_detection = true }).init();
+    const allocator = malloc_alloc.allocator();
+
+    var blocks: [3][]u8 = undefined;
+    for (&blocks) |*block| {
+        block.* = try allocator.alloc(u8, 64);
+    }
+    const other = try allocator.alloc(u8, 16);
+    try std.testing.expectEqual(@as(usize, 4), tracker.live);
+    try std.testing.expect(tracker.find(@intFromPtr(other.ptr)) != null);
+
+    var buffer: [256]u8 = undefined;
+    const dump = dump_allocations(&buffer);
+    try std.testing.expect(std.mem.startsWith(u8, dump, "Live: 4 Untracked: 0\n"));
+    try std.testing.expectEqual(@as(usize, 4), std.mem.count(u8, dump, "\n"));
+    try std.testing.expect(std.mem.indexOf(u8, dump, "     3        192\n") != null);
+    try std.testing.expect(std.mem.indexOf(u8, dump, "     1         16\n") != null);
+
+    for (blocks) |block| {
+        allocator.free(block);
+    }
+    allocator.free(other);
+    try std.testing.expectEqual(@as(usize, 0), tracker.live);
+    try std.testing.expectEqual(null, tracker.find(@intFromPtr(other.ptr)));
+}
+
+test "MallocAllocator.Tracker.ShouldInsertAndFindRecords" {
+    var sut: Tracker = .{};
+    const first = sut.insert(0x1000, 16).?;
+    _ = sut.insert(0x2000, 32).?;
+
+    try std.testing.expectEqual(2, sut.live);
+    try std.testing.expectEqual(first, sut.find(0x1000).?);
+    try std.testing.expectEqual(32, sut.find(0x2000).?.length);
+    try std.testing.expectEqual(null, sut.find(0x3000));
+}
+
+test "MallocAllocator.Tracker.ShouldReleaseRecord" {
+    var sut: Tracker = .{};
+    _ = sut.insert(0x1000, 16).?;
+    _ = sut.insert(0x2000, 32).?;
+
+    sut.remove(@ptrFromInt(0x1000), 16);
+    try std.testing.expectEqual(1, sut.live);
+    try std.testing.expectEqual(null, sut.find(0x1000));
+    try std.testing.expect(sut.find(0x2000) != null);
+}
+
+test "MallocAllocator.Tracker.ShouldCleanUpTombstonesAtEndOfProbeSequence" {
+    var sut: Tracker = .{};
+    // addresses with the same slot form single probe sequence
+    const base = Tracker.slot(0x1000);
+    var addresses: [3]usize = undefined;
+    var found: usize = 0;
+    var address: usize = 0x1000;
+    while (found < addresses.len) : (address += 8) {
+        if (Tracker.slot(address) == base) {
+            addresses[found] = address;
+            found += 1;
+        }
+    }
+    for (addresses) |a| {
+        _ = sut.insert(a, 8).?;
+    }
+
+    // removed record in the middle of sequence keeps it intact
+    sut.remove(@ptrFromInt(addresses[1]), 8);
+    try std.testing.expectEqual(Tracker.removed, sut.records[(base + 1) & Tracker.mask].address);
+    try std.testing.expect(sut.find(addresses[2]) != null);
+
+    // removing the last one clears all tombstones before it
+    sut.remove(@ptrFromInt(addresses[2]), 8);
+    try std.testing.expectEqual(Tracker.empty, sut.records[(base + 1) & Tracker.mask].address);
+    try std.testing.expectEqual(Tracker.empty, sut.records[(base + 2) & Tracker.mask].address);
+    try std.testing.expect(sut.find(addresses[0]) != null);
+}
+
+test "MallocAllocator.Tracker.ShouldDropAllocationsAboveLoadLimit" {
+    var sut: Tracker = .{};
+    for (0..Tracker.max_live) |i| {
+        try std.testing.expect(sut.insert(0x1000 + i * 8, 8) != null);
+    }
+    try std.testing.expectEqual(null, sut.insert(0x100000, 8));
+    try std.testing.expectEqual(1, sut.dropped);
+
+    sut.remove(@ptrFromInt(0x1000), 8);
+    try std.testing.expect(sut.insert(0x100000, 8) != null);
+}
@@ -23,8 +23,16 @@ const kernel = @import("../../kernel.zig");
 const log = std.log.scoped(.@"kernel/memory_pool");
 // Only one process is owner of memory chunk
 // shared memory will be implemented as seperate structure
+//
+// Pages are managed by binary buddy allocator. Free blocks are kept on per order
+// lists, list nodes are stored inside free pages, so metadata is only one byte per page.
+// Allocation takes smallest fitting block and splits it, unused tail is returned to the
+// pool immediately, so process owns exactly requested number of pages.
+// Freed blocks are merged with their buddies.
 pub const ProcessMemoryPool = struct {
     pub const page_size = 4096;
+    const max_order = 16;
+    const not_free: u8 = 0xff;
 
     const AccessType = packed struct {
         read: u1,
@@ -40,11 +48,21 @@ pub const ProcessMemoryPool = struct {
     };
     const ProcessMemoryList = std.DoublyLinkedList;
     const ProcessMemoryMap = std.AutoHashMap(c.pid_t, ProcessMemoryList);
+    // first page index to allocation, used to find entity on free
+    const AllocationMap = std.AutoHashMap(usize, *ProcessMemoryEntity);
+
+    const FreeBlock = struct {
+        node: std.DoublyLinkedList.Node,
+    };
 
     memory_size: usize,
     page_count: usize,
-    page_bitmap: std.DynamicBitSet,
+    used_pages: usize,
+    // order of free block starting at given page, not_free otherwise
+    free_order: []u8,
+    free_lists: [max_order + 1]std.DoublyLinkedList,
     memory_map: ProcessMemoryMap,
+    allocations: AllocationMap,
     // this allocator is used to keep track of the memory allocated for the process inside the kernel
     allocator: std.mem.Allocator,
     start_address: usize,
@@ -52,19 +70,27 @@ pub const ProcessMemoryPool = struct {
     pub fn init(allocator: std.mem.Allocator) !ProcessMemoryPool {
         log.debug("Process memory pool initialized", .{});
         const memory_layout = memory.get_memory_layout();
-        return ProcessMemoryPool{
+        const page_count = memory_layout[2].size / page_size;
+        const free_order = try allocator.alloc(u8, page_count);
+        @memset(free_order, not_free);
+        var pool = ProcessMemoryPool{
             .memory_size = memory_layout[2].size,
-            .page_count = memory_layout[2].size / page_size,
-            .page_bitmap = try std.DynamicBitSet.initEmpty(allocator, memory_layout[2].size / page_size),
+            .page_count = page_count,
+            .used_pages = 0,
+            .free_order = free_order,
+            .free_lists = [_]std.DoublyLinkedList{.{}} ** (max_order + 1),
             .memory_map = ProcessMemoryMap.init(allocator),
+            .allocations = AllocationMap.init(allocator),
             .allocator = allocator,
             .start_address = memory_layout[2].start_address,
         };
+        pool.free_range(0, page_count);
+        return pool;
     }
 
     pub fn deinit(self: *ProcessMemoryPool) void {
         log.debug("Process memory pool deinitialization started...", .{});
-        self.page_bitmap.deinit();
+        self.allocator.free(self.free_order);
         var it = self.memory_map.iterator();
         while (it.next()) |process| {
             var next = process.value_ptr.pop();
@@ -75,40 +101,91 @@ pub const ProcessMemoryPool = struct {
             }
         }
         self.memory_map.deinit();
+        self.allocations.deinit();
     }
 
-    fn get_next_free_slot(self: *ProcessMemoryPool, start_index: usize, pages_number: i32) !struct { usize, usize } {
-        var start = start_index;
-        var pages = pages_number - 1;
-        while (start < self.page_count) {
-            if (!self.page_bitmap.isSet(start)) {
-                break;
-            }
+    fn page_address(self: *const ProcessMemoryPool, index: usize) usize {
+        return self.start_address + index * page_size;
+    }
 
-            start += 1;
-        }
+    fn block_at(self: *const ProcessMemoryPool, index: usize) *FreeBlock {
+        return @ptrFromInt(self.page_address(index));
+    }
 
-        if (start >= self.page_count) {
-            return kernel.errno.ErrnoSet.OutOfMemory;
+    fn push_block(self: *ProcessMemoryPool, index: usize, order: u8) void {
+        const block = self.block_at(index);
+        block.* = .{ .node = .{} };
+        self.free_order[index] = order;
+        self.free_lists[order].prepend(&block.node);
+    }
+
+    fn remove_block(self: *ProcessMemoryPool, index: usize, order: u8) void {
+        self.free_lists[order].remove(&self.block_at(index).node);
+        self.free_order[index] = not_free;
+    }
+
+    fn pop_block(self: *ProcessMemoryPool, order: u8) ?usize {
+        const node = self.free_lists[order].popFirst() orelse return null;
+        const block: *FreeBlock = @fieldParentPtr("node", node);
+        const index = (@intFromPtr(block) - self.start_address) / page_size;
+        self.free_order[index] = not_free;
+        return index;
+    }
+
+    fn free_block(self: *ProcessMemoryPool, start_index: usize, start_order: u8) void {
+        var index = start_index;
+        var order = start_order;
+        while (order < max_order) {
+            const buddy = index ^ (@as(usize, 1) << @intCast(order));
+            if (buddy >= self.page_count or self.free_order[buddy] != order) {
+                break;
+            }
+            self.remove_block(buddy, order);
+            index = @min(index, buddy);
+            order += 1;
         }
+        self.push_block(index, order);
+    }
 
-        var end_index = start;
-        while (end_index < self.page_count and pages != 0) {
-            if (self.page_bitmap.isSet(end_index)) {
-                return .{ start, end_index - 1 };
+    // splits range into largest aligned blocks
+    fn free_range(self: *ProcessMemoryPool, start_index: usize, pages: usize) void {
+        var index = start_index;
+        var remaining = pages;
+        while (remaining > 0) {
+            var order: u8 = @intCast(@min(std.math.log2_int(usize, remaining), max_order));
+            if (index != 0) {
+                order = @min(order, @as(u8, @intCast(@ctz(index))));
             }
-            end_index += 1;
-            pages -= 1;
+            self.free_block(index, order);
+            index += @as(usize, 1) << @intCast(order);
+            remaining -= @as(usize, 1) << @intCast(order);
         }
+    }
 
-        if (end_index - start_index < @as(usize, @intCast(pages_number - 1))) {
-            return kernel.errno.ErrnoSet.OutOfMemory;
+    fn allocate_range(self: *ProcessMemoryPool, pages: usize) ?usize {
+        const order = std.math.log2_int_ceil(usize, pages);
+        if (order > max_order) {
+            return null;
         }
+        var block_order: u8 = @intCast(order);
+        const index = while (block_order <= max_order) : (block_order += 1) {
+            if (self.pop_block(block_order)) |found| {
+                break found;
+            }
+        } else return null;
 
-        if (end_index >= self.page_count or self.page_bitmap.isSet(end_index)) {
-            return .{ start, end_index - 1 };
+        while (block_order > order) {
+            block_order -= 1;
+            self.push_block(index + (@as(usize, 1) << @intCast(block_order)), block_order);
         }
-        return .{ start, end_index };
+        self.free_range(index + pages, (@as(usize, 1) << @intCast(order)) - pages);
+        self.used_pages += pages;
+        return index;
+    }
+
+    fn release_range(self: *ProcessMemoryPool, index: usize, pages: usize) void {
+        self.free_range(index, pages);
+        self.used_pages -= pages;
     }
 
     fn slicify(ptr: [*]u8, len: usize) []u8 {
@@ -119,64 +196,45 @@ pub const ProcessMemoryPool = struct {
         if (number_of_pages <= 0) {
             return null;
         }
-        var start_index: usize = 0;
-        while (start_index < self.page_count) {
-            const slot_start, const slot_end = self.get_next_free_slot(start_index, number_of_pages) catch {
-                return null;
-            };
-            if (slot_end - slot_start >= number_of_pages - 1) {
-                start_index = slot_start;
-                const end_index: usize = slot_start + @as(usize, @intCast(number_of_pages));
-                for (slot_start..end_index) |i| {
-                    self.page_bitmap.set(i);
-                }
-                var list = self.memory_map.getOrPut(pid) catch {
-                    return null;
-                };
-                if (!list.found_existing) {
-                    list.value_ptr.* = .{};
-                }
-                const entity = self.allocator.create(ProcessMemoryEntity) catch return null;
-                entity.* = .{
-                    .address = slicify(
-                        @as([*]u8, @ptrFromInt(self.start_address + start_index * page_size)),
-                        @as(usize, @intCast(number_of_pages)) * page_size,
-                    ),
-                    .pid = pid,
-                    .access = .{ .read = 1, .write = 1, .execute = 1 },
-                    .node = .{},
-                };
-                list.value_ptr.append(&entity.node);
-                log.debug("Allocating {d} pages for {d} at 0x{x}", .{ number_of_pages, pid, @intFromPtr(entity.address.ptr) });
-                return entity.address;
-            } else {
-                start_index = slot_end + 1;
-            }
+        const pages: usize = @intCast(number_of_pages);
+        var list = self.memory_map.getOrPut(pid) catch {
+            return null;
+        };
+        if (!list.found_existing) {
+            list.value_ptr.* = .{};
         }
-        return null;
+        const entity = self.allocator.create(ProcessMemoryEntity) catch return null;
+        const start_index = self.allocate_range(pages) orelse {
+            self.allocator.destroy(entity);
+            return null;
+        };
+        entity.* = .{
+            .address = slicify(@as([*]u8, @ptrFromInt(self.page_address(start_index))), pages * page_size),
+            .pid = pid,
+            .access = .{ .read = 1, .write = 1, .execute = 1 },
+            .node = .{},
+        };
+        self.allocations.put(start_index, entity) catch {
+            self.release_range(start_index, pages);
+            self.allocator.destroy(entity);
+            return null;
+        };
+        list.value_ptr.append(&entity.node);
+        log.debug("Allocating {d} pages for {d} at 0x{x}", .{ number_of_pages, pid, @intFromPtr(entity.address.ptr) });
+        return entity.address;
     }
 
     pub fn release_pages_for(self: *ProcessMemoryPool, pid: c.pid_t) void {
         log.debug("Releasing pages for: {d}", .{pid});
-        const maybe_mapping = self.memory_map.getEntry(pid);
-        if (maybe_mapping) |*mapping| {
-            var next = mapping.value_ptr.first;
-            while (next) |entity_node| {
-                const entity: *const ProcessMemoryEntity = @fieldParentPtr("node", entity_node);
+        if (self.memory_map.getPtr(pid)) |list| {
+            var next_element = list.pop();
+            while (next_element) |node| {
+                const entity: *ProcessMemoryEntity = @fieldParentPtr("node", node);
                 const start_index = (@intFromPtr(entity.address.ptr) - self.start_address) / page_size;
-                const end_index = start_index + @as(usize, @intCast(entity.address.len)) / page_size;
-                for (start_index..end_index) |index| {
-                    self.page_bitmap.unset(index);
-                }
-                next = entity_node.next;
-            }
-            if (self.memory_map.getPtr(pid)) |*list| {
-                var next_element = list.*.pop();
-                while (next_element) |node| {
-                    const entity: *const ProcessMemoryEntity = @fieldParentPtr("node", node);
-                    self.allocator.destroy(entity);
-                    next_element = list.*.pop();
-                }
+                _ = self.allocations.remove(start_index);
+                self.release_range(start_index, entity.address.len / page_size);
+                self.allocator.destroy(entity);
+                next_element = list.pop();
             }
             _ = self.memory_map.remove(pid);
         }
@@ -185,32 +243,106 @@ pub const ProcessMemoryPool = struct {
     pub fn free_pages(self: *ProcessMemoryPool, address: *anyopaque, number_of_pages: i32, pid: c.pid_t) void {
         log.debug("Releasing pages {d} at 0x{x} for pid: {d}", .{ number_of_pages, @intFromPtr(address), pid });
         if (@intFromPtr(address) < self.start_address or
-            @intFromPtr(address) >= self.start_address + self.memory_size)
+            @intFromPtr(address) >= self.start_address + self.memory_size or
+            number_of_pages <= 0)
         {
             return;
         }
-        const maybe_mapping = self.memory_map.getEntry(pid);
-        if (maybe_mapping) |*mapping| {
-            var next = mapping.value_ptr.first;
-            while (next) |entity_node| {
-                const entity: *ProcessMemoryEntity = @fieldParentPtr("node", entity_node);
-                if (@as(*anyopaque, entity.address.ptr) == address) {
-                    _ = mapping.value_ptr.remove(entity_node);
-                    self.allocator.destroy(entity);
-                    break;
-                }
-                next = entity_node.next;
+        const start_index = (@intFromPtr(address) - self.start_address) / page_size;
+        const entity = self.allocations.get(start_index) orelse return;
+        if (entity.pid != pid) {
+            return;
+        }
+        const owned_pages = entity.address.len / page_size;
+        const pages = @min(@as(usize, @intCast(number_of_pages)), owned_pages);
+        _ = self.allocations.remove(start_index);
+        self.release_range(start_index, pages);
+        if (pages < owned_pages) {
+            // partial unmap from the front, rest stays owned by process
+            entity.address = entity.address[pages * page_size ..];
+            self.allocations.putAssumeCapacity(start_index + pages, entity);
+            return;
+        }
+        if (self.memory_map.getPtr(pid)) |list| {
+            list.remove(&entity.node);
+        }
+        self.allocator.destroy(entity);
+    }
+
+    // Grows allocation into following free pages or shrinks it by releasing tail pages.
+    // Allocation never moves, false is returned when pages behind it are taken.
+    pub fn resize_pages(self: *ProcessMemoryPool, address: *anyopaque, new_number_of_pages: i32, pid: c.pid_t) bool {
+        if (@intFromPtr(address) < self.start_address or
+            @intFromPtr(address) >= self.start_address + self.memory_size or
+            new_number_of_pages <= 0)
+        {
+            return false;
+        }
+        const start_index = (@intFromPtr(address) - self.start_address) / page_size;
+        const entity = self.allocations.get(start_index) orelse return false;
+        if (entity.pid != pid) {
+            return false;
+        }
+        const owned_pages = entity.address.len / page_size;
+        const pages: usize = @intCast(new_number_of_pages);
+        if (pages < owned_pages) {
+            self.release_range(start_index + pages, owned_pages - pages);
+        } else if (pages > owned_pages) {
+            if (!self.take_range(start_index + owned_pages, start_index + pages)) {
+                return false;
             }
-            const start_index = (@intFromPtr(address) - self.start_address) / page_size;
-            const end_index = start_index + @as(usize, @intCast(number_of_pages));
-            for (start_index..end_index) |index| {
-                self.page_bitmap.unset(index);
+            self.used_pages += pages - owned_pages;
+        }
+        entity.address = entity.address.ptr[0 .. pages * page_size];
+        return true;
+    }
+
+    // removes free pages [start_index, end_index) from free lists if all of them are free
+    fn take_range(self: *ProcessMemoryPool, start_index: usize, end_index: usize) bool {
+        if (end_index > self.page_count) {
+            return false;
+        }
+        // page before range is allocated, so each free block starts exactly at walked index
+        var index = start_index;
+        while (index < end_index) {
+            const order = self.free_order[index];
+            if (order == not_free) {
+                return false;
             }
+            index += @as(usize, 1) << @intCast(order);
         }
+
+        index = start_index;
+        while (index < end_index) {
+            const order = self.free_order[index];
+            const block_end = index + (@as(usize, 1) << @intCast(order));
+            self.remove_block(index, order);
+            if (block_end > end_index) {
+                self.free_range(end_index, block_end - end_index);
+            }
+            index = block_end;
+        }
+        return true;
     }
 
     pub fn get_used_size(self: ProcessMemoryPool) usize {
-        return self.page_bitmap.count() * page_size;
+        return self.used_pages * page_size;
+    }
+
+    pub fn get_free_size(self: ProcessMemoryPool) usize {
+        return (self.page_count - self.used_pages) * page_size;
+    }
+
+    // largest contiguous allocation that can succeed
+    pub fn get_largest_free_block(self: ProcessMemoryPool) usize {
+        var order: usize = max_order + 1;
+        while (order > 0) {
+            order -= 1;
+            if (self.free_lists[order].first != null) {
+                return (@as(usize, 1) << @intCast(order)) * page_size;
+            }
+        }
+        return 0;
     }
 };
 
@@ -459,3 +591,118 @@ test "ProcessMemoryPool.ShouldFreeNonExistentPagesSafely" {
     // Original allocation should still be tracked
     try std.testing.expectEqual(@as(usize, ProcessMemoryPool.page_size * 2), pool.get_used_size());
 }
+
+test "ProcessMemoryPool.ShouldReturnUnusedTailOfBlockToPool" {
+    var pool = try ProcessMemoryPool.init(std.testing.allocator);
+    defer pool.deinit();
+
+    const pid: c.pid_t = 1;
+    const pages1 = pool.allocate_pages(3, pid);
+    const pages2 = pool.allocate_pages(1, pid);
+
+    try std.testing.expect(pages1 != null);
+    try std.testing.expect(pages2 != null);
+    // fourth page of block taken for first allocation is reused
+    try std.testing.expectEqual(@intFromPtr(pages1.?.ptr) + 3 * ProcessMemoryPool.page_size, @intFromPtr(pages2.?.ptr));
+    try std.testing.expectEqual(@as(usize, ProcessMemoryPool.page_size * 4), pool.get_used_size());
+}
+
+test "ProcessMemoryPool.ShouldMergeBuddiesOnFree" {
+    var pool = try ProcessMemoryPool.init(std.testing.allocator);
+    defer pool.deinit();
+
+    const largest = pool.get_largest_free_block();
+    const pid: c.pid_t = 1;
+    const pages1 = pool.allocate_pages(1, pid);
+    const pages2 = pool.allocate_pages(1, pid);
+    try std.testing.expect(pages1 != null);
+    try std.testing.expect(pages2 != null);
+    try std.testing.expect(pool.get_largest_free_block() < largest);
+    try std.testing.expectEqual(pool.memory_size - 2 * ProcessMemoryPool.page_size, pool.get_free_size());
+
+    pool.free_pages(pages1.?.ptr, 1, pid);
+    pool.free_pages(pages2.?.ptr, 1, pid);
+    try std.testing.expectEqual(largest, pool.get_largest_free_block());
+    try std.testing.expectEqual(pool.memory_size, pool.get_free_size());
+}
+
+test "ProcessMemoryPool.ShouldKeepRestOfAllocationAfterPartialFree" {
+    var pool = try ProcessMemoryPool.init(std.testing.allocator);
+    defer pool.deinit();
+
+    const pid: c.pid_t = 1;
+    const pages = pool.allocate_pages(4, pid);
+    try std.testing.expect(pages != null);
+
+    pool.free_pages(pages.?.ptr, 1, pid);
+    try std.testing.expectEqual(@as(usize, ProcessMemoryPool.page_size * 3), pool.get_used_size());
+
+    pool.free_pages(pages.?[ProcessMemoryPool.page_size..].ptr, 3, pid);
+    try std.testing.expectEqual(@as(usize, 0), pool.get_used_size());
+}
+
+test "ProcessMemoryPool.ShouldNotFreePagesOfOtherProcess" {
+    var pool = try ProcessMemoryPool.init(std.testing.allocator);
+    defer pool.deinit();
+
+    const pages = pool.allocate_pages(2, 1);
+    try std.testing.expect(pages != null);
+
+    pool.free_pages(pages.?.ptr, 2, 2);
+    try std.testing.expectEqual(@as(usize, ProcessMemoryPool.page_size * 2), pool.get_used_size());
+}
+
+test "ProcessMemoryPool.ShouldGrowAllocationInPlace" {
+    var pool = try ProcessMemoryPool.init(std.testing.allocator);
+    defer pool.deinit();
+
+    const pid: c.pid_t = 1;
+    const pages = pool.allocate_pages(3, pid);
+    try std.testing.expect(pages != null);
+
+    try std.testing.expect(pool.resize_pages(pages.?.ptr, 7, pid));
+    try std.testing.expectEqual(@as(usize, ProcessMemoryPool.page_size * 7), pool.get_used_size());
+
+    // pages behind grown allocation are still available
+    const next = pool.allocate_pages(1, pid);
+    try std.testing.expect(next != null);
+    try std.testing.expectEqual(@intFromPtr(pages.?.ptr) + 7 * ProcessMemoryPool.page_size, @intFromPtr(next.?.ptr));
+
+    pool.free_pages(pages.?.ptr, 7, pid);
+    pool.free_pages(next.?.ptr, 1, pid);
+    try std.testing.expectEqual(@as(usize, 0), pool.get_used_size());
+    try std.testing.expectEqual(pool.memory_size, pool.get_free_size());
+}
+
+test "ProcessMemoryPool.ShouldNotGrowIntoAllocatedPages" {
+    var pool = try ProcessMemoryPool.init(std.testing.allocator);
+    defer pool.deinit();
+
+    const pid: c.pid_t = 1;
+    const pages1 = pool.allocate_pages(2, pid);
+    const pages2 = pool.allocate_pages(2, pid);
+    try std.testing.expect(pages1 != null);
+    try std.testing.expect(pages2 != null);
+
+    try std.testing.expect(!pool.resize_pages(pages1.?.ptr, 3, pid));
+    try std.testing.expectEqual(@as(usize, ProcessMemoryPool.page_size * 4), pool.get_used_size());
+}
+
+test "ProcessMemoryPool.ShouldShrinkAllocationInPlace" {
+    var pool = try ProcessMemoryPool.init(std.testing.allocator);
+    defer pool.deinit();
+
+    const pid: c.pid_t = 1;
+    const pages = pool.allocate_pages(8, pid);
+    try std.testing.expect(pages != null);
+
+    try std.testing.expect(pool.resize_pages(pages.?.ptr, 2, pid));
+    try std.testing.expectEqual(@as(usize, ProcessMemoryPool.page_size * 2), pool.get_used_size());
+
+    const tail = pool.allocate_pages(2, pid);
+    try std.testing.expect(tail != null);
+    try std.testing.expectEqual(@intFromPtr(pages.?.ptr) + 2 * ProcessMemoryPool.page_size, @intFromPtr(tail.?.ptr));
+
+    pool.release_pages_for(pid);
+    try std.testing.expectEqual(@as(usize, 0), pool.get_used_size());
+}
@@ -86,13 +86,14 @@ pub fn ProcessPageAllocator(comptime MemoryPoolType: anytype) type {
             new_len: usize,
             return_address: usize,
         ) bool {
-            _ = ctx;
-            _ = buf;
             _ = return_address;
             _ = log2_buf_align;
-            _ = new_len;
-
-            return false;
+            const self: *Self = @ptrCast(@alignCast(ctx));
+            const pages = calculate_number_of_pages(new_len);
+            if (pages == calculate_number_of_pages(buf.len)) {
+                return true;
+            }
+            return self._pool.resize_pages(buf.ptr, pages, self._pid);
         }
 
         fn remap(
@@ -137,7 +138,7 @@ test "ProcessPageAllocator.ShouldAllocateAndFreePages" {
     try std.testing.expect(mem1.ptr != mem2.ptr);
 }
 
-test "ProcessPageAllocator.ResizeAndRemapShouldFail" {
+test "ProcessPageAllocator.ShouldResizeInPlace" {
     const PagePool = @import("process_memory_pool.zig").ProcessMemoryPool;
     var pool = try PagePool.init(std.testing.allocator);
     defer pool.deinit();
@@ -148,18 +149,42 @@ test "ProcessPageAllocator.ResizeAndRemapShouldFail" {
 
     const alloc = allocator.allocator();
 
-    const mem1 = try alloc.alloc(u8, 8192);
+    var mem1 = try alloc.alloc(u8, 8192);
     try std.testing.expect(mem1.len == 8192);
-    const resized = alloc.resize(mem1, 1024);
-    try std.testing.expect(!resized);
-    try std.testing.expect(alloc.remap(mem1, 1024) == null);
+    try std.testing.expect(alloc.resize(mem1, 1024));
+    mem1 = mem1[0..1024];
+    try std.testing.expectEqual(@as(usize, 4096), pool.get_used_size());
 
-    alloc.free(mem1);
+    // tail page was released, so allocation can grow back
+    const remapped = alloc.remap(mem1, 3 * 4096);
+    try std.testing.expect(remapped != null);
+    try std.testing.expect(remapped.?.ptr == mem1.ptr);
+    try std.testing.expectEqual(@as(usize, 3 * 4096), pool.get_used_size());
+
+    alloc.free(remapped.?);
     const mem2 = try alloc.alloc(u8, 4096);
     try std.testing.expect(mem2.len == 4096);
     try std.testing.expect(mem1.ptr == mem2.ptr);
 }
 
+test "ProcessPageAllocator.RemapShouldFailWhenNextPageIsTaken" {
+    const PagePool = @import("process_memory_pool.zig").ProcessMemoryPool;
+    var pool = try PagePool.init(std.testing.allocator);
+    defer pool.deinit();
+
+    const allocator_type = ProcessPageAllocator(PagePool);
+    var allocator = allocator_type.init(42, &pool);
+    defer allocator.deinit();
+
+    const alloc = allocator.allocator();
+
+    const mem1 = try alloc.alloc(u8, 4096);
+    const mem2 = try alloc.alloc(u8, 4096);
+    try std.testing.expect(alloc.remap(mem1, 8192) == null);
+    try std.testing.expect(alloc.resize(mem1, 100));
+    alloc.free(mem2);
+}
+
 test "ProcessPageAllocator.AllocateAndReleasePages" {
     const PagePool = @import("process_memory_pool.zig").ProcessMemoryPool;
     var pool = try PagePool.init(std.testing.allocator);
@@ -0,0 +1,284 @@
+// Copyright (c) 2025 Mateusz Stadnik
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program. If not, see <https://www.gnu.org/licenses/>.
+
+const std = @import("std");
+
+const arch = @import("arch");
+
+const log = std.log.scoped(.slab);
+
+pub const CacheStatistics = struct {
+    object_size: usize,
+    slabs: usize = 0,
+    objects_in_use: usize = 0,
+    free_objects: usize = 0,
+    allocations: usize = 0,
+};
+
+// Allocator for small kernel objects. Each size class has own cache built from slabs
+// taken from backing allocator. Freed objects are kept on free list of the cache,
+// so allocation and release are O(1) and memory is reused by objects of the same size.
+// Bigger requests or requests with stronger alignment are forwarded to backing allocator.
+// Slabs are returned to backing allocator on deinit.
+pub const SlabAllocator = struct {
+    const Self = @This();
+
+    pub const size_classes = [_]usize{ 16, 32, 48, 64, 96, 128, 192, 256, 384, 512 };
+    const object_alignment: std.mem.Alignment = .@"8";
+
+    const FreeObject = struct {
+        next: ?*FreeObject,
+    };
+
+    const Slab = struct {
+        next: ?*Slab,
+    };
+
+    const slab_header_size = std.mem.alignForward(usize, @sizeOf(Slab), object_alignment.toByteUnits());
+
+    const Cache = struct {
+        free_list: ?*FreeObject = null,
+        slabs: ?*Slab = null,
+        statistics: CacheStatistics,
+    };
+
+    _backing: std.mem.Allocator,
+    _caches: [size_classes.len]Cache,
+
+    pub fn init(backing: std.mem.Allocator) Self {
+        var caches: [size_classes.len]Cache = undefined;
+        for (&caches, size_classes) |*cache, size| {
+            cache.* = .{ .statistics = .{ .object_size = size } };
+        }
+        return .{
+            ._backing = backing,
+            ._caches = caches,
+        };
+    }
+
+    pub fn deinit(self: *Self) void {
+        for (&self._caches) |*cache| {
+            if (cache.statistics.objects_in_use != 0) {
+                log.err("{d} objects of size {d}B still in use", .{ cache.statistics.objects_in_use, cache.statistics.object_size });
+            }
+            const object_size = cache.statistics.object_size;
+            const bytes = slab_bytes(object_size);
+            var it = cache.slabs;
+            while (it) |slab| {
+                it = slab.next;
+                self._backing.rawFree(@as([*]u8, @ptrCast(slab))[0..bytes], object_alignment, @returnAddress());
+            }
+            cache.* = .{ .statistics = .{ .object_size = object_size } };
+        }
+    }
+
+    pub fn allocator(self: *Self) std.mem.Allocator {
+        return .{
+            .ptr = self,
+            .vtable = &.{
+                .alloc = alloc,
+                .resize = resize,
+                .remap = remap,
+                .free = free,
+            },
+        };
+    }
+
+    pub fn get_statistics(self: *const Self, cache_index: usize) CacheStatistics {
+        return self._caches[cache_index].statistics;
+    }
+
+    fn objects_per_slab(object_size: usize) usize {
+        return @max(1024 / object_size, 4);
+    }
+
+    fn slab_bytes(object_size: usize) usize {
+        return slab_header_size + object_size * objects_per_slab(object_size);
+    }
+
+    fn cache_index(len: usize, alignment: std.mem.Alignment) ?usize {
+        if (alignment.compare(.gt, object_alignment)) {
+            return null;
+        }
+        for (size_classes, 0..) |size, index| {
+            if (len <= size) {
+                return index;
+            }
+        }
+        return null;
+    }
+
+    fn grow(self: *Self, cache: *Cache) bool {
+        const object_size = cache.statistics.object_size;
+        const memory = self._backing.rawAlloc(slab_bytes(object_size), object_alignment, @returnAddress()) orelse return false;
+        const slab: *Slab = @ptrCast(@alignCast(memory));
+        slab.next = cache.slabs;
+        cache.slabs = slab;
+
+        const objects = objects_per_slab(object_size);
+        for (0..objects) |i| {
+            const object: *FreeObject = @ptrCast(@alignCast(memory + slab_header_size + i * object_size));
+            object.next = cache.free_list;
+            cache.free_list = object;
+        }
+        cache.statistics.slabs += 1;
+        cache.statistics.free_objects += objects;
+        return true;
+    }
+
+    fn alloc(ctx: *anyopaque, len: usize, alignment: std.mem.Alignment, return_address: usize) ?[*]u8 {
+        const self: *Self = @ptrCast(@alignCast(ctx));
+        const index = cache_index(len, alignment) orelse return self._backing.rawAlloc(len, alignment, return_address);
+        const cache = &self._caches[index];
+
+        const state = arch.sync.save_and_disable_interrupts();
+        defer arch.sync.restore_interrupts(state);
+        if (cache.free_list == null and !self.grow(cache)) {
+            return null;
+        }
+        const object = cache.free_list.?;
+        cache.free_list = object.next;
+        cache.statistics.free_objects -= 1;
+        cache.statistics.objects_in_use += 1;
+        cache.statistics.allocations += 1;
+        return @ptrCast(object);
+    }
+
+    // object can change size only inside its size class
+    fn resize(ctx: *anyopaque, buf: []u8, alignment: std.mem.Alignment, new_len: usize, return_address: usize) bool {
+        const self: *Self = @ptrCast(@alignCast(ctx));
+        const old_index = cache_index(buf.len, alignment);
+        const new_index = cache_index(new_len, alignment);
+        if (old_index == null and new_index == null) {
+            return self._backing.rawResize(buf, alignment, new_len, return_address);
+        }
+        if (old_index == null or new_index == null) {
+            return false;
+        }
+        return old_index.? == new_index.?;
+    }
+
+    fn remap(ctx: *anyopaque, buf: []u8, alignment: std.mem.Alignment, new_len: usize, return_address: usize) ?[*]u8 {
+        const self: *Self = @ptrCast(@alignCast(ctx));
+        if (cache_index(buf.len, alignment) == null and cache_index(new_len, alignment) == null) {
+            return self._backing.rawRemap(buf, alignment, new_len, return_address);
+        }
+        return if (resize(ctx, buf, alignment, new_len, return_address)) buf.ptr else null;
+    }
+
+    fn free(ctx: *anyopaque, buf: []u8, alignment: std.mem.Alignment, return_address: usize) void {
+        const self: *Self = @ptrCast(@alignCast(ctx));
+        const index = cache_index(buf.len, alignment) orelse return self._backing.rawFree(buf, alignment, return_address);
+        const cache = &self._caches[index];
+
+        const state = arch.sync.save_and_disable_interrupts();
+        defer arch.sync.restore_interrupts(state);
+        const object: *FreeObject = @ptrCast(@alignCast(buf.ptr));
+        object.next = cache.free_list;
+        cache.free_list = object;
+        cache.statistics.free_objects += 1;
+        cache.statistics.objects_in_use -= 1;
+    }
+};
+
+test "SlabAllocator.ShouldServeSmallObjectsFromSizeClass" {
+    var sut = SlabAllocator.init(std.testing.allocator);
+    defer sut.deinit();
+    const allocator = sut.allocator();
+
+    const a = try allocator.alloc(u8, 20);
+    const b = try allocator.alloc(u8, 32);
+    try std.testing.expect(a.ptr != b.ptr);
+
+    const stats = sut.get_statistics(1);
+    try std.testing.expectEqual(@as(usize, 32), stats.object_size);
+    try std.testing.expectEqual(@as(usize, 1), stats.slabs);
+    try std.testing.expectEqual(@as(usize, 2), stats.objects_in_use);
+    try std.testing.expectEqual(@as(usize, 2), stats.allocations);
+
+    allocator.free(a);
+    allocator.free(b);
+    try std.testing.expectEqual(@as(usize, 0), sut.get_statistics(1).objects_in_use);
+}
+
+test "SlabAllocator.ShouldReuseFreedObject" {
+    var sut = SlabAllocator.init(std.testing.allocator);
+    defer sut.deinit();
+    const allocator = sut.allocator();
+
+    const Object = struct {
+        value: u64,
+        next: ?*anyopaque,
+    };
+
+    const first = try allocator.create(Object);
+    allocator.destroy(first);
+    const second = try allocator.create(Object);
+    defer allocator.destroy(second);
+
+    try std.testing.expectEqual(first, second);
+    try std.testing.expectEqual(@as(usize, 1), sut.get_statistics(0).slabs);
+}
+
+test "SlabAllocator.ShouldAddSlabWhenCacheIsExhausted" {
+    var sut = SlabAllocator.init(std.testing.allocator);
+    defer sut.deinit();
+    const allocator = sut.allocator();
+
+    var objects: [5][]u8 = undefined;
+    for (&objects) |*object| {
+        object.* = try allocator.alloc(u8, 512);
+    }
+    const index = SlabAllocator.size_classes.len - 1;
+    try std.testing.expectEqual(@as(usize, 2), sut.get_statistics(index).slabs);
+    try std.testing.expectEqual(@as(usize, 3), sut.get_statistics(index).free_objects);
+
+    for (objects) |object| {
+        allocator.free(object);
+    }
+    try std.testing.expectEqual(@as(usize, 8), sut.get_statistics(index).free_objects);
+}
+
+test "SlabAllocator.ShouldForwardLargeAllocationsToBackingAllocator" {
+    var sut = SlabAllocator.init(std.testing.allocator);
+    defer sut.deinit();
+    const allocator = sut.allocator();
+
+    var large = try allocator.alloc(u8, 4096);
+    large = try allocator.realloc(large, 8192);
+    defer allocator.free(large);
+    try std.testing.expectEqual(@as(usize, 8192), large.len);
+
+    for (SlabAllocator.size_classes, 0..) |_, index| {
+        try std.testing.expectEqual(@as(usize, 0), sut.get_statistics(index).slabs);
+    }
+}
+
+test "SlabAllocator.ShouldResizeOnlyInsideSizeClass" {
+    var sut = SlabAllocator.init(std.testing.allocator);
+    defer sut.deinit();
+    const allocator = sut.allocator();
+
+    var list: std.ArrayList(u8) = .empty;
+    defer list.deinit(allocator);
+    try list.appendSlice(allocator, "path/to/file");
+    try list.appendSlice(allocator, "/and/a/much/longer/path/that/does/not/fit/into/first/class");
+    try std.testing.expectEqualStrings("path/to/file/and/a/much/longer/path/that/does/not/fit/into/first/class", list.items);
+
+    const small = try allocator.alloc(u8, 17);
+    defer allocator.free(small.ptr[0..20]);
+    try std.testing.expect(allocator.resize(small, 20));
+    try std.testing.expect(!allocator.resize(small.ptr[0..20], 40));
+}
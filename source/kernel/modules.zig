@@ -20,6 +20,8 @@ const std = @import("std");
 
 const yasld = @import("yasld");
 
+const config = @import("config");
+
 const IFile = @import("fs/fs.zig").IFile;
 const fs = @import("fs/vfs.zig");
 const FileMemoryMapAttributes = @import("fs/ifile.zig").FileMemoryMapAttributes;
@@ -29,63 +31,154 @@ const c = @import("libc_imports").c;
 
 var kernel_allocator: std.mem.Allocator = undefined;
 
-const ModuleContext = struct {
-    name: []const u8,
-    address: ?*const anyopaque,
-};
-
 const kernel = @import("kernel.zig");
 
 const log = std.log.scoped(.loader);
 
-fn file_resolver(name: []const u8) ?*const anyopaque {
-    var context: ModuleContext = .{
-        .name = name,
-        .address = null,
-    };
+// Maps library names to memory mapped addresses, it is filled once from all search paths.
+// Index is rebuilt when filesystem is mounted or unmounted and when anything under
+// search path is created, removed or opened for writing.
+// Library found in earlier search path shadows the same name from following ones, like LD_LIBRARY_PATH.
+const LibraryIndex = struct {
+    entries: std.StringHashMap(*const anyopaque),
+    // VFS generation for which index is complete
+    generation: ?usize,
+
+    fn init(allocator: std.mem.Allocator) LibraryIndex {
+        return .{
+            .entries = std.StringHashMap(*const anyopaque).init(allocator),
+            .generation = null,
+        };
+    }
 
-    var maybe_node = fs.get_ivfs().interface.get("/lib") catch null;
-    if (maybe_node) |*node| {
+    fn deinit(self: *LibraryIndex) void {
+        self.clear();
+        self.entries.deinit();
+    }
+
+    fn clear(self: *LibraryIndex) void {
+        var it = self.entries.keyIterator();
+        while (it.next()) |key| {
+            self.entries.allocator.free(key.*);
+        }
+        self.entries.clearRetainingCapacity();
+        self.generation = null;
+        // libraries may be found at different addresses now
+        invalidate_relocation_cache();
+    }
+
+    fn find(self: *LibraryIndex, name: []const u8) ?*const anyopaque {
+        const generation = fs.get_vfs().generation;
+        if (self.generation != generation) {
+            self.rebuild(generation);
+        }
+        return self.entries.get(name);
+    }
+
+    fn rebuild(self: *LibraryIndex, generation: usize) void {
+        self.clear();
+        var complete = true;
+        var paths = std.mem.tokenizeScalar(u8, config.yasld.library_path, ':');
+        while (paths.next()) |path| {
+            self.add_directory(path) catch |err| {
+                complete = false;
+                if (err != kernel.errno.ErrnoSet.NoEntry) {
+                    log.err("can't index libraries in '{s}': {s}", .{ path, @errorName(err) });
+                }
+            };
+        }
+        // incomplete index is still used, but directories are scanned again on next lookup
+        if (complete) {
+            self.generation = generation;
+        }
+    }
+
+    fn add_directory(self: *LibraryIndex, path: []const u8) !void {
+        // missing directory is indexed as empty, creating it invalidates index
+        var node = fs.get_ivfs().interface.get(path) catch |err| {
+            if (err == kernel.errno.ErrnoSet.NoEntry) {
+                return;
+            }
+            return err;
+        };
         defer node.delete();
         var maybe_dir = node.as_directory();
         if (maybe_dir) |*dir| {
-            var it = dir.interface.iterator() catch return null;
+            var it = try dir.interface.iterator();
             defer it.interface.delete();
             while (it.interface.next()) |*entry| {
                 var filenode: kernel.fs.Node = undefined;
                 dir.interface.get(entry.name, &filenode) catch continue;
                 defer filenode.delete();
                 if (filenode.as_file()) |f| {
-                    if (is_requested_file(f, &context)) {
-                        break;
-                    }
+                    try self.add_file(f);
                 }
             }
         }
     }
 
-    if (context.address) |address| {
-        return address;
-    }
-    return null;
-}
-
-fn is_requested_file(file: kernel.fs.IFile, context: *ModuleContext) bool {
-    if (std.mem.eql(u8, context.name, file.interface.name())) {
+    fn add_file(self: *LibraryIndex, file: kernel.fs.IFile) !void {
+        var fc: kernel.fs.IFile = file;
+        const name = fc.interface.name();
+        if (self.entries.contains(name)) {
+            return;
+        }
         var attr: FileMemoryMapAttributes = .{
             .is_memory_mapped = false,
             .mapped_address_r = null,
             .mapped_address_w = null,
         };
-
-        var fc: kernel.fs.IFile = file;
         _ = fc.interface.ioctl(@intFromEnum(IoctlCommonCommands.GetMemoryMappingStatus), &attr);
         if (attr.mapped_address_r) |address| {
-            context.address = address;
-            return true;
+            const key = try self.entries.allocator.dupe(u8, name);
+            errdefer self.entries.allocator.free(key);
+            try self.entries.put(key, address);
+        }
+    }
+};
+
+var library_index: LibraryIndex = undefined;
+
+fn file_resolver(name: []const u8) ?*const anyopaque {
+    return library_index.find(name);
+}
+
+// creating, removing or opening library for writing may change its content or mapping
+pub fn invalidate_library_index_for(path: []const u8) void {
+    var paths = std.mem.tokenizeScalar(u8, config.yasld.library_path, ':');
+    while (paths.next()) |search_path| {
+        const directory = std.mem.trimRight(u8, search_path, "/");
+        if (std.mem.startsWith(u8, path, directory) and (path.len == directory.len or path[directory.len] == '/')) {
+            library_index.clear();
+            return;
+        }
+    }
+}
+
+// images cached by loader can't be trusted after any library was modified
+fn invalidate_relocation_cache() void {
+    if (yasld.get_loader()) |loader| {
+        loader.invalidate_relocation_cache();
+    }
+}
+
+// opening file for writing may modify memory mapped image used by cached relocations
+pub fn invalidate_relocation_cache_for(file: IFile) void {
+    var fc: IFile = file;
+    var attr: FileMemoryMapAttributes = .{
+        .is_memory_mapped = false,
+        .mapped_address_r = null,
+        .mapped_address_w = null,
+    };
+    _ = fc.interface.ioctl(@intFromEnum(IoctlCommonCommands.GetMemoryMappingStatus), &attr);
+    if (attr.mapped_address_r) |address| {
+        if (yasld.get_loader()) |loader| {
+            // loader state is shared by all processes
+            kernel.process.block_context_switch();
+            defer kernel.process.unblock_context_switch();
+            loader.invalidate_relocation_cache_for_image(@intFromPtr(address));
         }
     }
-    return false;
 }
 
 const ExecutableHandle = struct {
@@ -100,8 +193,14 @@ var libraries_list: std.AutoHashMap(c.pid_t, std.DoublyLinkedList) = undefined;
 pub fn init(allocator: std.mem.Allocator) void {
     log.info("yasld initialization started", .{});
     yasld.loader_init(&file_resolver, allocator);
+    if (config.yasld.lazy_binding) {
+        if (yasld.get_loader()) |loader| {
+            loader.set_binding_mode(.lazy);
+        }
+    }
     modules_list = std.AutoHashMap(c.pid_t, ExecutableHandle).init(allocator);
     libraries_list = std.AutoHashMap(c.pid_t, std.DoublyLinkedList).init(allocator);
+    library_index = LibraryIndex.init(allocator);
     kernel_allocator = allocator;
 }
 
@@ -114,6 +213,7 @@ pub fn deinit() void {
     }
     modules_list.deinit();
     libraries_list.deinit();
+    library_index.deinit();
     yasld.loader_deinit();
 }
 
@@ -129,6 +229,7 @@ pub fn load_executable(path: []const u8, process_allocator: std.mem.Allocator, p
         };
         _ = f.interface.ioctl(@intFromEnum(IoctlCommonCommands.GetMemoryMappingStatus), &attr);
         var header_address: *const anyopaque = undefined;
+        var storage: yasld.Loader.ImageStorage = .mapped;
         var entry = ExecutableHandle{
             .allocator = process_allocator,
             .executable = null,
@@ -137,13 +238,18 @@ pub fn load_executable(path: []const u8, process_allocator: std.mem.Allocator, p
         if (attr.mapped_address_r) |address| {
             header_address = address;
         } else {
+            storage = .copied;
             var memory: []align(16) u8 = try process_allocator.alignedAlloc(u8, .@"16", @intCast(f.interface.size()));
             header_address = @ptrCast(&memory[0]);
             entry.memory = memory;
             _ = f.interface.read(memory);
         }
+        // image is read with context switching enabled, as filesystem may wait for other process,
+        // loader state is shared by all processes
+        kernel.process.block_context_switch();
+        defer kernel.process.unblock_context_switch();
         if (yasld.get_loader()) |loader| {
-            const executable = loader.*.load_executable(header_address, process_allocator) catch |err| {
+            const executable = loader.*.load_executable(header_address, process_allocator, storage) catch |err| {
                 log.err("loading '{s}' failed: {s}", .{ path, @errorName(err) });
                 return err;
             };
@@ -244,6 +350,25 @@ pub fn get_executable_for_pid(pid: c.pid_t) ?*yasld.Executable {
     return null;
 }
 
+// first call through lazily bound function pointer, record must belong to module loaded by the process
+pub fn bind_lazy_symbol(pid: c.pid_t, record: usize) !void {
+    if (get_executable_for_pid(pid)) |executable| {
+        if (try executable.module.bind_lazy_symbol(record)) {
+            return;
+        }
+    }
+    if (libraries_list.getPtr(pid)) |list| {
+        var it = list.first;
+        while (it) |node| : (it = node.next) {
+            const library: *yasld.Module = @fieldParentPtr("list_node", node);
+            if (try library.bind_lazy_symbol(record)) {
+                return;
+            }
+        }
+    }
+    return kernel.errno.ErrnoSet.InvalidArgument;
+}
+
 test "Modules.ShouldInitializeAndDeinitialize" {
     init(std.testing.allocator);
     defer deinit();
@@ -308,6 +433,8 @@ test "Modules.ShouldLoadExecutableFromFileSystem" {
     _ = try load_executable("/test_executable", std.testing.allocator, pid);
 
     try std.testing.expect(get_executable_for_pid(pid) != null);
+    // memory mapped image is loaded in place, so its relocations may be cached
+    try std.testing.expectEqual(yasld.Loader.ImageStorage.mapped, yasld.get_loader().?.loaded_storage.?);
     release_executable(pid);
 
     try std.testing.expect(get_executable_for_pid(pid) == null);
@@ -552,6 +679,10 @@ test "Modules.ResolverShouldReturnAddressIfFileFoundInDirectory" {
         .kind = .File,
     });
 
+    _ = itmock
+        .expectCall("next")
+        .willReturn(null);
+
     var file_mock = try create_filemock(std.testing.allocator);
     const filenode = kernel.fs.Node.create_file(file_mock.get_interface());
 
@@ -633,3 +764,108 @@ test "Modules.ResolverShouldReturnNullIfFileIsNotMemoryMapped" {
 
     try std.testing.expectEqual(null, file_resolver("libtest.so"));
 }
+
+test "Modules.ResolverShouldReuseLibraryIndexUntilInvalidated" {
+    var fs_mock = try create_vfs_for_test(std.testing.allocator);
+    defer fs.vfs_deinit();
+    init(std.testing.allocator);
+    defer deinit();
+
+    var dirmock = try DirectoryMock.create(std.testing.allocator);
+    const dirnode = kernel.fs.Node.create_directory(dirmock.get_interface());
+
+    _ = fs_mock
+        .expectCall("get")
+        .withArgs(.{"/lib"})
+        .willReturn(dirnode);
+
+    var itmock = try DirectoryIteratorMock.create(std.testing.allocator);
+
+    _ = dirmock
+        .expectCall("iterator")
+        .willReturn(itmock.get_interface());
+
+    _ = itmock
+        .expectCall("next")
+        .willReturn(.{
+        .name = "libtest.so",
+        .kind = .File,
+    });
+
+    _ = itmock
+        .expectCall("next")
+        .willReturn(null);
+
+    var file_mock = try create_filemock(std.testing.allocator);
+    const filenode = kernel.fs.Node.create_file(file_mock.get_interface());
+
+    _ = file_mock
+        .expectCall("name")
+        .willReturn("libtest.so");
+
+    const GetCallback = struct {
+        pub fn call(ctx: ?*const anyopaque, args: std.meta.Tuple(&[_]type{ []const u8, *kernel.fs.Node })) anyerror!anyerror!void {
+            const node = args[1];
+            node.* = @as(*const kernel.fs.Node, @ptrCast(@alignCast(ctx))).*;
+        }
+    };
+    _ = dirmock
+        .expectCall("get")
+        .withArgs(.{"libtest.so"})
+        .invoke(&GetCallback.call, &filenode);
+
+    // directory is scanned only once
+    try std.testing.expectEqual(@as(*const anyopaque, &test_mapped_address), file_resolver("libtest.so"));
+    try std.testing.expectEqual(@as(*const anyopaque, &test_mapped_address), file_resolver("libtest.so"));
+    try std.testing.expectEqual(null, file_resolver("libother.so"));
+
+    invalidate_library_index_for("/libraries/libtest.so");
+    try std.testing.expectEqual(@as(*const anyopaque, &test_mapped_address), file_resolver("libtest.so"));
+
+    invalidate_library_index_for("/lib/libtest.so");
+    _ = fs_mock
+        .expectCall("get")
+        .withArgs(.{"/lib"})
+        .willReturn(kernel.errno.ErrnoSet.NoEntry);
+    try std.testing.expectEqual(null, file_resolver("libtest.so"));
+    // missing directory is not scanned again until it is created
+    try std.testing.expectEqual(null, file_resolver("libtest.so"));
+}
+
+test "Modules.ShouldKeepRelocationCacheUntilLibraryChanges" {
+    var fs_mock = try create_vfs_for_test(std.testing.allocator);
+    defer fs.vfs_deinit();
+    init(std.testing.allocator);
+    defer deinit();
+    const loader = yasld.get_loader().?;
+
+    _ = fs_mock
+        .expectCall("get")
+        .withArgs(.{"/lib"})
+        .willReturn(kernel.errno.ErrnoSet.NoEntry);
+
+    try std.testing.expectEqual(null, file_resolver("libtest.so"));
+    const invalidations = loader.relocation_cache_invalidations;
+
+    // lookups through valid index and changes outside of search paths keep cached relocations
+    try std.testing.expectEqual(null, file_resolver("libother.so"));
+    invalidate_library_index_for("/home/data.txt");
+    invalidate_library_index_for("/libraries/libtest.so");
+    try std.testing.expectEqual(invalidations, loader.relocation_cache_invalidations);
+
+    invalidate_library_index_for("/lib/libtest.so");
+    try std.testing.expectEqual(invalidations + 1, loader.relocation_cache_invalidations);
+}
+
+test "Modules.ShouldInvalidateRelocationCacheForMappedImage" {
+    init(std.testing.allocator);
+    defer deinit();
+    const loader = yasld.get_loader().?;
+
+    var file_mock = try create_filemock(std.testing.allocator);
+    var file_node = kernel.fs.Node.create_file(file_mock.get_interface());
+    defer file_node.delete();
+
+    invalidate_relocation_cache_for(file_node.as_file().?);
+    try std.testing.expectEqual(@intFromPtr(&test_mapped_address), loader.invalidated_image.?);
+}
@@ -30,10 +30,13 @@ const log = std.log.scoped(.@"kernel/process");
 const arch_process = @import("arch").process;
 
 const Semaphore = @import("semaphore.zig").Semaphore;
+const FdTable = @import("fd_table.zig").FdTable;
 const IDirectoryIterator = @import("fs/idirectory.zig").IDirectoryIterator;
 const system_call = @import("interrupts/system_call.zig");
-const systick = @import("interrupts/systick.zig");
+const timer = @import("timer.zig");
 const arch = @import("arch");
+// ready list is filled from interrupts and drained by scheduler
+const ReadyListLock = @import("interrupts/kernel_irq_lock.zig").IrqLock;
 
 const hal = @import("hal");
 
@@ -61,6 +64,11 @@ pub fn ProcessInterface(comptime ProcessType: type, comptime ProcessMemoryPoolTy
             node: kernel.fs.Node,
             path: []u8,
             diriter: ?IDirectoryIterator,
+            // getdents cursor, d_off of last returned entry
+            dir_offset: usize = 0,
+            // entry taken from iterator that did not fit into previous getdents buffer
+            pending_name: ?[]u8 = null,
+            pending_kind: kernel.fs.FileType = .Unknown,
 
             pub fn create(allocator: std.mem.Allocator, path: []const u8, node: kernel.fs.Node) !FileHandle {
                 return FileHandle{
@@ -72,14 +80,57 @@ pub fn ProcessInterface(comptime ProcessType: type, comptime ProcessMemoryPoolTy
             }
 
             pub fn close(self: *FileHandle) void {
-                if (self.diriter) |*d| {
-                    d.interface.delete();
-                    self.diriter = null;
-                }
+                self.remove_iterator();
                 self.allocator.free(self.path);
                 self.node.delete();
             }
 
+            pub fn dirent_length(name: []const u8) usize {
+                return std.mem.alignForward(usize, @sizeOf(c.dirent) - 1 + name.len, @alignOf(c.dirent));
+            }
+
+            // Packs as many entries as fit into buffer, returns number of written bytes.
+            // Zero is returned at the end of directory.
+            pub fn read_dirents(self: *FileHandle, buffer: []u8) !usize {
+                const it = try self.get_iterator();
+                var written: usize = 0;
+                while (true) {
+                    const from_pending = self.pending_name != null;
+                    const entry: kernel.fs.DirectoryEntry = if (self.pending_name) |name|
+                        .{ .name = name, .kind = self.pending_kind }
+                    else
+                        it.interface.next() orelse break;
+
+                    const reclen = dirent_length(entry.name);
+                    if (written + reclen > buffer.len) {
+                        // iterator can't be rewound, so entry is kept for the next call
+                        if (!from_pending) {
+                            self.pending_name = try self.allocator.dupe(u8, entry.name);
+                            self.pending_kind = entry.kind;
+                        }
+                        if (written == 0) {
+                            return kernel.errno.ErrnoSet.InvalidArgument;
+                        }
+                        break;
+                    }
+
+                    self.dir_offset += 1;
+                    const dirp: *c.dirent = @ptrCast(@alignCast(buffer[written..].ptr));
+                    dirp.d_ino = 0xdead;
+                    dirp.d_off = @intCast(self.dir_offset);
+                    dirp.d_reclen = @intCast(reclen);
+                    @memcpy(dirp.d_name[0..entry.name.len], entry.name);
+                    dirp.d_name[entry.name.len] = 0;
+                    written += reclen;
+
+                    if (from_pending) {
+                        self.allocator.free(self.pending_name.?);
+                        self.pending_name = null;
+                    }
+                }
+                return written;
+            }
+
             pub fn get_iterator(self: *FileHandle) !*IDirectoryIterator {
                 if (self.diriter) |*d| {
                     return d;
@@ -99,6 +150,11 @@ pub fn ProcessInterface(comptime ProcessType: type, comptime ProcessMemoryPoolTy
                     d.interface.delete();
                     self.diriter = null;
                 }
+                if (self.pending_name) |name| {
+                    self.allocator.free(name);
+                    self.pending_name = null;
+                }
+                self.dir_offset = 0;
             }
         };
         pub const ImplType = ProcessType;
@@ -117,14 +173,35 @@ pub fn ProcessInterface(comptime ProcessType: type, comptime ProcessMemoryPoolTy
             node: std.DoublyLinkedList.Node,
         };
 
+        // processes that became Ready, collected by schedulers that keep run queues
+        pub var ready_list: std.DoublyLinkedList = .{};
+
+        pub const RunQueueState = enum(u2) {
+            None,
+            Pending,
+            Queued,
+        };
+
+        // nice values map to priorities, 0 is the highest priority
+        pub const min_nice = -20;
+        pub const max_nice = 19;
+        pub const default_priority: u8 = -min_nice;
+        pub const number_of_priorities = max_nice - min_nice + 1;
+
         state: State,
         priority: u8,
+        run_node: std.DoublyLinkedList.Node = .{},
+        run_queue_state: RunQueueState = .None,
+        run_queue: u8 = 0,
         impl: ImplType,
         pid: c.pid_t,
         _kernel_allocator: std.mem.Allocator,
         current_core: u8,
         waiting_for: ?*const Semaphore = null,
-        _fds: std.AutoHashMap(u16, FileHandle),
+        // blocking token and wakeup timer used by sleep
+        _sleep_token: Semaphore = Semaphore.create(0),
+        _sleep_timer: timer.Timer = .{},
+        _fds: FdTable(FileHandle),
         cwd: []u8,
         node: std.DoublyLinkedList.Node,
         _process_memory_allocator: ProcessMemoryAllocator,
@@ -136,6 +213,7 @@ pub fn ProcessInterface(comptime ProcessType: type, comptime ProcessMemoryPoolTy
         _vfork_context: ?VForkContext = null,
         _initialized: bool = false,
         _start_time: u64,
+        _io_wait_time: u64 = 0,
         processes_syscall: bool = false,
         vfork_return: usize = 0,
         vfork_sp: usize = 0,
@@ -161,12 +239,12 @@ pub fn ProcessInterface(comptime ProcessType: type, comptime ProcessMemoryPoolTy
             }
             process.* = .{
                 .state = State.Ready,
-                .priority = 0,
+                .priority = default_priority,
                 .impl = undefined,
                 .pid = pid,
                 ._kernel_allocator = kernel_allocator,
                 .current_core = 0,
-                ._fds = std.AutoHashMap(u16, FileHandle).init(kernel_allocator),
+                ._fds = FdTable(FileHandle).init(kernel_allocator),
                 .cwd = cwd_handle,
                 .node = .{},
                 ._process_memory_allocator = ProcessMemoryAllocator.init(pid, process_memory_pool),
@@ -178,39 +256,26 @@ pub fn ProcessInterface(comptime ProcessType: type, comptime ProcessMemoryPoolTy
                 ._start_time = hal.time.get_time_us(),
             };
             process.impl = try ImplType.init(process._process_memory_allocator.allocator(), stack_size, process_entry, exit_handler_impl, args[0..], is_root);
+            process.mark_ready();
             return process;
         }
 
         pub fn clear_fds(self: *Self) void {
-            var it = self._fds.iterator();
-            while (it.next()) |*n| {
-                n.value_ptr.close();
-            }
             self._fds.deinit();
         }
 
-        fn dupe_filehandle(handle: *FileHandle) !FileHandle {
-            return .{
-                .allocator = handle.allocator,
-                .diriter = handle.diriter,
-                .node = try handle.node.clone(),
-                .path = try handle.allocator.dupe(u8, handle.path),
-            };
-        }
-        fn dupe_fds(self: *Self) !std.AutoHashMap(u16, FileHandle) {
-            var fds = std.AutoHashMap(u16, FileHandle).init(self._kernel_allocator);
-            var it = self._fds.iterator();
-            while (it.next()) |*n| {
-                try fds.put(n.key_ptr.*, try dupe_filehandle(n.value_ptr));
-            }
-            return fds;
-        }
-
         pub fn schedule_removal(self: *Self) void {
             self.state = State.Terminated;
         }
 
         pub fn deinit(self: *Self) void {
+            timer.cancel(&self._sleep_timer);
+            const state = ReadyListLock.lock();
+            if (self.run_queue_state == .Pending) {
+                ready_list.remove(&self.run_node);
+                self.run_queue_state = .None;
+            }
+            ReadyListLock.unlock(state);
             self.impl.deinit(self._process_memory_allocator.allocator());
             self.clear_fds();
             self._kernel_allocator.free(self.cwd);
@@ -243,7 +308,12 @@ pub fn ProcessInterface(comptime ProcessType: type, comptime ProcessMemoryPoolTy
         pub fn vfork(self: *Self, process_memory_pool: *ProcessMemoryPoolType, pid: c.pid_t) !*Self {
             // allocate stack copy
             const process = try self._kernel_allocator.create(Self);
+            errdefer self._kernel_allocator.destroy(process);
+            // child shares open files with parent, handles are reference counted
+            var fds = try self._fds.clone();
+            errdefer fds.deinit();
             const cwd_handle = try self._kernel_allocator.alloc(u8, self.cwd.len);
+            errdefer self._kernel_allocator.free(cwd_handle);
             @memcpy(cwd_handle, self.cwd);
 
             process.* = .{
@@ -253,7 +323,7 @@ pub fn ProcessInterface(comptime ProcessType: type, comptime ProcessMemoryPoolTy
                 .pid = pid,
                 ._kernel_allocator = self._kernel_allocator,
                 .current_core = 0,
-                ._fds = try self.dupe_fds(),
+                ._fds = fds,
                 .cwd = cwd_handle,
                 .node = .{},
                 ._process_memory_allocator = ProcessMemoryAllocator.init(pid, process_memory_pool),
@@ -267,6 +337,7 @@ pub fn ProcessInterface(comptime ProcessType: type, comptime ProcessMemoryPoolTy
             };
             process.impl = try self.impl.vfork(process._process_memory_allocator.allocator());
             self._child = process;
+            process.mark_ready();
 
             return process;
         }
@@ -354,6 +425,36 @@ pub fn ProcessInterface(comptime ProcessType: type, comptime ProcessMemoryPoolTy
                 return;
             }
             self.state = Process.State.Ready;
+            self.mark_ready();
+        }
+
+        // process already waiting in run queue is not added again
+        fn mark_ready(self: *Self) void {
+            const state = ReadyListLock.lock();
+            defer ReadyListLock.unlock(state);
+            if (self.run_queue_state == .None) {
+                ready_list.append(&self.run_node);
+                self.run_queue_state = .Pending;
+            }
+        }
+
+        pub fn take_ready() ?*Self {
+            const state = ReadyListLock.lock();
+            defer ReadyListLock.unlock(state);
+            const node = ready_list.popFirst() orelse return null;
+            const process: *Self = @alignCast(@fieldParentPtr("run_node", node));
+            process.run_queue_state = .None;
+            return process;
+        }
+
+        pub fn get_nice(self: *const Self) i8 {
+            return @as(i8, @intCast(self.priority)) + min_nice;
+        }
+
+        // new priority is used when process is queued next time
+        pub fn set_nice(self: *Self, nice: i32) void {
+            const value = std.math.clamp(nice, min_nice, max_nice);
+            self.priority = @intCast(value - min_nice);
         }
 
         pub fn is_blocked_by(self: Self, semaphore: *const Semaphore) bool {
@@ -452,30 +553,36 @@ pub fn ProcessInterface(comptime ProcessType: type, comptime ProcessMemoryPoolTy
         }
 
         pub fn get_free_fd(self: *Self) u16 {
-            var fd: u16 = 0;
-            while (true) {
-                if (self._fds.get(fd) == null) {
-                    break;
-                }
-                fd += 1;
-            }
-            return fd;
+            return @intCast(self._fds.lowest_free());
         }
 
         pub fn get_parent(self: Self) ?*Self {
             return self._parent;
         }
 
+        // process stays Blocked until wakeup timer expires
         pub fn sleep_for_us(self: *Self, us: u64) void {
-            const start = systick.get_system_ticks().*;
-            var elapsed: u64 = 0;
-            const ptr: *volatile u64 = &elapsed;
-            while (ptr.* < us / 1000) {
-                // context switch, we are waiting for condition
+            const ticks = timer.us_to_ticks(us);
+            if (ticks == 0) {
+                return;
+            }
+            self._sleep_timer.callback = &wake_up;
+            self._sleep_timer.context = self;
+            const state = arch.sync.save_and_disable_interrupts();
+            self.block_semaphore(&self._sleep_token);
+            timer.start(&self._sleep_timer, ticks);
+            arch.sync.restore_interrupts(state);
+
+            while (self._sleep_timer.is_armed()) {
+                // context switch, scheduler skips this process until wakeup
                 hal.irq.trigger(.pendsv);
-                ptr.* = systick.get_system_ticks().* - start;
             }
-            _ = self;
+            self.unblock_semaphore(&self._sleep_token);
+        }
+
+        fn wake_up(context: ?*anyopaque) void {
+            const self: *Self = @ptrCast(@alignCast(context.?));
+            self.unblock_semaphore(&self._sleep_token);
         }
 
         pub fn sleep_for_ms(self: *Self, ms: u32) void {
@@ -495,31 +602,58 @@ pub fn ProcessInterface(comptime ProcessType: type, comptime ProcessMemoryPoolTy
             return hal.time.get_time_us() - self._start_time;
         }
 
+        // time in microseconds spent waiting for block devices
+        pub fn add_io_wait_time(self: *Self, us: u64) void {
+            self._io_wait_time += us;
+        }
+
+        pub fn get_io_wait_time(self: *const Self) u64 {
+            return self._io_wait_time;
+        }
+
         pub fn attach_file(self: *Self, path: []const u8, node: kernel.fs.Node) !i32 {
             const fd = self.get_free_fd();
             return try self.attach_file_with_fd(@intCast(fd), path, node);
         }
 
         pub fn attach_file_with_fd(self: *Self, fd: i16, path: []const u8, node: kernel.fs.Node) !i32 {
-            const handle = try FileHandle.create(self._kernel_allocator, path, node);
-            try self._fds.put(@intCast(fd), handle);
+            if (fd < 0) {
+                return kernel.errno.ErrnoSet.BadFileDescriptor;
+            }
+            var handle = try FileHandle.create(self._kernel_allocator, path, node);
+            errdefer handle.close();
+            try self._fds.install(@intCast(fd), handle);
             return @intCast(fd);
         }
 
+        // newfd equal to null selects the lowest free descriptor, used by dup and dup2
+        pub fn duplicate_file(self: *Self, fd: i32, newfd: ?i32) !i32 {
+            if (fd < 0 or (newfd orelse 0) < 0) {
+                return kernel.errno.ErrnoSet.BadFileDescriptor;
+            }
+            const target: usize = if (newfd) |n| @intCast(n) else self._fds.lowest_free();
+            try self._fds.share(@intCast(fd), target);
+            return @intCast(target);
+        }
+
+        // closing may wait for filesystem I/O, so it is done with context switching enabled
         pub fn release_file(self: *Self, fd: i32) void {
-            const maybe_handle = self._fds.getPtr(@intCast(fd));
-            if (maybe_handle) |handle| {
-                handle.close();
-                _ = self._fds.remove(@intCast(fd));
+            if (fd < 0) {
+                return;
+            }
+            kernel.process.block_context_switch();
+            const detached = self._fds.detach(@intCast(fd));
+            kernel.process.unblock_context_switch();
+            if (detached) |handle| {
+                self._fds.put(handle);
             }
         }
 
         pub fn get_file_handle(self: *Self, fd: i32) ?*FileHandle {
-            const maybe_handle = self._fds.getPtr(@intCast(fd));
-            if (maybe_handle) |handle| {
-                return handle;
+            if (fd < 0) {
+                return null;
             }
-            return null;
+            return self._fds.get(@intCast(fd));
         }
     };
 }
@@ -655,6 +789,18 @@ test "Process.ShouldReturnUptime" {
     try std.testing.expectEqual(@as(u64, 2000), sut.get_uptime());
 }
 
+test "Process.ShouldAccumulateIoWaitTime" {
+    var pool = ProcessMemoryPoolForTests{};
+    var arg: usize = 1;
+    var sut = try ProcessUnderTest.init(std.testing.allocator, 1024, &process_init, &arg, "/", &pool, null, 50, false);
+    defer sut.deinit();
+
+    try std.testing.expectEqual(@as(u64, 0), sut.get_io_wait_time());
+    sut.add_io_wait_time(1500);
+    sut.add_io_wait_time(250);
+    try std.testing.expectEqual(@as(u64, 1750), sut.get_io_wait_time());
+}
+
 test "Process.ShouldSetCurrentCore" {
     var pool = ProcessMemoryPoolForTests{};
     var arg: usize = 1;
@@ -683,6 +829,43 @@ test "Process.ShouldSleepForMilliseconds" {
 
     hal.irq.impl().set_irq_action(.pendsv, &PendSvAction.call);
     sut.sleep_for_ms(10);
+    try std.testing.expectEqual(ProcessUnderTest.State.Ready, sut.state);
+}
+
+const SleepingProcess = struct {
+    var process: ?*ProcessUnderTest = null;
+    var switches: usize = 0;
+    var blocked: usize = 0;
+
+    pub fn call() void {
+        switches += 1;
+        if (process.?.state == ProcessUnderTest.State.Blocked) {
+            blocked += 1;
+        }
+        irq_systick();
+    }
+};
+
+test "Process.ShouldStayBlockedUntilSleepExpires" {
+    defer hal.irq.impl().clear();
+    var pool = ProcessMemoryPoolForTests{};
+    var arg: usize = 1;
+    hal.time.impl.set_time(0);
+    var sut = try ProcessUnderTest.init(std.testing.allocator, 1024, &process_init, &arg, "/", &pool, null, 71, false);
+    defer sut.deinit();
+
+    SleepingProcess.process = sut;
+    SleepingProcess.switches = 0;
+    SleepingProcess.blocked = 0;
+    defer SleepingProcess.process = null;
+    hal.irq.impl().set_irq_action(.pendsv, &SleepingProcess.call);
+
+    // each context switch advances time by one tick
+    sut.sleep_for_us(4500);
+    try std.testing.expectEqual(5, SleepingProcess.switches);
+    try std.testing.expectEqual(5, SleepingProcess.blocked);
+    try std.testing.expectEqual(ProcessUnderTest.State.Ready, sut.state);
+    try std.testing.expect(!sut._sleep_timer.is_armed());
 }
 
 test "Process.ShouldForkProcess" {
@@ -929,6 +1112,29 @@ test "Process.ShouldDuplicateFileHandlesOnVfork" {
     try std.testing.expect(child.get_file_handle(fd1) != null);
 }
 
+test "Process.ShouldShareFileHandleWithDuplicatedDescriptor" {
+    var pool = ProcessMemoryPoolForTests{};
+    var arg: usize = 0;
+    hal.time.impl.set_time(0);
+    var sut = try ProcessUnderTest.init(std.testing.allocator, 1024, &process_init, &arg, "/", &pool, null, 220, false);
+    defer sut.deinit();
+
+    const file_mock = try FileMock.create(std.testing.allocator);
+    defer file_mock.delete();
+    const fd = try sut.attach_file("/dev/test", kernel.fs.Node.create_file(file_mock.interface));
+
+    const duplicated = try sut.duplicate_file(fd, null);
+    try std.testing.expectEqual(@as(i32, 1), duplicated);
+    try std.testing.expectEqual(sut.get_file_handle(fd).?, sut.get_file_handle(duplicated).?);
+
+    try std.testing.expectEqual(@as(i32, 10), try sut.duplicate_file(fd, 10));
+    try std.testing.expectEqual(@as(u16, 2), sut.get_free_fd());
+    try std.testing.expectError(error.BadFileDescriptor, sut.duplicate_file(5, null));
+
+    sut.release_file(fd);
+    try std.testing.expectEqualStrings("/dev/test", sut.get_file_handle(10).?.path);
+}
+
 const DirectoryMock = @import("fs/tests/directory_mock.zig").DirectoryMock;
 const DirectoryIteratorMock = @import("fs/tests/directory_mock.zig").DirectoryIteratorMock;
 
@@ -999,3 +1205,74 @@ test "FileHandle.ShouldRejectIteratorForFileDescriptor" {
 
     try std.testing.expectError(kernel.errno.ErrnoSet.NotADirectory, handle.get_iterator());
 }
+
+test "FileHandle.ShouldPackMultipleEntriesIntoDirentBuffer" {
+    var directory_mock = try DirectoryMock.create(std.testing.allocator);
+    defer directory_mock.delete();
+    const dir_node = kernel.fs.Node.create_directory(directory_mock.interface);
+
+    var handle = try Process.FileHandle.create(std.testing.allocator, "/bin", dir_node);
+    defer handle.close();
+
+    var iterator_mock = try DirectoryIteratorMock.create(std.testing.allocator);
+    defer iterator_mock.delete();
+    _ = directory_mock
+        .expectCall("iterator")
+        .willReturn(iterator_mock.get_interface());
+
+    const FileHandle = Process.FileHandle;
+    var buffer: [8 * @sizeOf(c.dirent)]u8 align(@alignOf(c.dirent)) = undefined;
+    const first_batch = FileHandle.dirent_length("ls") + FileHandle.dirent_length("cat");
+
+    _ = iterator_mock
+        .expectCall("next")
+        .willReturn(@as(?kernel.fs.DirectoryEntry, .{ .name = "ls", .kind = .File }));
+    _ = iterator_mock
+        .expectCall("next")
+        .willReturn(@as(?kernel.fs.DirectoryEntry, .{ .name = "cat", .kind = .File }));
+    _ = iterator_mock
+        .expectCall("next")
+        .willReturn(@as(?kernel.fs.DirectoryEntry, .{ .name = "mkdir", .kind = .File }));
+    try std.testing.expectEqual(first_batch, try handle.read_dirents(buffer[0..first_batch]));
+
+    const first: *c.dirent = @ptrCast(@alignCast(&buffer));
+    try std.testing.expectEqualStrings("ls", std.mem.sliceTo(&first.d_name, 0));
+    try std.testing.expectEqual(1, first.d_off);
+    const second: *c.dirent = @ptrCast(@alignCast(buffer[first.d_reclen..].ptr));
+    try std.testing.expectEqualStrings("cat", std.mem.sliceTo(&second.d_name, 0));
+    try std.testing.expectEqual(2, second.d_off);
+
+    // entry that did not fit must be returned first
+    _ = iterator_mock
+        .expectCall("next")
+        .willReturn(null);
+    try std.testing.expectEqual(FileHandle.dirent_length("mkdir"), try handle.read_dirents(&buffer));
+    try std.testing.expectEqualStrings("mkdir", std.mem.sliceTo(&first.d_name, 0));
+    try std.testing.expectEqual(3, first.d_off);
+
+    _ = iterator_mock
+        .expectCall("next")
+        .willReturn(null);
+    try std.testing.expectEqual(0, try handle.read_dirents(&buffer));
+}
+
+test "FileHandle.ShouldRejectDirentBufferSmallerThanEntry" {
+    var directory_mock = try DirectoryMock.create(std.testing.allocator);
+    defer directory_mock.delete();
+    const dir_node = kernel.fs.Node.create_directory(directory_mock.interface);
+
+    var handle = try Process.FileHandle.create(std.testing.allocator, "/bin", dir_node);
+    defer handle.close();
+
+    var iterator_mock = try DirectoryIteratorMock.create(std.testing.allocator);
+    defer iterator_mock.delete();
+    _ = directory_mock
+        .expectCall("iterator")
+        .willReturn(iterator_mock.get_interface());
+
+    var buffer: [4]u8 align(@alignOf(c.dirent)) = undefined;
+    _ = iterator_mock
+        .expectCall("next")
+        .willReturn(@as(?kernel.fs.DirectoryEntry, .{ .name = "ls", .kind = .File }));
+    try std.testing.expectError(kernel.errno.ErrnoSet.InvalidArgument, handle.read_dirents(&buffer));
+}
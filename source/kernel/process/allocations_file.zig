@@ -0,0 +1,66 @@
+// Copyright (c) 2025 Mateusz Stadnik
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy of
+// this software and associated documentation files (the "Software"), to deal in
+// the Software without restriction, including without limitation the rights to
+// use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies of
+// the Software, and to permit persons to whom the Software is furnished to do so,
+// subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS
+// FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR
+// COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER
+// IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN
+// CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+
+const std = @import("std");
+
+const interface = @import("interface");
+
+const kernel = @import("../kernel.zig");
+
+// Live kernel allocations grouped by call site, available with leak detection
+const BufferSize = 1024;
+const AllocationsBufferedFile = kernel.fs.BufferedFile(BufferSize);
+pub const AllocationsFile = interface.DeriveFromBase(AllocationsBufferedFile, struct {
+    const Self = @This();
+    base: AllocationsBufferedFile,
+
+    pub fn create() AllocationsFile {
+        var file = AllocationsFile.init(.{
+            .base = AllocationsBufferedFile.InstanceType.create("allocations"),
+        });
+        _ = file.data().sync();
+        return file;
+    }
+
+    pub fn create_node(allocator: std.mem.Allocator) anyerror!kernel.fs.Node {
+        const file = try create().interface.new(allocator);
+        return kernel.fs.Node.create_file(file);
+    }
+
+    pub fn sync(self: *Self) i32 {
+        const buffer = &interface.base(self)._buffer;
+        interface.base(self)._end = kernel.memory.heap.malloc.dump_allocations(buffer).len;
+        return 0;
+    }
+
+    pub fn delete(self: *Self) void {
+        _ = self;
+    }
+});
+
+test "AllocationsFile.ShouldShowTrackerSummary" {
+    var sut = try AllocationsFile.InstanceType.create().interface.new(std.testing.allocator);
+    defer sut.interface.delete();
+
+    var buffer: [BufferSize]u8 = undefined;
+    const readed: usize = @intCast(sut.interface.read(&buffer));
+
+    try std.testing.expectEqualStrings("allocations", sut.interface.name());
+    try std.testing.expectEqualStrings("Live: 0 Untracked: 0\nCallSite   Count      Bytes\n", buffer[0..readed]);
+}
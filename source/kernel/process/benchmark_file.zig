@@ -0,0 +1,82 @@
+// Copyright (c) 2025 Mateusz Stadnik
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy of
+// this software and associated documentation files (the "Software"), to deal in
+// the Software without restriction, including without limitation the rights to
+// use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies of
+// the Software, and to permit persons to whom the Software is furnished to do so,
+// subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS
+// FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR
+// COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER
+// IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN
+// CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+
+const std = @import("std");
+
+const interface = @import("interface");
+
+const kernel = @import("../kernel.zig");
+
+// Accumulated duration of kernel benchmark probes, available with benchmarks enabled
+const BufferSize = 256;
+const BenchmarkBufferedFile = kernel.fs.BufferedFile(BufferSize);
+pub const BenchmarkFile = interface.DeriveFromBase(BenchmarkBufferedFile, struct {
+    const Self = @This();
+    base: BenchmarkBufferedFile,
+
+    pub fn create() BenchmarkFile {
+        var file = BenchmarkFile.init(.{
+            .base = BenchmarkBufferedFile.InstanceType.create("benchmark"),
+        });
+        _ = file.data().sync();
+        return file;
+    }
+
+    pub fn create_node(allocator: std.mem.Allocator) anyerror!kernel.fs.Node {
+        const file = try create().interface.new(allocator);
+        return kernel.fs.Node.create_file(file);
+    }
+
+    pub fn sync(self: *Self) i32 {
+        const buffer = &interface.base(self)._buffer;
+        var written = (std.fmt.bufPrint(buffer, "Probe           Calls     Total(us)   Max(us)\n", .{}) catch buffer[0..0]).len;
+        for (std.enums.values(kernel.benchmark.Probe)) |probe| {
+            const stats = kernel.benchmark.get(probe);
+            const line = std.fmt.bufPrint(buffer[written..], "{s: <12} {d: >8} {d: >13} {d: >9}\n", .{ @tagName(probe), stats.calls, stats.total_us, stats.max_us }) catch break;
+            written += line.len;
+        }
+        interface.base(self)._end = written;
+        return 0;
+    }
+
+    pub fn delete(self: *Self) void {
+        _ = self;
+    }
+});
+
+test "BenchmarkFile.ShouldShowProbeStatistics" {
+    kernel.benchmark.reset();
+    defer kernel.benchmark.reset();
+    var sut = try BenchmarkFile.InstanceType.create().interface.new(std.testing.allocator);
+    defer sut.interface.delete();
+
+    var buffer: [BufferSize]u8 = undefined;
+    const readed: usize = @intCast(sut.interface.read(&buffer));
+
+    try std.testing.expectEqualStrings("benchmark", sut.interface.name());
+    const expected =
+        \\Probe           Calls     Total(us)   Max(us)
+        \\getdents            0             0         0
+        \\stat                0             0         0
+        \\exec                0             0         0
+        \\lazy_bind           0             0         0
+        \\
+    ;
+    try std.testing.expectEqualStrings(expected, buffer[0..readed]);
+}
@@ -0,0 +1,109 @@
+// Copyright (c) 2025 Mateusz Stadnik
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy of
+// this software and associated documentation files (the "Software"), to deal in
+// the Software without restriction, including without limitation the rights to
+// use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies of
+// the Software, and to permit persons to whom the Software is furnished to do so,
+// subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS
+// FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR
+// COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER
+// IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN
+// CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+
+const std = @import("std");
+
+const interface = @import("interface");
+
+const kernel = @import("../kernel.zig");
+
+const BufferSize = 192;
+const BlockCacheInfoBufferedFile = kernel.fs.BufferedFile(BufferSize);
+pub const BlockCacheInfoFile = interface.DeriveFromBase(BlockCacheInfoBufferedFile, struct {
+    const Self = @This();
+    base: BlockCacheInfoBufferedFile,
+
+    pub fn create() BlockCacheInfoFile {
+        var file = BlockCacheInfoFile.init(.{
+            .base = BlockCacheInfoBufferedFile.InstanceType.create("blockcache"),
+        });
+        _ = file.data().sync();
+        return file;
+    }
+
+    pub fn create_node(allocator: std.mem.Allocator) anyerror!kernel.fs.Node {
+        const file = try create().interface.new(allocator);
+        return kernel.fs.Node.create_file(file);
+    }
+
+    pub fn sync(self: *Self) i32 {
+        const stats: kernel.fs.BlockCache.Statistics = if (kernel.fs.get_block_cache()) |cache|
+            cache.get_statistics()
+        else
+            .{ .sectors = 0, .dirty = 0, .hits = 0, .misses = 0, .writebacks = 0, .bypassed = 0 };
+
+        const buffer = &interface.base(self)._buffer;
+        const buf = std.fmt.bufPrint(buffer,
+            \\Sectors:     {d: >12}
+            \\Dirty:       {d: >12}
+            \\Hits:        {d: >12}
+            \\Misses:      {d: >12}
+            \\Writebacks:  {d: >12}
+            \\Bypassed:    {d: >12}
+            \\
+        , .{ stats.sectors, stats.dirty, stats.hits, stats.misses, stats.writebacks, stats.bypassed }) catch buffer;
+        interface.base(self)._end = buf.len;
+        return 0;
+    }
+
+    pub fn delete(self: *Self) void {
+        _ = self;
+    }
+});
+
+test "BlockCacheInfoFile.ShouldShowZerosWhenCacheIsDisabled" {
+    var sut = try BlockCacheInfoFile.InstanceType.create().interface.new(std.testing.allocator);
+    defer sut.interface.delete();
+
+    var buffer: [BufferSize]u8 = undefined;
+    const readed: usize = @intCast(sut.interface.read(&buffer));
+
+    try std.testing.expectEqualStrings("blockcache", sut.interface.name());
+    const expected =
+        \\Sectors:                0
+        \\Dirty:                  0
+        \\Hits:                   0
+        \\Misses:                 0
+        \\Writebacks:             0
+        \\Bypassed:               0
+        \\
+    ;
+    try std.testing.expectEqualStrings(expected, buffer[0..readed]);
+}
+
+test "BlockCacheInfoFile.ShouldShowCacheStatistics" {
+    try kernel.fs.block_cache_init(std.testing.allocator, std.testing.allocator, 16);
+    defer kernel.fs.block_cache_deinit();
+
+    var sut = try BlockCacheInfoFile.InstanceType.create().interface.new(std.testing.allocator);
+    defer sut.interface.delete();
+
+    var buffer: [BufferSize]u8 = undefined;
+    const readed: usize = @intCast(sut.interface.read(&buffer));
+    const expected =
+        \\Sectors:               16
+        \\Dirty:                  0
+        \\Hits:                   0
+        \\Misses:                 0
+        \\Writebacks:             0
+        \\Bypassed:               0
+        \\
+    ;
+    try std.testing.expectEqualStrings(expected, buffer[0..readed]);
+}
@@ -31,7 +31,7 @@ const MemoryInfo = struct {
     total: usize,
 };
 
-const BufferSize = 128;
+const BufferSize = 256;
 const BufferedFileForMeminfo = kernel.fs.BufferedFile(BufferSize);
 pub const MemInfoFile = interface.DeriveFromBase(BufferedFileForMeminfo, struct {
     const Self = @This();
@@ -51,7 +51,8 @@ pub const MemInfoFile = interface.DeriveFromBase(BufferedFileForMeminfo, struct
 
     pub fn sync(self: *Self) i32 {
         const memory_used: usize = kernel.memory.heap.malloc.get_usage();
-        const memory_used_slow = kernel.process.process_manager.instance.get_process_memory_pool().get_used_size();
+        const pool = kernel.process.process_manager.instance.get_process_memory_pool();
+        const memory_used_slow = pool.get_used_size();
         const memory_used_combined = memory_used + memory_used_slow;
         var buffer = &interface.base(self)._buffer;
         var written_length: usize = 0;
@@ -63,6 +64,11 @@ pub const MemInfoFile = interface.DeriveFromBase(BufferedFileForMeminfo, struct
         written_length += buf.len;
         buf = std.fmt.bufPrint(buffer[written_length..], "MemProcessUsed:  {s}\n", .{format_size(memory_used_slow, &sizebuf)}) catch buf;
         written_length += buf.len;
+        buf = std.fmt.bufPrint(buffer[written_length..], "MemProcessFree:  {s}\n", .{format_size(pool.get_free_size(), &sizebuf)}) catch buf;
+        written_length += buf.len;
+        // allocation larger than this fails even if enough memory is free
+        buf = std.fmt.bufPrint(buffer[written_length..], "MemLargestFree:  {s}\n", .{format_size(pool.get_largest_free_block(), &sizebuf)}) catch buf;
+        written_length += buf.len;
         interface.base(self)._end = written_length;
         return 0;
     }
@@ -102,6 +108,8 @@ test "MemInfoFile.ShouldShowMemInfo" {
         \\MemUsed:                0 B
         \\MemKernelUsed:          0 B
         \\MemProcessUsed:         0 B
+        \\MemProcessFree:    131072 KB
+        \\MemLargestFree:    131072 KB
         \\
     ;
     try std.testing.expectEqualStrings(expected_text, buffer[0..readed]);
@@ -121,6 +129,8 @@ test "MemInfoFile.ShouldShowMemInfo" {
         \\MemUsed:             3072 KB
         \\MemKernelUsed:       1024 KB
         \\MemProcessUsed:      2048 KB
+        \\MemProcessFree:    129024 KB
+        \\MemLargestFree:     65536 KB
         \\
     ;
     try std.testing.expectEqualStrings(expected_allocated_text, buffer[0..readed_after_alloc]);
@@ -137,6 +147,8 @@ test "MemInfoFile.ShouldShowMemInfo" {
         \\MemUsed:             2053 MB
         \\MemKernelUsed:       2049 MB
         \\MemProcessUsed:      4096 KB
+        \\MemProcessFree:    126976 KB
+        \\MemLargestFree:     65536 KB
         \\
     ;
     try std.testing.expectEqualStrings(expected_allocated2_text, buffer[0..readed_after_alloc2]);
@@ -169,12 +169,12 @@ pub const PidStatFile = interface.DeriveFromBase(PidStatBufferedFile, struct {
                     .cminflt = 0,
                     .majflt = 0,
                     .cmajflt = 0,
-                    .utime = process.get_uptime() / 1000,
+                    .utime = (process.get_uptime() -| process.get_io_wait_time()) / 1000,
                     .stime = 0,
                     .cutime = 0,
                     .cstime = 0,
-                    .priority = 0,
-                    .nice = 0,
+                    .priority = process.priority,
+                    .nice = process.get_nice(),
                     .num_threads = 1,
                     .itrealvalue = 0,
                     .starttime = 0,
@@ -197,7 +197,7 @@ pub const PidStatFile = interface.DeriveFromBase(PidStatBufferedFile, struct {
                     .processor = 0,
                     .rt_priority = 0,
                     .policy = 0,
-                    .delayacct_blkio_ticks = 0,
+                    .delayacct_blkio_ticks = process.get_io_wait_time() / 1000,
                     .guest_time = 0,
                     .cguest_time = 0,
                     .start_data = 0,
@@ -275,7 +275,7 @@ test "PidStatFile.ShouldCreateStatFile" {
     var buf: [512]u8 = undefined;
     var file = sut.as_file().?;
     const readed = file.interface.read(buf[0..]);
-    const expected = "1 (dummy_module) R 0 0 0 1 0 0 0 0 0 0 0 0 0 0 0 0 1 0 0 0 0 0 0 0 0 0 0 0 0 0 0 0 0 0 0 0 0 0 0 0 0 0 0 0 0 0 0 0 0 \n";
+    const expected = "1 (dummy_module) R 0 0 0 1 0 0 0 0 0 0 0 0 0 0 20 0 1 0 0 0 0 0 0 0 0 0 0 0 0 0 0 0 0 0 0 0 0 0 0 0 0 0 0 0 0 0 0 0 0 \n";
     try std.testing.expectEqualStrings(expected, buf[0..@intCast(readed)]);
 
     var sut_status = try PidStatFile.InstanceType.create_node(std.testing.allocator, 1, true);
@@ -29,6 +29,8 @@ const ReadOnlyFile = @import("../fs/ifile.zig").ReadOnlyFile;
 
 const interface = @import("interface");
 
+const config = @import("config");
+
 const kernel = @import("../kernel.zig");
 const FileName = kernel.fs.FileName;
 const FileType = kernel.fs.FileType;
@@ -36,9 +38,12 @@ const FileType = kernel.fs.FileType;
 const log = std.log.scoped(.@"vfs/procfs");
 
 const MemInfoFile = @import("meminfo_file.zig").MemInfoFile;
+const BlockCacheInfoFile = @import("blockcache_file.zig").BlockCacheInfoFile;
 const ProcInfo = @import("procfs_iterator.zig").ProcInfo;
 const ProcInfoType = @import("procfs_iterator.zig").ProcInfoType;
 const MaxProcFile = @import("maxproc_file.zig").MaxProcFile;
+const AllocationsFile = @import("allocations_file.zig").AllocationsFile;
+const BenchmarkFile = @import("benchmark_file.zig").BenchmarkFile;
 
 const ProcFsDirectory = @import("procfs_directory.zig").ProcFsDirectory;
 
@@ -57,6 +62,7 @@ pub const ProcFs = interface.DeriveFromBase(ReadOnlyFileSystem, struct {
 
         var root_directory = procfs.data()._root.as(ProcFsDirectory);
         const meminfo = try MemInfoFile.InstanceType.create_node(allocator);
+        const blockcache = try BlockCacheInfoFile.InstanceType.create_node(allocator);
 
         var sys_directory_node = try ProcFsDirectory.InstanceType.create_node(allocator, "sys", false);
         var maybe_sys_directory = sys_directory_node.as_directory();
@@ -73,6 +79,13 @@ pub const ProcFs = interface.DeriveFromBase(ReadOnlyFileSystem, struct {
         }
 
         try root_directory.data().append(meminfo);
+        try root_directory.data().append(blockcache);
+        if (config.instrumentation.enable_memory_leak_detection) {
+            try root_directory.data().append(try AllocationsFile.InstanceType.create_node(allocator));
+        }
+        if (kernel.benchmark.enabled) {
+            try root_directory.data().append(try BenchmarkFile.InstanceType.create_node(allocator));
+        }
         try root_directory.data().append(sys_directory_node);
         return procfs;
     }
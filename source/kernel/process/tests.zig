@@ -18,6 +18,9 @@ comptime {
     _ = @import("meminfo_file.zig");
     _ = @import("pid_directory.zig");
     _ = @import("maxproc_file.zig");
+    _ = @import("blockcache_file.zig");
+    _ = @import("allocations_file.zig");
+    _ = @import("benchmark_file.zig");
     _ = @import("pidstat_file.zig");
     _ = @import("procfs.zig");
 }
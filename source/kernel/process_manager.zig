@@ -35,8 +35,13 @@ const handlers = @import("interrupts/syscall_handlers.zig");
 
 const arch = @import("arch");
 
+// guards process list and scheduler state, they are also used from PendSV
+const ProcessLock = kernel.sync.IrqLock;
+
 const Scheduler = if (config.scheduler.round_robin)
     @import("scheduler/round_robin.zig").RoundRobin
+else if (config.scheduler.priority)
+    @import("scheduler/priority.zig").PriorityScheduler
 else if (config.scheduler.osthread)
     @import("scheduler/osthread.zig").OSThread
 else if (config.scheduler.stub)
@@ -91,14 +96,16 @@ fn ProcessManagerGenerator(comptime SchedulerType: anytype) type {
         }
 
         pub fn schedule_next(self: *Self) kernel.scheduler.Action {
+            const state = ProcessLock.lock();
+            defer ProcessLock.unlock(state);
             var next = self.terminate_list.first;
             while (next) |node| {
+                next = node.next;
                 const p: *Process = @alignCast(@fieldParentPtr("node", node));
                 self._scheduler.remove_process(&p.node);
                 self.terminate_list.remove(&p.node);
                 self.release_pid(p.pid);
                 p.deinit();
-                next = node.next;
             }
 
             if (self.processes.first) |first| {
@@ -153,6 +160,8 @@ fn ProcessManagerGenerator(comptime SchedulerType: anytype) type {
 
                 kernel.process.block_context_switch();
                 defer kernel.process.unblock_context_switch();
+                const state = ProcessLock.lock();
+                defer ProcessLock.unlock(state);
                 self.processes.append(&new_process.node);
                 return;
             }
@@ -188,8 +197,10 @@ fn ProcessManagerGenerator(comptime SchedulerType: anytype) type {
                     p.unblock_parent();
                     p.schedule_removal();
                     p.unblock_all(return_code);
+                    const state = ProcessLock.lock();
                     self.processes.remove(&p.node);
                     self.terminate_list.append(&p.node);
+                    ProcessLock.unlock(state);
 
                     if (ctx != null) {
                         const parent = p._parent.?;
@@ -253,9 +264,11 @@ fn ProcessManagerGenerator(comptime SchedulerType: anytype) type {
             }
             context.pid.* = new_process.pid;
 
+            const state = ProcessLock.lock();
             self.processes.append(&new_process.node);
             self._scheduler.set_next(&new_process.node);
             self.core[hal.cpu.coreid()] = new_process;
+            ProcessLock.unlock(state);
             // child is now running without context switch, but uses parent stack until exec
             // switch without context switch, just to represent correct state
             arch.disable_interrupts();
@@ -284,10 +297,12 @@ fn ProcessManagerGenerator(comptime SchedulerType: anytype) type {
 
         // TODO: exec on currently running process is not supported yet
         pub fn prepare_exec(self: *Self, path: []const u8, argv: [*c][*c]u8, envp: [*c][*c]u8) !i32 {
-            kernel.process.block_context_switch();
+            // measures loading and binding, only startup code runs after it before main
+            const started = kernel.benchmark.start();
             const current_process = self.get_current_process();
             // TODO: move loader to struct, pass allocator to loading functions
             const executable = try dynamic_loader.load_executable(path, current_process.get_process_memory_allocator(), current_process.pid);
+            kernel.process.block_context_switch();
             var argc: usize = 0;
             while (argv[argc] != null) : (argc += 1) {}
 
@@ -307,6 +322,7 @@ fn ProcessManagerGenerator(comptime SchedulerType: anytype) type {
             try current_process.reallocate_stack();
 
             try current_process.reinitialize_stack(&call_main, argc, @intFromPtr(argv), symbol.address, symbol.target_got_address);
+            kernel.benchmark.stop(.exec, started);
             self._scheduler.set_next(&current_process._parent.?.node);
             self.core[hal.cpu.coreid()] = current_process._parent.?;
 
@@ -333,6 +349,21 @@ fn ProcessManagerGenerator(comptime SchedulerType: anytype) type {
             return null;
         }
 
+        // setpriority(PRIO_PROCESS) semantics, nice value is clamped to supported range
+        pub fn set_priority(self: *Self, pid: i32, nice: i32) !void {
+            kernel.process.block_context_switch();
+            defer kernel.process.unblock_context_switch();
+            const p = self.get_process_for_pid(pid) orelse return kernel.errno.ErrnoSet.NoSuchProcess;
+            p.set_nice(nice);
+        }
+
+        pub fn get_priority(self: *Self, pid: i32) !i32 {
+            kernel.process.block_context_switch();
+            defer kernel.process.unblock_context_switch();
+            const p = self.get_process_for_pid(pid) orelse return kernel.errno.ErrnoSet.NoSuchProcess;
+            return p.get_nice();
+        }
+
         pub fn waitpid(self: *Self, pid: i32, status: *i32) !i32 {
             kernel.process.block_context_switch();
             const current_process = self.get_current_process();
@@ -389,18 +420,32 @@ fn ProcessManagerGenerator(comptime SchedulerType: anytype) type {
 pub const ProcessManager = ProcessManagerGenerator(Scheduler);
 
 pub var instance: ProcessManager = undefined;
+var initialized: bool = false;
 
 pub fn initialize_process_manager(allocator: std.mem.Allocator) void {
     log.info("Process manager initialization...", .{});
     process.init();
     instance = ProcessManager.init(allocator);
+    initialized = true;
 }
 
 pub fn deinitialize_process_manager() void {
+    initialized = false;
     instance.deinit();
 }
 
+// Drivers may be used before first process is scheduled (i.e. during filesystem mounting),
+// then there is no process to block
+pub fn get_running_process() ?*Process {
+    if (!initialized) {
+        return null;
+    }
+    return instance._scheduler.get_current();
+}
+
 pub export fn process_set_next_task() *const u8 {
+    const state = ProcessLock.lock();
+    defer ProcessLock.unlock(state);
     if (instance._scheduler.get_next()) |task| {
         instance._scheduler.update_current();
         instance.core[hal.cpu.coreid()] = task;
@@ -462,6 +507,22 @@ test "ProcessManager.ShouldCreateProcesses" {
     try sut.create_process(4096, &test_entry, @ptrCast(&arg), "/test");
 }
 
+test "ProcessManager.ShouldSetProcessPriority" {
+    var sut = ProcessManagerGenerator(StubScheduler).init(std.testing.allocator);
+    defer sut.deinit();
+
+    const arg = "argument";
+    try sut.create_process(4096, &test_entry, @ptrCast(&arg), "/test");
+
+    try std.testing.expectEqual(0, try sut.get_priority(1));
+    try sut.set_priority(1, -5);
+    try std.testing.expectEqual(-5, try sut.get_priority(1));
+    try sut.set_priority(1, 100);
+    try std.testing.expectEqual(Process.max_nice, try sut.get_priority(1));
+    try std.testing.expectError(kernel.errno.ErrnoSet.NoSuchProcess, sut.set_priority(2, 0));
+    try std.testing.expectError(kernel.errno.ErrnoSet.NoSuchProcess, sut.get_priority(2));
+}
+
 test "ProcessManager.ShouldRejectProcessCreationWhenNoPIDsAvailable" {
     initialize_process_manager(std.testing.allocator);
     var sut = &instance;
@@ -0,0 +1,470 @@
+//
+// priority.zig
+//
+// Copyright (C) 2025 Mateusz Stadnik <matgla@live.com>
+//
+// This program is free software: you can redistribute it and/or
+// modify it under the terms of the GNU General Public License
+// as published by the Free Software Foundation, either version
+// 3 of the License, or (at your option) any later version.
+//
+// This program is distributed in the hope that it will be
+// useful, but WITHOUT ANY WARRANTY; without even the implied
+// warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR
+// PURPOSE. See the GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General
+// Public License along with this program. If not, see
+// <https://www.gnu.org/licenses/>.
+//
+
+const std = @import("std");
+
+const kernel = @import("../kernel.zig");
+const Process = kernel.process.Process;
+
+const cpu = @import("hal").cpu;
+
+// Keeps ready queue per priority and bitmap of non empty queues, so picking next
+// process doesn't depend on number of processes. Processes with the same priority
+// are scheduled in round robin order.
+// Processes are queued when they become Ready (Process.ready_list), blocked ones are
+// dropped when reached in queue and are not queued again until woken up.
+// Waiting processes are aged, every aging_period scheduling rounds the oldest process
+// of each queue is moved one level up, so busy high priority processes can't starve
+// lower priority ones. Boost is dropped when process is queued again after running.
+// Processes are executed only by the first core.
+pub const PriorityScheduler = struct {
+    const Self = @This();
+    const Bitmap = std.meta.Int(.unsigned, Process.number_of_priorities);
+    pub const aging_period = 8;
+
+    pub const Name = "PriorityScheduler";
+    current: ?*std.DoublyLinkedList.Node = null,
+    next: ?*std.DoublyLinkedList.Node = null,
+    _queues: [Process.number_of_priorities]std.DoublyLinkedList = [_]std.DoublyLinkedList{.{}} ** Process.number_of_priorities,
+    _ready_mask: Bitmap = 0,
+    _rounds: u32 = 0,
+
+    pub fn init() PriorityScheduler {
+        return PriorityScheduler{};
+    }
+
+    pub fn schedule_next(self: *Self, first_node: *std.DoublyLinkedList.Node) kernel.scheduler.Action {
+        _ = first_node;
+        self.collect_ready();
+        self.age();
+
+        if (self.next) |node| {
+            const process: *Process = @alignCast(@fieldParentPtr("node", node));
+            if (process.state == Process.State.Ready) {
+                return self.switch_action();
+            }
+            self.next = null;
+        }
+
+        while (self.pop_highest()) |process| {
+            if (process.state != Process.State.Ready) {
+                continue;
+            }
+
+            if (self.get_current()) |current| {
+                if (current.state == Process.State.Running and current.priority < process.run_queue) {
+                    // current process has higher priority, it keeps running
+                    self.push_front(process);
+                    return .NoAction;
+                }
+            }
+
+            process.set_core(@intCast(cpu.coreid()));
+            self.next = &process.node;
+            return self.switch_action();
+        }
+        return .NoAction;
+    }
+
+    pub fn remove_process(self: *Self, node: *std.DoublyLinkedList.Node) void {
+        if (self.current == node) {
+            self.current = null;
+        }
+        if (self.next == node) {
+            self.next = null;
+        }
+        const process: *Process = @alignCast(@fieldParentPtr("node", node));
+        if (process.run_queue_state == .Queued) {
+            self.unlink(process);
+        }
+    }
+
+    pub fn set_next(self: *Self, next: ?*std.DoublyLinkedList.Node) void {
+        if (self.next) |node| {
+            if (node != next) {
+                // process selected by scheduler waits for next round
+                const process: *Process = @alignCast(@fieldParentPtr("node", node));
+                if (process.state == Process.State.Ready and process.run_queue_state == .None) {
+                    self.push_front(process);
+                }
+            }
+        }
+        self.next = next;
+        self.update_current();
+    }
+
+    pub fn get_current(self: *const Self) ?*Process {
+        if (self.current) |node| {
+            return @alignCast(@fieldParentPtr("node", node));
+        }
+        return null;
+    }
+
+    pub fn get_next(self: Self) ?*Process {
+        if (self.next) |node| {
+            if (self.current) |current_node| {
+                if (current_node == node) {
+                    return null;
+                }
+            }
+            return @alignCast(@fieldParentPtr("node", node));
+        }
+        return null;
+    }
+
+    pub fn update_current(self: *Self) void {
+        if (self.current) |current| {
+            const process: *Process = @alignCast(@fieldParentPtr("node", current));
+            process.reevaluate_state();
+        }
+
+        if (self.next) |next| {
+            const process: *Process = @alignCast(@fieldParentPtr("node", next));
+            process.state = Process.State.Running;
+            process._initialized = true;
+            self.current = self.next;
+            self.next = null;
+        }
+    }
+
+    pub fn number_of_queued(self: *const Self, priority: u8) usize {
+        return self._queues[priority].len();
+    }
+
+    fn switch_action(self: *Self) kernel.scheduler.Action {
+        if (self.current) |current_node| {
+            const current_process: *Process = @alignCast(@fieldParentPtr("node", current_node));
+            if (current_process.is_initialized()) {
+                return .StoreAndSwitch;
+            }
+        }
+        return .Switch;
+    }
+
+    fn collect_ready(self: *Self) void {
+        while (Process.take_ready()) |process| {
+            if (process.state == Process.State.Ready) {
+                self.push_back(process);
+            }
+        }
+    }
+
+    fn push_back(self: *Self, process: *Process) void {
+        process.run_queue = process.priority;
+        self.enqueue(process, false);
+    }
+
+    // process was taken from queue but didn't run, so it keeps level gained by aging
+    fn push_front(self: *Self, process: *Process) void {
+        self.enqueue(process, true);
+    }
+
+    fn enqueue(self: *Self, process: *Process, front: bool) void {
+        process.run_queue_state = .Queued;
+        const queue = &self._queues[process.run_queue];
+        if (front) {
+            queue.prepend(&process.run_node);
+        } else {
+            queue.append(&process.run_node);
+        }
+        self._ready_mask |= @as(Bitmap, 1) << @intCast(process.run_queue);
+    }
+
+    fn age(self: *Self) void {
+        self._rounds += 1;
+        if (self._rounds < aging_period) {
+            return;
+        }
+        self._rounds = 0;
+        // levels are visited from the highest priority, so promoted process is not moved twice
+        var mask = self._ready_mask & ~@as(Bitmap, 1);
+        while (mask != 0) : (mask &= mask - 1) {
+            const level = @ctz(mask);
+            const queue = &self._queues[level];
+            const node = queue.popFirst().?;
+            if (queue.first == null) {
+                self._ready_mask &= ~(@as(Bitmap, 1) << @intCast(level));
+            }
+            const process: *Process = @alignCast(@fieldParentPtr("run_node", node));
+            process.run_queue = level - 1;
+            self.enqueue(process, false);
+        }
+    }
+
+    fn unlink(self: *Self, process: *Process) void {
+        const queue = &self._queues[process.run_queue];
+        queue.remove(&process.run_node);
+        process.run_queue_state = .None;
+        if (queue.first == null) {
+            self._ready_mask &= ~(@as(Bitmap, 1) << @intCast(process.run_queue));
+        }
+    }
+
+    fn pop_highest(self: *Self) ?*Process {
+        if (self._ready_mask == 0) {
+            return null;
+        }
+        const priority = @ctz(self._ready_mask);
+        const node = self._queues[priority].first.?;
+        const process: *Process = @alignCast(@fieldParentPtr("run_node", node));
+        self.unlink(process);
+        return process;
+    }
+};
+
+test "PriorityScheduler.ShouldInitialize" {
+    const scheduler = PriorityScheduler.init();
+    try std.testing.expectEqual(null, scheduler.get_current());
+    try std.testing.expectEqual(null, scheduler.get_next());
+    try std.testing.expectEqual(0, scheduler._ready_mask);
+}
+
+fn entry() void {}
+const ProcessMemoryPool = @import("../memory/heap/process_memory_pool.zig").ProcessMemoryPool;
+const test_arg: i32 = 0;
+const c = @import("libc_imports").c;
+
+fn create_process(pid: c.pid_t, cwd: []const u8, pool: *ProcessMemoryPool) !*Process {
+    return try Process.init(std.testing.allocator, 4096, &entry, &test_arg, cwd, pool, null, pid, false);
+}
+
+test "PriorityScheduler.ShouldScheduleFirstReadyProcess" {
+    var scheduler = PriorityScheduler.init();
+
+    var pool = try ProcessMemoryPool.init(std.testing.allocator);
+    defer pool.deinit();
+
+    var list = std.DoublyLinkedList{};
+    var process1 = try create_process(1, "/proc/1", &pool);
+    defer process1.deinit();
+
+    list.append(&process1.node);
+
+    const action = scheduler.schedule_next(list.first.?);
+    try std.testing.expectEqual(kernel.scheduler.Action.Switch, action);
+    try std.testing.expect(scheduler.get_next() == process1);
+}
+
+test "PriorityScheduler.ShouldScheduleSamePriorityInRoundRobinOrder" {
+    var scheduler = PriorityScheduler.init();
+
+    var pool = try ProcessMemoryPool.init(std.testing.allocator);
+    defer pool.deinit();
+
+    var list = std.DoublyLinkedList{};
+
+    var process1 = try create_process(1, "/proc/1", &pool);
+    defer process1.deinit();
+    var process2 = try create_process(2, "/proc/2", &pool);
+    defer process2.deinit();
+    var process3 = try create_process(3, "/proc/3", &pool);
+    defer process3.deinit();
+
+    list.append(&process1.node);
+    list.append(&process2.node);
+    list.append(&process3.node);
+
+    try std.testing.expectEqual(.Switch, scheduler.schedule_next(list.first.?));
+    try std.testing.expect(scheduler.get_next() == process1);
+    scheduler.update_current();
+    try std.testing.expectEqual(process1, scheduler.get_current().?);
+
+    try std.testing.expectEqual(.StoreAndSwitch, scheduler.schedule_next(list.first.?));
+    // repeated call keeps already selected process
+    try std.testing.expectEqual(.StoreAndSwitch, scheduler.schedule_next(list.first.?));
+    try std.testing.expect(scheduler.get_next() == process2);
+    scheduler.update_current();
+    try std.testing.expectEqual(process2, scheduler.get_current().?);
+
+    try std.testing.expectEqual(.StoreAndSwitch, scheduler.schedule_next(list.first.?));
+    try std.testing.expect(scheduler.get_next() == process3);
+    scheduler.update_current();
+    try std.testing.expectEqual(process3, scheduler.get_current().?);
+
+    // preempted processes are queued at the end
+    try std.testing.expectEqual(.StoreAndSwitch, scheduler.schedule_next(list.first.?));
+    try std.testing.expect(scheduler.get_next() == process1);
+    scheduler.update_current();
+    try std.testing.expectEqual(process1, scheduler.get_current().?);
+}
+
+test "PriorityScheduler.ShouldPreferHigherPriority" {
+    var scheduler = PriorityScheduler.init();
+
+    var pool = try ProcessMemoryPool.init(std.testing.allocator);
+    defer pool.deinit();
+
+    var list = std.DoublyLinkedList{};
+
+    var background = try create_process(1, "/proc/1", &pool);
+    defer background.deinit();
+    background.set_nice(10);
+    var shell = try create_process(2, "/proc/2", &pool);
+    defer shell.deinit();
+    shell.set_nice(-5);
+
+    list.append(&background.node);
+    list.append(&shell.node);
+
+    try std.testing.expectEqual(.Switch, scheduler.schedule_next(list.first.?));
+    try std.testing.expect(scheduler.get_next() == shell);
+    scheduler.update_current();
+
+    // lower priority process doesn't preempt running one
+    try std.testing.expectEqual(.NoAction, scheduler.schedule_next(list.first.?));
+    try std.testing.expect(scheduler.get_next() == null);
+    try std.testing.expectEqual(1, scheduler.number_of_queued(background.priority));
+
+    var sem = kernel.sync.Semaphore.create(0);
+    shell.block_semaphore(&sem);
+    try std.testing.expectEqual(.StoreAndSwitch, scheduler.schedule_next(list.first.?));
+    try std.testing.expect(scheduler.get_next() == background);
+    scheduler.update_current();
+    try std.testing.expectEqual(background, scheduler.get_current().?);
+
+    // woken up process with higher priority takes over
+    shell.unblock_semaphore(&sem);
+    try std.testing.expectEqual(.StoreAndSwitch, scheduler.schedule_next(list.first.?));
+    try std.testing.expect(scheduler.get_next() == shell);
+    scheduler.update_current();
+    try std.testing.expectEqual(shell, scheduler.get_current().?);
+}
+
+test "PriorityScheduler.NoActionWhenOthersBlocked" {
+    var scheduler = PriorityScheduler.init();
+
+    var pool = try ProcessMemoryPool.init(std.testing.allocator);
+    defer pool.deinit();
+
+    var list = std.DoublyLinkedList{};
+
+    var process1 = try create_process(1, "/proc/1", &pool);
+    defer process1.deinit();
+    var process2 = try create_process(2, "/proc/2", &pool);
+    defer process2.deinit();
+    var process3 = try create_process(3, "/proc/3", &pool);
+    defer process3.deinit();
+
+    var sem = kernel.sync.Semaphore.create(0);
+    process2.block_semaphore(&sem);
+    process3.block_semaphore(&sem);
+
+    list.append(&process1.node);
+    list.append(&process2.node);
+    list.append(&process3.node);
+
+    try std.testing.expectEqual(.Switch, scheduler.schedule_next(list.first.?));
+    try std.testing.expect(scheduler.get_next() == process1);
+    scheduler.update_current();
+    try std.testing.expectEqual(process1, scheduler.get_current().?);
+
+    try std.testing.expectEqual(.NoAction, scheduler.schedule_next(list.first.?));
+    try std.testing.expect(scheduler.get_next() == null);
+    // blocked processes are kept out of run queues
+    try std.testing.expectEqual(0, scheduler._ready_mask);
+    try std.testing.expectEqual(.None, process2.run_queue_state);
+    try std.testing.expectEqual(.None, process3.run_queue_state);
+
+    process3.unblock_semaphore(&sem);
+    try std.testing.expectEqual(.StoreAndSwitch, scheduler.schedule_next(list.first.?));
+    try std.testing.expect(scheduler.get_next() == process3);
+    process2.unblock_semaphore(&sem);
+}
+
+test "PriorityScheduler.ShouldForceProcessOnDemand" {
+    var scheduler = PriorityScheduler.init();
+
+    var pool = try ProcessMemoryPool.init(std.testing.allocator);
+    defer pool.deinit();
+
+    var list = std.DoublyLinkedList{};
+
+    var process1 = try create_process(1, "/proc/1", &pool);
+    defer process1.deinit();
+    var process2 = try create_process(2, "/proc/2", &pool);
+    defer process2.deinit();
+
+    list.append(&process1.node);
+    list.append(&process2.node);
+
+    try std.testing.expectEqual(.Switch, scheduler.schedule_next(list.first.?));
+    try std.testing.expect(scheduler.get_next() == process1);
+    scheduler.update_current();
+    try std.testing.expectEqual(process1, scheduler.get_current().?);
+    process1._initialized = false;
+    try std.testing.expectEqual(.Switch, scheduler.schedule_next(list.first.?));
+    try std.testing.expect(scheduler.get_next() == process2);
+
+    // forced process replaces selected one, which stays queued
+    scheduler.set_next(&process1.node);
+    try std.testing.expect(scheduler.get_current() == process1);
+    try std.testing.expect(scheduler.get_next() == null);
+    try std.testing.expectEqual(.Queued, process2.run_queue_state);
+
+    scheduler.set_next(null);
+    try std.testing.expect(scheduler.get_current() == process1);
+
+    scheduler.remove_process(&process2.node);
+    try std.testing.expectEqual(.None, process2.run_queue_state);
+    try std.testing.expectEqual(0, scheduler._ready_mask);
+    scheduler.remove_process(&process1.node);
+    try std.testing.expectEqual(null, scheduler.get_current());
+}
+
+test "PriorityScheduler.ShouldAgeStarvedProcesses" {
+    var scheduler = PriorityScheduler.init();
+
+    var pool = try ProcessMemoryPool.init(std.testing.allocator);
+    defer pool.deinit();
+
+    var list = std.DoublyLinkedList{};
+
+    var hog = try create_process(1, "/proc/1", &pool);
+    defer hog.deinit();
+    hog.set_nice(-5);
+    var background = try create_process(2, "/proc/2", &pool);
+    defer background.deinit();
+    background.set_nice(-3);
+
+    list.append(&hog.node);
+    list.append(&background.node);
+
+    try std.testing.expectEqual(.Switch, scheduler.schedule_next(list.first.?));
+    try std.testing.expect(scheduler.get_next() == hog);
+    scheduler.update_current();
+
+    // background is promoted one level per aging period until it reaches hog priority,
+    // first round was used to select hog
+    const rounds = (background.priority - hog.priority) * PriorityScheduler.aging_period;
+    for (1..rounds - 1) |_| {
+        try std.testing.expectEqual(.NoAction, scheduler.schedule_next(list.first.?));
+    }
+    try std.testing.expectEqual(.StoreAndSwitch, scheduler.schedule_next(list.first.?));
+    try std.testing.expect(scheduler.get_next() == background);
+    scheduler.update_current();
+    try std.testing.expectEqual(background, scheduler.get_current().?);
+
+    // preempted hog is queued with own priority, background loses boost when queued again
+    try std.testing.expectEqual(.StoreAndSwitch, scheduler.schedule_next(list.first.?));
+    try std.testing.expect(scheduler.get_next() == hog);
+    scheduler.update_current();
+    scheduler.collect_ready();
+    try std.testing.expectEqual(1, scheduler.number_of_queued(background.priority));
+}
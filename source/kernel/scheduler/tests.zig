@@ -15,4 +15,5 @@
 
 comptime {
     _ = @import("round_robin.zig");
+    _ = @import("priority.zig");
 }
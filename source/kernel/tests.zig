@@ -29,10 +29,16 @@ comptime {
     _ = @import("spawn.zig");
     _ = @import("semaphore.zig");
     _ = @import("dump_hardware.zig");
+    _ = @import("fd_table.zig");
     _ = @import("process.zig");
     _ = @import("process/tests.zig");
     _ = @import("time.zig");
+    _ = @import("timer.zig");
     _ = @import("interrupts/kernel_semaphore.zig");
+    _ = @import("interrupts/kernel_completion.zig");
+    _ = @import("interrupts/kernel_io_lock.zig");
+    _ = @import("interrupts/kernel_wait_queue.zig");
+    _ = @import("interrupts/kernel_irq_lock.zig");
 }
 
 test {
@@ -18,6 +18,8 @@
 // <https://www.gnu.org/licenses/>.
 //
 
+const c = @import("libc_imports").c;
+
 const systick = @import("interrupts/systick.zig");
 const process_manager = @import("process_manager.zig");
 
@@ -29,11 +31,20 @@ pub fn sleep_ms(ms: u32) void {
     process.sleep_for_ms(ms);
 }
 
-pub fn sleep_us(us: u32) void {
+pub fn sleep_us(us: u64) void {
     const process = process_manager.instance.get_current_process();
     process.sleep_for_us(us);
 }
 
+pub fn sleep_timespec(ts: c.timespec) !void {
+    if (ts.tv_sec < 0 or ts.tv_nsec < 0 or ts.tv_nsec >= 1_000_000_000) {
+        return kernel.errno.ErrnoSet.InvalidArgument;
+    }
+    // single wakeup for whole interval, partial microseconds are rounded up by timer
+    const us = @as(u64, @intCast(ts.tv_sec)) * 1_000_000 + std.math.divCeil(u64, @intCast(ts.tv_nsec), 1000) catch unreachable;
+    sleep_us(us);
+}
+
 const std = @import("std");
 const hal = @import("hal");
 const irq_systick = @import("interrupts/systick.zig").irq_systick;
@@ -73,3 +84,8 @@ test "Time.ProcessShoulSleep" {
     sleep_ms(400);
     try std.testing.expectEqual(1, call_count);
 }
+
+test "Time.ShouldRejectInvalidTimespec" {
+    try std.testing.expectError(kernel.errno.ErrnoSet.InvalidArgument, sleep_timespec(.{ .tv_sec = -1, .tv_nsec = 0 }));
+    try std.testing.expectError(kernel.errno.ErrnoSet.InvalidArgument, sleep_timespec(.{ .tv_sec = 0, .tv_nsec = 1_000_000_000 }));
+}
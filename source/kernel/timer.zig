@@ -0,0 +1,253 @@
+//
+// timer.zig
+//
+// Copyright (C) 2025 Mateusz Stadnik <matgla@live.com>
+//
+// This program is free software: you can redistribute it and/or
+// modify it under the terms of the GNU General Public License
+// as published by the Free Software Foundation, either version
+// 3 of the License, or (at your option) any later version.
+//
+// This program is distributed in the hope that it will be
+// useful, but WITHOUT ANY WARRANTY; without even the implied
+// warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR
+// PURPOSE. See the GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General
+// Public License along with this program. If not, see
+// <https://www.gnu.org/licenses/>.
+//
+
+const std = @import("std");
+
+const IrqLock = @import("interrupts/kernel_irq_lock.zig").IrqLock;
+
+// Kernel timers driven from systick, one tick is one millisecond.
+// Timers are kept in hashed timing wheel, slot is selected by expiration tick,
+// so arming and cancelling is O(1) and each tick visits only a single slot.
+// Callbacks are executed from systick interrupt context.
+
+pub const Callback = *const fn (context: ?*anyopaque) void;
+
+pub const Timer = struct {
+    const Self = @This();
+
+    callback: ?Callback = null,
+    context: ?*anyopaque = null,
+    expires: u64 = 0,
+    node: std.DoublyLinkedList.Node = .{},
+    _armed: bool = false,
+
+    pub fn is_armed(self: *const Self) bool {
+        const armed: *const volatile bool = &self._armed;
+        return armed.*;
+    }
+};
+
+pub fn TimerWheel(comptime number_of_slots: usize) type {
+    return struct {
+        const Self = @This();
+
+        _slots: [number_of_slots]std.DoublyLinkedList = [_]std.DoublyLinkedList{.{}} ** number_of_slots,
+        _now: u64 = 0,
+        _armed: usize = 0,
+
+        pub fn now(self: *const Self) u64 {
+            const ticks: *const volatile u64 = &self._now;
+            return ticks.*;
+        }
+
+        pub fn armed_timers(self: *const Self) usize {
+            return self._armed;
+        }
+
+        // timer expires after given number of ticks, at least one tick from now
+        pub fn start(self: *Self, timer: *Timer, ticks: u64) void {
+            const state = IrqLock.lock();
+            defer IrqLock.unlock(state);
+            if (timer._armed) {
+                self.remove(timer);
+            }
+            timer.expires = self._now + @max(ticks, 1);
+            timer._armed = true;
+            self._slots[timer.expires % number_of_slots].append(&timer.node);
+            self._armed += 1;
+        }
+
+        pub fn cancel(self: *Self, timer: *Timer) void {
+            const state = IrqLock.lock();
+            defer IrqLock.unlock(state);
+            if (timer._armed) {
+                self.remove(timer);
+            }
+        }
+
+        // advances wheel by one tick, returns number of fired timers
+        pub fn tick(self: *Self) usize {
+            const state = IrqLock.lock();
+            defer IrqLock.unlock(state);
+            self._now += 1;
+            var fired: usize = 0;
+            // callback may cancel or re-arm any timer in the slot, so slot is walked again after each one
+            while (self.take_expired()) |timer| {
+                fired += 1;
+                if (timer.callback) |callback| {
+                    callback(timer.context);
+                }
+            }
+            return fired;
+        }
+
+        fn take_expired(self: *Self) ?*Timer {
+            var it = self._slots[self._now % number_of_slots].first;
+            while (it) |node| : (it = node.next) {
+                const timer: *Timer = @fieldParentPtr("node", node);
+                if (timer.expires <= self._now) {
+                    self.remove(timer);
+                    return timer;
+                }
+            }
+            return null;
+        }
+
+        fn remove(self: *Self, timer: *Timer) void {
+            self._slots[timer.expires % number_of_slots].remove(&timer.node);
+            timer._armed = false;
+            self._armed -= 1;
+        }
+    };
+}
+
+const KernelTimerWheel = TimerWheel(64);
+var wheel: KernelTimerWheel = .{};
+
+pub fn start(timer: *Timer, ticks: u64) void {
+    wheel.start(timer, ticks);
+}
+
+pub fn cancel(timer: *Timer) void {
+    wheel.cancel(timer);
+}
+
+// called from systick interrupt
+pub fn tick() usize {
+    return wheel.tick();
+}
+
+pub fn now() u64 {
+    return wheel.now();
+}
+
+pub fn us_to_ticks(us: u64) u64 {
+    return std.math.divCeil(u64, us, 1000) catch unreachable;
+}
+
+const TimerCounter = struct {
+    var calls: usize = 0;
+    var rearm: ?*KernelTimerWheel = null;
+
+    pub fn call(context: ?*anyopaque) void {
+        calls += 1;
+        if (rearm) |w| {
+            const timer: *Timer = @ptrCast(@alignCast(context.?));
+            w.start(timer, 5);
+        }
+    }
+};
+
+const SiblingCanceller = struct {
+    var wheel_under_test: ?*KernelTimerWheel = null;
+
+    pub fn call(context: ?*anyopaque) void {
+        const sibling: *Timer = @ptrCast(@alignCast(context.?));
+        wheel_under_test.?.cancel(sibling);
+    }
+};
+
+test "TimerWheel.ShouldFireTimerAtExpiry" {
+    var sut = KernelTimerWheel{};
+    TimerCounter.calls = 0;
+    TimerCounter.rearm = null;
+    var timer = Timer{ .callback = &TimerCounter.call };
+
+    sut.start(&timer, 3);
+    try std.testing.expect(timer.is_armed());
+    try std.testing.expectEqual(0, sut.tick());
+    try std.testing.expectEqual(0, sut.tick());
+    try std.testing.expectEqual(0, TimerCounter.calls);
+    try std.testing.expectEqual(1, sut.tick());
+    try std.testing.expectEqual(1, TimerCounter.calls);
+    try std.testing.expect(!timer.is_armed());
+    try std.testing.expectEqual(0, sut.armed_timers());
+}
+
+test "TimerWheel.ShouldKeepTimersFromFurtherRoundsInSlot" {
+    var sut = KernelTimerWheel{};
+    TimerCounter.calls = 0;
+    TimerCounter.rearm = null;
+    var near = Timer{ .callback = &TimerCounter.call };
+    var far = Timer{ .callback = &TimerCounter.call };
+
+    sut.start(&near, 2);
+    sut.start(&far, 2 + 64);
+    _ = sut.tick();
+    _ = sut.tick();
+    try std.testing.expectEqual(1, TimerCounter.calls);
+    try std.testing.expect(far.is_armed());
+
+    for (0..63) |_| {
+        _ = sut.tick();
+    }
+    try std.testing.expectEqual(1, TimerCounter.calls);
+    try std.testing.expectEqual(1, sut.tick());
+    try std.testing.expectEqual(2, TimerCounter.calls);
+    try std.testing.expectEqual(66, sut.now());
+}
+
+test "TimerWheel.ShouldNotFireCancelledTimer" {
+    var sut = KernelTimerWheel{};
+    TimerCounter.calls = 0;
+    TimerCounter.rearm = null;
+    var timer = Timer{ .callback = &TimerCounter.call };
+
+    sut.start(&timer, 1);
+    sut.cancel(&timer);
+    try std.testing.expectEqual(0, sut.tick());
+    try std.testing.expectEqual(0, TimerCounter.calls);
+    try std.testing.expectEqual(0, sut.armed_timers());
+}
+
+test "TimerWheel.ShouldAllowRearmingFromCallback" {
+    var sut = KernelTimerWheel{};
+    TimerCounter.calls = 0;
+    var timer = Timer{ .callback = &TimerCounter.call };
+    timer.context = &timer;
+    TimerCounter.rearm = &sut;
+    defer TimerCounter.rearm = null;
+
+    sut.start(&timer, 5);
+    for (0..15) |_| {
+        _ = sut.tick();
+    }
+    try std.testing.expectEqual(3, TimerCounter.calls);
+    try std.testing.expect(timer.is_armed());
+    sut.cancel(&timer);
+}
+
+test "TimerWheel.ShouldNotFireTimerCancelledBySiblingCallback" {
+    var sut = KernelTimerWheel{};
+    TimerCounter.calls = 0;
+    TimerCounter.rearm = null;
+    SiblingCanceller.wheel_under_test = &sut;
+    defer SiblingCanceller.wheel_under_test = null;
+    var sibling = Timer{ .callback = &TimerCounter.call };
+    var canceller = Timer{ .callback = &SiblingCanceller.call, .context = &sibling };
+
+    // both timers expire in the same slot, sibling is queued right after canceller
+    sut.start(&canceller, 1);
+    sut.start(&sibling, 1);
+    try std.testing.expectEqual(1, sut.tick());
+    try std.testing.expectEqual(0, TimerCounter.calls);
+    try std.testing.expect(!sibling.is_armed());
+    try std.testing.expectEqual(0, sut.armed_timers());
+}
@@ -97,6 +97,8 @@ pub fn panic(msg: []const u8, _: ?*std.builtin.StackTrace, _: ?usize) noreturn {
     kernel.log.err("KERNEL PANIC: {s}", .{msg});
     panic_helper.dump_stack_trace(kernel.log, @returnAddress());
     kernel.log.err("***********************************************", .{});
+    // nothing drains transmit queue after halt
+    board.uart.uart0.flush();
     while (true) {}
 }
 
@@ -159,6 +161,31 @@ fn add_mmc_partition_drivers(mmcfile: *kernel.fs.IFile, allocator: std.mem.Alloc
     }
 }
 
+const BlockCachePageAllocator = kernel.memory.heap.ProcessPageAllocator(kernel.memory.heap.ProcessMemoryPool);
+var block_cache_pages: BlockCachePageAllocator = undefined;
+
+fn initialize_block_cache(allocator: std.mem.Allocator) !void {
+    if (config.fs.block_cache_sectors == 0) {
+        return;
+    }
+    var storage_allocator = allocator;
+    if (config.fs.block_cache_in_psram) {
+        // pid 0 is never given to processes, so pages stay with kernel
+        block_cache_pages = BlockCachePageAllocator.init(0, kernel.process.process_manager.instance.get_process_memory_pool());
+        storage_allocator = block_cache_pages.allocator();
+    }
+    try kernel.fs.block_cache_init(allocator, storage_allocator, config.fs.block_cache_sectors);
+}
+
+// Takes ownership of block device file, returns device file seen through block cache if enabled.
+// Only MMC devices are cached, memory mapped flash would only be duplicated in RAM.
+fn use_block_cache(allocator: std.mem.Allocator, file: kernel.fs.IFile) !kernel.fs.IFile {
+    const cache = kernel.fs.get_block_cache() orelse return file;
+    var device = file;
+    defer device.interface.delete();
+    return try (try kernel.fs.BlockCacheFile.InstanceType.create(cache, device)).interface.new(allocator);
+}
+
 fn initialize_filesystem(allocator: std.mem.Allocator) !void {
     kernel.fs.vfs_init(allocator);
     var driverfs = try kernel.driver.fs.DriverFs.InstanceType.init(allocator);
@@ -202,13 +229,15 @@ fn initialize_filesystem(allocator: std.mem.Allocator) !void {
     var node = try flash_driver.interface.node();
     const maybe_flashfile = node.as_file();
     if (maybe_flashfile) |flash| {
+        // flash is memory mapped and RomFs reads it in place, so it is not cached
         try mount_filesystem(try allocate_filesystem(allocator, RomFs.InstanceType.init(allocator, flash, 0x100000)), "/");
         var maybe_mmcpart0 = driverfs.data().get("mmc0p0") catch null;
         if (maybe_mmcpart0) |*mmcnode| {
-            var maybe_file = mmcnode.as_file();
-            if (maybe_file) |*file| {
-                const maybe_rootfs: ?kernel.fs.IFileSystem = allocate_filesystem(allocator, FatFs.InstanceType.init(allocator, file.*)) catch null;
-                file.interface.delete();
+            const maybe_file = mmcnode.as_file();
+            if (maybe_file) |file| {
+                var device = try use_block_cache(allocator, file);
+                const maybe_rootfs: ?kernel.fs.IFileSystem = allocate_filesystem(allocator, FatFs.InstanceType.init(allocator, device)) catch null;
+                device.interface.delete();
                 if (maybe_rootfs) |rootfs| {
                     mount_filesystem(rootfs, "/root") catch {};
                 }
@@ -247,6 +276,10 @@ const KernelAllocator = kernel.memory.heap.malloc.MallocAllocator(.{
     .dump_stats = config.instrumentation.print_memory_usage,
 });
 
+// small kernel objects are served from slab caches built on top of malloc
+const KernelSlabAllocator = if (config.allocator.slab) kernel.memory.heap.SlabAllocator else void;
+var slab_allocator: KernelSlabAllocator = undefined;
+
 export fn kernel_process() void {
     const process = kernel.process.process_manager.instance.get_current_process();
     attach_default_filedescriptors_to_root_process(process) catch {
@@ -275,17 +308,24 @@ pub fn splashscreen() void {
 
 pub export fn main() void {
     var kernel_allocator = KernelAllocator{};
+    if (config.allocator.slab) {
+        slab_allocator = KernelSlabAllocator.init(kernel_allocator.allocator());
+    }
     {
-        const allocator = kernel_allocator.allocator();
+        const allocator = if (config.allocator.slab) slab_allocator.allocator() else kernel_allocator.allocator();
         initialize_board();
         splashscreen();
 
         kernel.process.process_manager.initialize_process_manager(allocator);
         defer kernel.process.process_manager.deinitialize_process_manager();
 
-        kernel.irq.system_call.init(kernel_allocator.allocator());
+        kernel.irq.system_call.init(allocator);
         kernel.dynamic_loader.init(allocator);
         defer kernel.dynamic_loader.deinit();
+        initialize_block_cache(allocator) catch |err| {
+            kernel.log.err("Block cache initialization failed: {s}", .{@errorName(err)});
+        };
+        defer kernel.fs.block_cache_deinit();
         initialize_filesystem(allocator) catch |err| {
             kernel.log.err("Filesystem initialization failed: {s}", .{@errorName(err)});
             return;
@@ -298,6 +338,9 @@ pub export fn main() void {
         };
         kernel.log.warn("Root process died", .{});
     }
+    if (config.allocator.slab) {
+        slab_allocator.deinit();
+    }
     _ = @call(.never_inline, KernelAllocator.detect_leaks, .{});
     // kernel system calls are not available here
     _ = board.uart.uart0.write_some("Kernel has halted.\nYou can turn off your PC now!\n") catch 0;
@@ -0,0 +1,72 @@
+/**
+ * kernel_syscall.h
+ *
+ * Copyright (C) 2025 Mateusz Stadnik <matgla@live.com>
+ *
+ * This program is free software: you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation, either version
+ * 3 of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be
+ * useful, but WITHOUT ANY WARRANTY; without even the implied
+ * warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR
+ * PURPOSE. See the GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General
+ * Public License along with this program. If not, see
+ * <https://www.gnu.org/licenses/>.
+ */
+
+#pragma once
+
+/*
+ * Arguments of system calls implemented by the kernel and not yet described
+ * by libc headers. Installed to /usr/include/yasos, so libc wrappers pass
+ * exactly the layout that kernel handlers read.
+ */
+
+#include <time.h>
+
+/*
+ * Numbers of system calls not enumerated by libc. They are reserved above
+ * the libc range, so already built binaries keep working when libc appends
+ * new system calls.
+ */
+#define SYSCALL_KERNEL_BASE 128
+/* internal, issued by yasld lazy binding trampoline */
+#define sys_kernel_lazy_bind (SYSCALL_KERNEL_BASE + 0)
+#define sys_kernel_pipe (SYSCALL_KERNEL_BASE + 1)
+#define sys_kernel_pipe2 (SYSCALL_KERNEL_BASE + 2)
+#define sys_kernel_mkfifo (SYSCALL_KERNEL_BASE + 3)
+#define sys_kernel_poll (SYSCALL_KERNEL_BASE + 4)
+#define sys_kernel_select (SYSCALL_KERNEL_BASE + 5)
+#define sys_kernel_setpriority (SYSCALL_KERNEL_BASE + 6)
+#define sys_kernel_getpriority (SYSCALL_KERNEL_BASE + 7)
+
+/* sys_nanosleep */
+typedef struct nanosleep_context
+{
+  const struct timespec *req;
+  struct timespec *rem;
+} nanosleep_context;
+
+#ifndef PRIO_PROCESS
+#define PRIO_PROCESS 0
+#endif
+
+/* sys_setpriority, only PRIO_PROCESS is supported, who equal to 0 selects caller */
+typedef struct setpriority_context
+{
+  int which;
+  int who;
+  int prio;
+} setpriority_context;
+
+/* sys_getpriority, nice value is stored in result, as it may be negative */
+typedef struct getpriority_context
+{
+  int which;
+  int who;
+  int *result;
+} getpriority_context;
@@ -0,0 +1,94 @@
+"""
+ Copyright (c) 2025 Mateusz Stadnik
+
+ This program is free software: you can redistribute it and/or modify
+ it under the terms of the GNU General Public License as published by
+ the Free Software Foundation, either version 3 of the License, or
+ (at your option) any later version.
+
+ This program is distributed in the hope that it will be useful,
+ but WITHOUT ANY WARRANTY; without even the implied warranty of
+ MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ GNU General Public License for more details.
+
+ You should have received a copy of the GNU General Public License
+ along with this program. If not, see <https://www.gnu.org/licenses/>.
+ """
+
+import pytest
+
+from .conftest import session_key
+
+# Kernel probes from /proc/benchmark, image must be built with
+# CONFIG_INSTRUMENTATION_ENABLE_BENCHMARKS. Run the same test on the kernel
+# before and after a change to compare numbers printed to the test log.
+
+def read_probes(session):
+    session.write_command("cat /proc/benchmark")
+    lines = session.read_until_prompt().splitlines()
+    probes = {}
+    for line in lines:
+        fields = line.split()
+        if len(fields) == 4 and fields[1].isdigit():
+            probes[fields[0]] = [int(field) for field in fields[1:]]
+    return probes
+
+def measure(session, probe, command, iterations):
+    before = read_probes(session)[probe]
+    output = ""
+    for _ in range(iterations):
+        session.write_command(command)
+        output = session.read_until_prompt()
+    after = read_probes(session)[probe]
+    calls = after[0] - before[0]
+    total_us = after[1] - before[1]
+    return calls, total_us, output
+
+# directory listing goes through different getdents paths per filesystem:
+# RomFs, FatFs, ProcFs and DriverFs
+fatfs_directory = "/root/benchmark_readdir"
+fatfs_files = 32
+
+def populate_fatfs_directory(session):
+    session.write_command(f"mkdir -p {fatfs_directory}")
+    session.read_until_prompt()
+    session.write_command(f"i=0; while [ $i -lt {fatfs_files} ]; do : > {fatfs_directory}/file_$i; i=$((i+1)); done")
+    session.read_until_prompt()
+
+@pytest.mark.parametrize("directory", ["/bin", fatfs_directory, "/proc", "/dev"])
+def test_benchmark_readdir(request, directory):
+    session = request.node.stash[session_key]
+    if directory == fatfs_directory:
+        populate_fatfs_directory(session)
+    iterations = 10
+    calls, total_us, output = measure(session, "getdents", f"ls {directory}", iterations)
+    entries = len(output.split()) - 1
+    print(f"\nreaddir {directory}: {entries} entries, {calls / iterations:.1f} getdents calls and {total_us / iterations:.0f} us per listing")
+    assert calls >= iterations
+    if directory == fatfs_directory:
+        assert entries >= fatfs_files
+    if entries > 1:
+        # single dirent per call needs one call per entry and one for end of directory
+        assert calls < iterations * (entries + 1)
+
+def test_benchmark_stat(request):
+    session = request.node.stash[session_key]
+    iterations = 10
+    calls, total_us, _ = measure(session, "stat", "ls -l /bin", iterations)
+    print(f"\nstat /bin entries: {calls / iterations:.1f} calls and {total_us / iterations:.0f} us per listing, {total_us / max(calls, 1):.1f} us per call")
+    assert calls >= iterations
+
+def test_benchmark_exec(request):
+    session = request.node.stash[session_key]
+    iterations = 10
+    before = read_probes(session)
+    for _ in range(iterations):
+        session.write_command("/usr/bin/hello")
+        session.read_until_prompt()
+    after = read_probes(session)
+    calls = after["exec"][0] - before["exec"][0]
+    exec_us = after["exec"][1] - before["exec"][1]
+    binds = after["lazy_bind"][0] - before["lazy_bind"][0]
+    bind_us = after["lazy_bind"][1] - before["lazy_bind"][1]
+    print(f"\nexec to main: {exec_us / max(calls, 1):.0f} us per exec, {binds / iterations:.1f} lazy bindings taking {bind_us / iterations:.0f} us per run")
+    assert calls >= iterations
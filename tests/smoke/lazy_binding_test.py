@@ -0,0 +1,26 @@
+"""
+ Copyright (c) 2025 Mateusz Stadnik
+
+ This program is free software: you can redistribute it and/or modify
+ it under the terms of the GNU General Public License as published by
+ the Free Software Foundation, either version 3 of the License, or
+ (at your option) any later version.
+
+ This program is distributed in the hope that it will be useful,
+ but WITHOUT ANY WARRANTY; without even the implied warranty of
+ MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ GNU General Public License for more details.
+
+ You should have received a copy of the GNU General Public License
+ along with this program. If not, see <https://www.gnu.org/licenses/>.
+ """
+
+from .conftest import session_key
+
+def test_lazy_binding_preserves_float_arguments(request):
+    session = request.node.stash[session_key]
+    session.write_command("tcc /usr/lazy_binding_float.c -lm -o /tmp/lazy_binding_float")
+    session.wait_for_prompt()
+    session.write_command("/tmp/lazy_binding_float")
+    line = session.read_line_except_logs()
+    assert "Result: 25 1024 25" in line
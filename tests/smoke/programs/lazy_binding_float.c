@@ -0,0 +1,12 @@
+#include <math.h>
+#include <stdio.h>
+
+// First call of every libm function goes through lazy binding trampoline,
+// float arguments passed in s0-s15 must survive symbol resolution in kernel.
+int main() {
+  float max = fmaxf(1.5f, 2.5f);
+  float power = powf(2.0f, 10.0f);
+  float min = fminf(max, power);
+  printf("Result: %d %d %d\n", (int)(max * 10), (int)power, (int)(min * 10));
+  return 0;
+}